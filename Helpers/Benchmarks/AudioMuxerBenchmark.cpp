@@ -0,0 +1,69 @@
+// Interleaving of two planar channels to stereo by the AudioMuxer kernels of FFmpeg/AudioMuxerKernels.h: each kernel checked against
+// the scalar loop for sample counts which exercise the tail of the vector loop, and its time per 48 kHz frame.
+
+#include "Benchmark.h"
+#include <cstdlib>
+#include <cstring>
+#include "FFmpeg/AudioMuxerKernels.h"
+
+using namespace TVPlayR;
+
+struct KernelCase
+{
+	const char* name;
+	FFmpeg::INTERLEAVE_KERNEL kernel;
+};
+
+static std::vector<float> RandomSamples(size_t count, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<float> samples(count);
+	for (auto& sample : samples)
+		sample = distribution(generator);
+	return samples;
+}
+
+static bool Check(const KernelCase& test, int samples_count)
+{
+	const std::vector<float> left = RandomSamples(samples_count, 1);
+	const std::vector<float> right = RandomSamples(samples_count, 2);
+	// one more pair, which the kernel must not write
+	std::vector<float> expected(2 * samples_count + 2, 7.0f);
+	std::vector<float> actual(expected);
+	FFmpeg::InterleaveStereoScalar(left.data(), right.data(), expected.data(), samples_count);
+	test.kernel(left.data(), right.data(), actual.data(), samples_count);
+	if (std::memcmp(expected.data(), actual.data(), expected.size() * sizeof(float)) == 0)
+		return true;
+	std::printf("FAIL %s, %d samples\n", test.name, samples_count);
+	return false;
+}
+
+int main()
+{
+	std::vector<KernelCase> kernels = { { "scalar", FFmpeg::InterleaveStereoScalar } };
+#ifdef CPU_X64
+	if (Common::CpuFeatures::Instance().HasAvx2())
+		kernels.push_back({ "AVX2", FFmpeg::InterleaveStereoAvx2 });
+	else
+		std::printf("AVX2 not available, only the scalar loop is measured\n");
+#endif // CPU_X64
+	int failed = 0;
+	for (const KernelCase& test : kernels)
+		for (int samples_count : { 0, 1, 7, 8, 9, 15, 16, 17, 1601, 1602, 1920 })
+			if (!Check(test, samples_count))
+				failed++;
+	if (failed)
+		return 1;
+	// 25 and 29.97 fps frames at 48 kHz
+	for (int samples_count : { 1920, 1602 })
+	{
+		std::printf("%d samples of two channels\n", samples_count);
+		const std::vector<float> left = RandomSamples(samples_count, 1);
+		const std::vector<float> right = RandomSamples(samples_count, 2);
+		std::vector<float> destination(2 * samples_count);
+		for (const KernelCase& test : kernels)
+			std::printf("  %-8s %8.3f us/frame\n", test.name, Benchmarks::Measure([&] { test.kernel(left.data(), right.data(), destination.data(), samples_count); }));
+	}
+	return 0;
+}
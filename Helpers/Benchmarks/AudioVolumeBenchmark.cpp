@@ -0,0 +1,104 @@
+// Cost of AudioVolume processing (gain ramp, peak, RMS and coherence) of 16-channel 48 kHz frames, for each kernel,
+// compared with the per-sample loop the player used before (gain changed at zero crossing, peaks only).
+
+#include "Benchmark.h"
+#include <cstdlib>
+#include "Core/AudioVolumeKernels.h"
+
+using namespace TVPlayR;
+
+#define BENCHMARK_SAMPLE_RATE 48000
+#define BENCHMARK_CHANNELS 16
+
+struct KernelCase
+{
+	const char* name;
+	Core::VOLUME_KERNEL kernel;
+	size_t lanes;
+};
+
+static std::vector<float> PreviousProcessVolume(float* samples, int channels, int rows, float& volume, float new_volume)
+{
+	const int samples_count = rows * channels;
+	std::vector<float> peak_volume(channels, 0.0f);
+	for (int sample = 0; sample < samples_count; sample++)
+	{
+		if (volume != new_volume && sample > 0 && (samples[sample] * samples[sample - 1]) < 0)
+			volume = new_volume;
+		samples[sample] = samples[sample] * volume;
+		if (std::abs(samples[sample]) > peak_volume[sample % channels])
+			peak_volume[sample % channels] = std::abs(samples[sample]);
+	}
+	volume = new_volume;
+	return peak_volume;
+}
+
+static std::vector<float> RandomSamples(size_t count)
+{
+	std::mt19937 generator(1);
+	std::uniform_real_distribution<float> distribution(-0.5f, 0.5f);
+	std::vector<float> samples(count);
+	for (auto& sample : samples)
+		sample = distribution(generator);
+	return samples;
+}
+
+static void Report(const char* name, int rows, double microseconds)
+{
+	const double frame_duration = 1e6 * rows / BENCHMARK_SAMPLE_RATE;
+	std::printf("  %-10s %8.2f us/frame %8.1f Msample/s %8.0fx realtime\n", name, microseconds, rows * static_cast<double>(BENCHMARK_CHANNELS) / microseconds, frame_duration / microseconds);
+}
+
+static void Run(int rows, const std::vector<KernelCase>& kernels)
+{
+	std::printf("%d channels, %d samples per frame\n", BENCHMARK_CHANNELS, rows);
+	const std::vector<float> source = RandomSamples(static_cast<size_t>(rows) * BENCHMARK_CHANNELS);
+	std::vector<float> samples(source);
+	// gain alternates between two values, as while the volume is being changed, and is 1 on average, so the samples neither vanish nor grow
+	float volume = 0.5f;
+	bool up = true;
+	Report("previous", rows, Benchmarks::Measure([&]
+		{
+			PreviousProcessVolume(samples.data(), BENCHMARK_CHANNELS, rows, volume, up ? 2.0f : 0.5f);
+			up = !up;
+		}));
+
+	std::vector<float> reference;
+	for (const KernelCase& test : kernels)
+	{
+		Core::VolumeAccumulators accumulators;
+		Core::VolumeMeasurement measurement;
+		// the result of one ramp checked against the scalar loop first
+		samples = source;
+		Core::ScaleAndMeasure(test.kernel, test.lanes, samples.data(), BENCHMARK_CHANNELS, rows, 0.5f, 1.0f / rows, accumulators, measurement);
+		if (reference.empty())
+			reference = measurement.Rms;
+		for (int channel = 0; channel < BENCHMARK_CHANNELS; channel++)
+			if (std::abs(measurement.Rms[channel] - reference[channel]) > 1e-4f * reference[channel])
+			{
+				std::printf("  %s: RMS of channel %d is %f, scalar loop gives %f\n", test.name, channel, measurement.Rms[channel], reference[channel]);
+				std::exit(1);
+			}
+		samples = source;
+		up = true;
+		Report(test.name, rows, Benchmarks::Measure([&]
+			{
+				const float gain = up ? 0.5f : 2.0f;
+				Core::ScaleAndMeasure(test.kernel, test.lanes, samples.data(), BENCHMARK_CHANNELS, rows, gain, (up ? 1.5f : -1.5f) / rows, accumulators, measurement);
+				up = !up;
+			}));
+	}
+}
+
+int main()
+{
+	std::vector<KernelCase> kernels = { { "scalar", nullptr, 1 } };
+#ifdef CPU_X64
+	kernels.push_back({ "sse2", Core::ProcessBlocksSse2, 4 });
+	if (Common::CpuFeatures::Instance().HasAvx2())
+		kernels.push_back({ "avx2", Core::ProcessBlocksAvx2, 8 });
+#endif // CPU_X64
+	Run(BENCHMARK_SAMPLE_RATE / 25, kernels); // 25 fps frame
+	Run(1601, kernels); // 29.97 fps frames alternate 1601 and 1602 samples, so the block tail is processed too
+	return 0;
+}
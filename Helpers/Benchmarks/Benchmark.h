@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace TVPlayR {
+	namespace Benchmarks {
+
+// calls the function for at least the given time, repeated few times, returns the best mean duration of one call in microseconds
+template <typename Function>
+double Measure(Function&& function, int rounds = 5, std::chrono::milliseconds round_time = std::chrono::milliseconds(200))
+{
+	function(); // warm up caches and lazy allocations
+	double best = 0.0;
+	for (int round = 0; round < rounds; round++)
+	{
+		int64_t calls = 0;
+		const auto start = std::chrono::steady_clock::now();
+		auto now = start;
+		do
+		{
+			function();
+			calls++;
+			now = std::chrono::steady_clock::now();
+		} while (now - start < round_time);
+		const double mean = std::chrono::duration<double, std::micro>(now - start).count() / calls;
+		if (round == 0 || mean < best)
+			best = mean;
+	}
+	return best;
+}
+
+inline std::vector<uint8_t> RandomBytes(size_t size, uint32_t seed = 1)
+{
+	std::mt19937 generator(seed);
+	std::uniform_int_distribution<int> distribution(0, 255);
+	std::vector<uint8_t> bytes(size);
+	for (auto& byte : bytes)
+		byte = static_cast<uint8_t>(distribution(generator));
+	return bytes;
+}
+
+}}
@@ -0,0 +1,93 @@
+// Throughput of the X2RGB10 to Decklink RGBXLE conversion kernels, alone and sliced over a WorkerPool as DecklinkVideoFrame does.
+
+#include "Benchmark.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Common/NonCopyable.h"
+#include "Common/WorkerPool.h"
+#include "Decklink/DecklinkConversionKernels.h"
+
+using namespace TVPlayR;
+
+struct KernelCase
+{
+	const char* name;
+	Decklink::CONVERSION_KERNEL kernel;
+};
+
+static void Report(const char* name, size_t bytes, double microseconds)
+{
+	std::printf("  %-16s %8.3f ms/frame %8.2f GB/s\n", name, microseconds / 1000.0, bytes / microseconds / 1000.0);
+}
+
+static void Run(int width, int height, const std::vector<KernelCase>& kernels, int max_threads)
+{
+	const size_t count = static_cast<size_t>(width) * height;
+	const size_t bytes = count * sizeof(uint32_t);
+	std::printf("%dx%d X2RGB10LE, single thread\n", width, height);
+	std::vector<uint8_t> random = Benchmarks::RandomBytes(bytes);
+	std::vector<uint32_t> source(count);
+	std::memcpy(source.data(), random.data(), bytes);
+	std::vector<uint32_t> expected(count);
+	std::vector<uint32_t> destination(count);
+	Decklink::ShiftPixelsScalar(source.data(), expected.data(), count);
+	for (const KernelCase& test : kernels)
+	{
+		// odd count exercises the tails
+		std::fill(destination.begin(), destination.end(), 0U);
+		test.kernel(source.data(), destination.data(), count - 7);
+		if (!std::equal(expected.begin(), expected.end() - 7, destination.begin()))
+		{
+			std::printf("  %s: result differs from the scalar kernel\n", test.name);
+			std::exit(1);
+		}
+		Report(test.name, bytes, Benchmarks::Measure([&] { test.kernel(source.data(), destination.data(), count); }));
+	}
+
+	const Decklink::CONVERSION_KERNEL kernel = Decklink::GetConversionKernel();
+	const int slices = std::max(1, height / DECKLINK_CONVERSION_ROWS_PER_SLICE);
+	const int slice_rows = (height + slices - 1) / slices;
+	std::printf("%dx%d X2RGB10LE, %d slices, selected kernel\n", width, height, slices);
+	for (int threads = 1; threads <= std::min(slices, max_threads); threads++)
+	{
+		Common::WorkerPool pool("benchmark", threads - 1);
+		double microseconds = Benchmarks::Measure([&]
+			{
+				pool.ParallelFor(slices, [&](size_t slice)
+					{
+						const int first_row = static_cast<int>(slice) * slice_rows;
+						const int rows = std::min(slice_rows, height - first_row);
+						if (rows > 0)
+							kernel(source.data() + static_cast<size_t>(first_row) * width, destination.data() + static_cast<size_t>(first_row) * width, static_cast<size_t>(rows) * width);
+					});
+			});
+		char name[32];
+		std::snprintf(name, sizeof(name), "%d thread%s", threads, threads > 1 ? "s" : "");
+		Report(name, bytes, microseconds);
+	}
+}
+
+// optional argument: maximum number of threads, defaults to the number of cores
+int main(int argc, char* argv[])
+{
+	const int max_threads = argc > 1 ? std::max(1, std::atoi(argv[1])) : static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+	std::vector<KernelCase> kernels = { { "scalar", Decklink::ShiftPixelsScalar } };
+#ifdef CPU_X64
+	const Common::CpuFeatures& features = Common::CpuFeatures::Instance();
+	kernels.push_back({ "sse2", Decklink::ShiftPixelsSse2 });
+	if (features.HasAvx2())
+		kernels.push_back({ "avx2", Decklink::ShiftPixelsAvx2 });
+	if (features.HasAvx512())
+		kernels.push_back({ "avx512", Decklink::ShiftPixelsAvx512 });
+#endif // CPU_X64
+	Run(1920, 1080, kernels, max_threads);
+	Run(3840, 2160, kernels, max_threads);
+	return 0;
+}
@@ -0,0 +1,183 @@
+// Common::Executor throughput and heap allocations per task: post(), begin_invoke() and the previous executor
+// (std::function in a BlockingCollection, packaged_task in a shared_ptr), and CPU time used by producers
+// blocked in invoke() on a full bounded queue, as on the overlay executors.
+// Executor.h depends on the precompiled header of the library, the headers it needs are included here in the same order.
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Common/NonCopyable.h"
+#include "Common/Exceptions.h"
+#include "Common/BlockingCollection.h"
+#include "Common/Task.h"
+#include "Common/MpscQueue.h"
+#include "Common/Executor.h"
+
+using namespace TVPlayR;
+
+#define TASKS_COUNT 1000000
+// tasks queued before the queue is drained: the stub node and the task of wait() take two of the pool nodes, so a burst never allocates
+#define BURST_TASKS (MPSC_QUEUE_NODE_POOL_SIZE - 2)
+#define BOUNDED_PRODUCERS 8 // more than the queue depth plus the task being run, so some of them always wait for room
+#define BOUNDED_TASKS_PER_PRODUCER 100
+
+static std::atomic_int64_t allocations = 0;
+
+void* operator new(size_t size)
+{
+	allocations++;
+	if (void* pointer = std::malloc(size ? size : 1))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+
+// Executor as it was before the Task queue
+class PreviousExecutor final
+{
+private:
+	Common::BlockingCollection<std::function<void()>> queue_;
+	std::thread thread_;
+
+	void run()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			if (queue_.take(task) != Common::BlockingCollectionStatus::Ok)
+				return;
+			task();
+		}
+	}
+
+public:
+	PreviousExecutor()
+		: thread_(&PreviousExecutor::run, this)
+	{ }
+
+	~PreviousExecutor()
+	{
+		queue_.complete_adding();
+		thread_.join();
+	}
+
+	template <typename Func>
+	auto begin_invoke(Func&& func)
+	{
+		using result_type = decltype(func());
+		auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<Func>(func));
+		queue_.try_add([=]() mutable { (*task)(); });
+		return task->get_future();
+	}
+};
+
+static double ProcessCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+	auto seconds = [](const FILETIME& time) { return ((static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 1e7; };
+	return seconds(kernel) + seconds(user);
+#else
+	return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// a frame pointer and few values, as captured by the lambdas of the outputs
+struct Payload
+{
+	std::shared_ptr<int> frame;
+	std::int64_t time;
+	int index;
+};
+
+// tasks are queued in bursts of given size and drained after every burst, the allocations are counted while the tasks are queued,
+// not in wait(), which allocates the future of its own task
+template <typename Submit, typename Wait>
+static void MeasureThroughput(const char* name, int burst, Submit&& submit, Wait&& wait)
+{
+	std::atomic_int64_t executed = 0;
+	Payload payload{ std::make_shared<int>(0), 0, 0 };
+	std::int64_t submit_allocations = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < TASKS_COUNT;)
+	{
+		const std::int64_t allocations_before = allocations;
+		for (const int burst_end = (std::min)(i + burst, TASKS_COUNT); i < burst_end; i++)
+		{
+			payload.index = i;
+			submit([&executed, payload] { executed += payload.index >= 0 ? 1 : 0; });
+		}
+		submit_allocations += allocations - allocations_before;
+		wait();
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const double allocations_per_task = static_cast<double>(submit_allocations) / TASKS_COUNT;
+	std::printf("  %-36s %8.2f Mtask/s %6.2f allocations/task%s\n", name, TASKS_COUNT / seconds / 1e6, allocations_per_task, executed == TASKS_COUNT ? "" : " (tasks lost)");
+}
+
+// producers call invoke() on a queue of depth 3 while the consumer takes 1 ms per task
+static void MeasureBlockedProducers()
+{
+	Common::Executor executor("bounded", 3);
+	const double cpu_before = ProcessCpuSeconds();
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> producers;
+	for (int i = 0; i < BOUNDED_PRODUCERS; i++)
+		producers.emplace_back([&executor]
+			{
+				for (int task = 0; task < BOUNDED_TASKS_PER_PRODUCER; task++)
+					executor.invoke([] { std::this_thread::sleep_for(std::chrono::milliseconds(1)); return 0; });
+			});
+	for (auto& producer : producers)
+		producer.join();
+	const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const double cpu = ProcessCpuSeconds() - cpu_before;
+	std::printf("  %d producers, %d tasks of 1 ms: %.2f s wall, %.3f s CPU (%.1f%% of one core)\n", BOUNDED_PRODUCERS, BOUNDED_PRODUCERS * BOUNDED_TASKS_PER_PRODUCER, wall, cpu, 100.0 * cpu / wall);
+}
+
+int main()
+{
+	// bursts that fit the node pool, as the executors of the player and outputs run, and all the tasks at once, which overflows it
+	for (int burst : { BURST_TASKS, TASKS_COUNT })
+	{
+		if (burst == TASKS_COUNT)
+			std::printf("%d tasks from one thread at once, unbounded queue (more than the %d nodes of the pool)\n", TASKS_COUNT, MPSC_QUEUE_NODE_POOL_SIZE);
+		else
+			std::printf("%d tasks from one thread in bursts of %d, drained after every burst, unbounded queue\n", TASKS_COUNT, burst);
+		{
+			PreviousExecutor executor;
+			MeasureThroughput("previous begin_invoke", burst, [&](auto&& task) { executor.begin_invoke(std::move(task)); }, [&] { executor.begin_invoke([] {}).wait(); });
+		}
+		{
+			Common::Executor executor("begin_invoke");
+			MeasureThroughput("Executor::begin_invoke", burst, [&](auto&& task) { executor.begin_invoke(std::move(task)); }, [&] { executor.wait(); });
+		}
+		{
+			Common::Executor executor("post");
+			MeasureThroughput("Executor::post", burst, [&](auto&& task) { executor.post(std::move(task)); }, [&] { executor.wait(); });
+		}
+	}
+	std::printf("invoke() blocked on a full bounded queue\n");
+	MeasureBlockedProducers();
+	return 0;
+}
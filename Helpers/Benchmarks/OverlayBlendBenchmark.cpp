@@ -0,0 +1,260 @@
+// Timecode overlay of Core/OverlayBlendKernels.h: text mask composed from the glyph atlas checked against the glyphs, the blending of
+// each pixel format checked against floating point source-over compositing, and the time of the mask update and blending per 1080p frame.
+
+#include "Benchmark.h"
+#include <cstdlib>
+#include <string>
+#include "Core/OverlayBlendKernels.h"
+
+using namespace TVPlayR;
+
+// the rectangle and glyph cells TimecodeOverlay uses for 1080p (glyph width measured for Tahoma Bold)
+#define FRAME_WIDTH 1920
+#define FRAME_HEIGHT 1080
+#define MASK_WIDTH 1080
+#define MASK_HEIGHT 180
+#define MASK_X 420
+#define CELL_WIDTH 92
+// the kernels round the colors and the background blend to integers before the foreground is blended
+#define REFERENCE_TOLERANCE 1.5
+
+static const std::string GLYPHS = "0123456789:;.-";
+
+struct ColorCase
+{
+	const char* name;
+	Core::OverlayColor background;
+	Core::OverlayColor foreground;
+};
+
+struct FormatCase
+{
+	const char* name;
+	int bytes_per_pixel;
+	int max_value;
+	void(*blend)(std::uint8_t* data, std::ptrdiff_t linesize, const std::uint8_t* mask, const ColorCase& colors);
+	// expected value of every component of the pixel, after the blend with the given coverage
+	void(*reference)(const std::uint8_t* source, const std::uint8_t* coverage, const ColorCase& colors, double* expected);
+	void(*unpack)(const std::uint8_t* pixel, int* components);
+	int components;
+};
+
+static double Alpha(int coverage, const Core::OverlayColor& color)
+{
+	return coverage / 255.0 * color.A / 255.0;
+}
+
+static double SourceOver(double destination, double background, double foreground, double background_alpha, double foreground_alpha)
+{
+	return (destination * (1.0 - background_alpha) + background * background_alpha) * (1.0 - foreground_alpha) + foreground * foreground_alpha;
+}
+
+// BT.709 studio range
+static void ToYCbCr(const Core::OverlayColor& color, double* ycbcr)
+{
+	const double y = 0.2126 * color.R + 0.7152 * color.G + 0.0722 * color.B;
+	ycbcr[0] = 16.0 + y * 219.0 / 255.0;
+	ycbcr[1] = 128.0 + (color.B - y) / 1.8556 * 224.0 / 255.0;
+	ycbcr[2] = 128.0 + (color.R - y) / 1.5748 * 224.0 / 255.0;
+}
+
+// a pair of pixels: Cb, Y0, Cr, Y1, chroma with the mean coverage of the pair
+static void UyvyReference(const std::uint8_t* source, const std::uint8_t* coverage, const ColorCase& colors, double* expected)
+{
+	double bg[3], fg[3];
+	ToYCbCr(colors.background, bg);
+	ToYCbCr(colors.foreground, fg);
+	const double background_alpha = colors.background.A / 255.0;
+	const double a0 = Alpha(coverage[0], colors.foreground);
+	const double a1 = Alpha(coverage[1], colors.foreground);
+	expected[0] = SourceOver(source[0], bg[1], fg[1], background_alpha, (a0 + a1) / 2.0);
+	expected[1] = SourceOver(source[1], bg[0], fg[0], background_alpha, a0);
+	expected[2] = SourceOver(source[2], bg[2], fg[2], background_alpha, (a0 + a1) / 2.0);
+	expected[3] = SourceOver(source[3], bg[0], fg[0], background_alpha, a1);
+}
+
+static void BgraReference(const std::uint8_t* source, const std::uint8_t* coverage, const ColorCase& colors, double* expected)
+{
+	const double background_alpha = colors.background.A / 255.0;
+	const double a = Alpha(coverage[0], colors.foreground);
+	expected[0] = SourceOver(source[0], colors.background.B, colors.foreground.B, background_alpha, a);
+	expected[1] = SourceOver(source[1], colors.background.G, colors.foreground.G, background_alpha, a);
+	expected[2] = SourceOver(source[2], colors.background.R, colors.foreground.R, background_alpha, a);
+	expected[3] = 255.0 * (a + (background_alpha + source[3] / 255.0 * (1.0 - background_alpha)) * (1.0 - a));
+}
+
+static void X2Rgb10Reference(const std::uint8_t* source, const std::uint8_t* coverage, const ColorCase& colors, double* expected)
+{
+	int components[4];
+	const std::uint32_t value = source[0] | (source[1] << 8) | (source[2] << 16) | (static_cast<std::uint32_t>(source[3]) << 24);
+	components[0] = value & 0x3FF;
+	components[1] = (value >> 10) & 0x3FF;
+	components[2] = (value >> 20) & 0x3FF;
+	components[3] = value >> 30;
+	const double background_alpha = colors.background.A / 255.0;
+	const double a = Alpha(coverage[0], colors.foreground);
+	const double scale = 1023.0 / 255.0;
+	expected[0] = SourceOver(components[0], colors.background.B * scale, colors.foreground.B * scale, background_alpha, a);
+	expected[1] = SourceOver(components[1], colors.background.G * scale, colors.foreground.G * scale, background_alpha, a);
+	expected[2] = SourceOver(components[2], colors.background.R * scale, colors.foreground.R * scale, background_alpha, a);
+	expected[3] = components[3];
+}
+
+static void UnpackBytes(const std::uint8_t* pixel, int* components)
+{
+	for (int i = 0; i < 4; i++)
+		components[i] = pixel[i];
+}
+
+static void UnpackX2Rgb10(const std::uint8_t* pixel, int* components)
+{
+	const std::uint32_t value = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16) | (static_cast<std::uint32_t>(pixel[3]) << 24);
+	components[0] = value & 0x3FF;
+	components[1] = (value >> 10) & 0x3FF;
+	components[2] = (value >> 20) & 0x3FF;
+	components[3] = value >> 30;
+}
+
+static const FormatCase FORMATS[] = {
+	{ "UYVY", 2, 255,
+		[](std::uint8_t* data, std::ptrdiff_t linesize, const std::uint8_t* mask, const ColorCase& colors) { Core::BlendUyvy(data, linesize, MASK_X, mask, MASK_WIDTH, MASK_HEIGHT, true, colors.background, colors.foreground); },
+		UyvyReference, UnpackBytes, 4 },
+	{ "BGRA", 4, 255,
+		[](std::uint8_t* data, std::ptrdiff_t linesize, const std::uint8_t* mask, const ColorCase& colors) { Core::BlendBgra(data, linesize, MASK_X, mask, MASK_WIDTH, MASK_HEIGHT, colors.background, colors.foreground); },
+		BgraReference, UnpackBytes, 4 },
+	{ "X2RGB10", 4, 1023,
+		[](std::uint8_t* data, std::ptrdiff_t linesize, const std::uint8_t* mask, const ColorCase& colors) { Core::BlendX2Rgb10(data, linesize, MASK_X, mask, MASK_WIDTH, MASK_HEIGHT, colors.background, colors.foreground); },
+		X2Rgb10Reference, UnpackX2Rgb10, 4 },
+};
+
+static void FillAtlas(Core::GlyphAtlas& atlas)
+{
+	for (size_t i = 0; i < GLYPHS.length(); i++)
+	{
+		std::vector<uint8_t> coverage = Benchmarks::RandomBytes(static_cast<size_t>(atlas.CellWidth()) * atlas.CellHeight(), static_cast<uint32_t>(i + 1));
+		// mostly transparent and opaque, like antialiased text, with the edges in between
+		for (auto& value : coverage)
+			value = value < 96 ? 0 : value > 160 ? 255 : value;
+		std::copy(coverage.begin(), coverage.end(), atlas.AddGlyph(GLYPHS[i]));
+	}
+}
+
+static bool CheckText(const Core::TextMask& mask, const Core::GlyphAtlas& atlas, const std::string& text)
+{
+	const int top = mask.CharacterTop();
+	for (size_t position = 0; position < text.length(); position++)
+	{
+		const std::uint8_t* glyph = atlas.GetGlyph(text[position]);
+		const int left = mask.CharacterLeft(position);
+		for (int y = 0; y < atlas.CellHeight(); y++)
+			for (int x = 0; x < atlas.CellWidth(); x++)
+				if (mask.Data()[(top + y) * mask.Width() + left + x] != glyph[y * atlas.CellWidth() + x])
+				{
+					std::printf("FAIL text mask \"%s\": character %zu, x %d, y %d\n", text.c_str(), position, x, y);
+					return false;
+				}
+	}
+	// nothing outside of the text
+	const int text_left = mask.CharacterLeft(0);
+	const int text_right = text_left + static_cast<int>(text.length()) * atlas.CellWidth();
+	for (int y = 0; y < mask.Height(); y++)
+		for (int x = 0; x < mask.Width(); x++)
+			if ((x < text_left || x >= text_right || y < top || y >= top + atlas.CellHeight()) && mask.Data()[y * mask.Width() + x])
+			{
+				std::printf("FAIL text mask \"%s\": coverage outside of the text at x %d, y %d\n", text.c_str(), x, y);
+				return false;
+			}
+	return true;
+}
+
+static bool CheckBlend(const FormatCase& format, const ColorCase& colors, const std::uint8_t* mask)
+{
+	const std::ptrdiff_t linesize = static_cast<std::ptrdiff_t>(FRAME_WIDTH) * format.bytes_per_pixel;
+	const std::vector<std::uint8_t> source = Benchmarks::RandomBytes(linesize * MASK_HEIGHT, 7);
+	std::vector<std::uint8_t> frame(source);
+	format.blend(frame.data(), linesize, mask, colors);
+	const int pixels_per_unit = format.bytes_per_pixel == 2 ? 2 : 1; // UYVY is checked in pairs
+	double max_difference = 0.0;
+	for (int row = 0; row < MASK_HEIGHT; row++)
+		for (int x = 0; x < FRAME_WIDTH; x += pixels_per_unit)
+		{
+			const std::ptrdiff_t offset = row * linesize + static_cast<std::ptrdiff_t>(x) * format.bytes_per_pixel;
+			int actual[4];
+			format.unpack(frame.data() + offset, actual);
+			double expected[4];
+			if (x < MASK_X || x >= MASK_X + MASK_WIDTH)
+			{
+				// outside of the rectangle the frame is not changed
+				int components[4];
+				format.unpack(source.data() + offset, components);
+				for (int i = 0; i < format.components; i++)
+					expected[i] = components[i];
+			}
+			else
+				format.reference(source.data() + offset, mask + static_cast<std::ptrdiff_t>(row) * MASK_WIDTH + x - MASK_X, colors, expected);
+			for (int i = 0; i < format.components; i++)
+			{
+				const double difference = std::abs(actual[i] - expected[i]);
+				max_difference = (std::max)(max_difference, difference);
+				if (difference > REFERENCE_TOLERANCE)
+				{
+					std::printf("FAIL %s, %s: row %d, pixel %d, component %d: %d, expected %.2f\n", format.name, colors.name, row, x, i, actual[i], expected[i]);
+					return false;
+				}
+			}
+		}
+	std::printf("  %-8s %-12s max difference from the reference %.2f of %d\n", format.name, colors.name, max_difference, format.max_value);
+	return true;
+}
+
+// the timecode changes on every frame, so the mask update is measured together with the blend
+static void Measure(const FormatCase& format, const ColorCase& colors, Core::TextMask& mask)
+{
+	const std::ptrdiff_t linesize = static_cast<std::ptrdiff_t>(FRAME_WIDTH) * format.bytes_per_pixel;
+	std::vector<std::uint8_t> frame = Benchmarks::RandomBytes(linesize * MASK_HEIGHT, 7);
+	int frame_number = 0;
+	const double microseconds = Benchmarks::Measure([&]
+		{
+			char text[16];
+			std::snprintf(text, sizeof(text), "10:%02d:%02d:%02d", frame_number / 1500 % 60, frame_number / 25 % 60, frame_number % 25);
+			frame_number++;
+			mask.Update(text);
+			format.blend(frame.data(), linesize, mask.Data(), colors);
+		});
+	std::printf("  %-8s %8.1f us/frame\n", format.name, microseconds);
+}
+
+int main()
+{
+	Core::GlyphAtlas atlas(CELL_WIDTH, MASK_HEIGHT);
+	FillAtlas(atlas);
+	Core::TextMask mask(atlas, MASK_WIDTH, MASK_HEIGHT);
+	int failed = 0;
+	// changed characters only, then a shorter and a longer text, which move all the characters
+	for (const std::string text : { "10:00:00:00", "10:00:00:01", "10:00:01;24", "0:01:24", "10:00:00:00" })
+	{
+		mask.Update(text);
+		if (!CheckText(mask, atlas, text))
+			failed++;
+	}
+
+	const ColorCase colors[] = {
+		{ "timecode", { 150, 16, 16, 16 }, { 255, 232, 232, 232 } },
+		{ "translucent", { 64, 200, 40, 120 }, { 128, 20, 240, 60 } },
+		{ "opaque", { 255, 0, 0, 255 }, { 255, 255, 255, 0 } },
+	};
+	std::printf("%dx%d mask at column %d of %d pixels wide rows\n", MASK_WIDTH, MASK_HEIGHT, MASK_X, FRAME_WIDTH);
+	for (const FormatCase& format : FORMATS)
+		for (const ColorCase& color : colors)
+			if (!CheckBlend(format, color, mask.Data()))
+				failed++;
+	if (failed)
+	{
+		std::printf("%d failed\n", failed);
+		return 1;
+	}
+	std::printf("text mask update and blending of a changing timecode\n");
+	for (const FormatCase& format : FORMATS)
+		Measure(format, colors[0], mask);
+	return 0;
+}
@@ -0,0 +1,77 @@
+// Throughput of the PixelConversion row kernels compared with swscale doing the same conversion of a whole frame.
+
+#include "Benchmark.h"
+#include "FFmpeg/PixelConversionKernels.h"
+#include <cstring>
+
+extern "C"
+{
+#include "libavutil/frame.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+}
+
+using namespace TVPlayR;
+
+static AVFrame* AllocFrame(int width, int height, AVPixelFormat format)
+{
+	AVFrame* frame = av_frame_alloc();
+	frame->width = width;
+	frame->height = height;
+	frame->format = format;
+	av_frame_get_buffer(frame, 0);
+	return frame;
+}
+
+static void ConvertFrame(FFmpeg::UYVY_ROW_KERNEL kernel, const AVFrame* source, AVFrame* destination)
+{
+	for (int row = 0; row < source->height; row++)
+		kernel(source->data[0] + row * source->linesize[0],
+			destination->data[0] + row * destination->linesize[0],
+			destination->data[1] + row * destination->linesize[1],
+			destination->data[2] + row * destination->linesize[2],
+			source->width);
+}
+
+static void Report(const char* name, int width, int height, double microseconds)
+{
+	std::printf("  %-24s %8.3f ms/frame %10.1f Mpixel/s\n", name, microseconds / 1000.0, width * static_cast<double>(height) / microseconds);
+}
+
+static void Run(int width, int height, AVPixelFormat destination_format, FFmpeg::UYVY_ROW_KERNEL scalar, FFmpeg::UYVY_ROW_KERNEL avx2)
+{
+	std::printf("UYVY422 -> %s, %dx%d\n", av_get_pix_fmt_name(destination_format), width, height);
+	AVFrame* source = AllocFrame(width, height, AV_PIX_FMT_UYVY422);
+	AVFrame* destination = AllocFrame(width, height, destination_format);
+	std::vector<uint8_t> bytes = Benchmarks::RandomBytes(static_cast<size_t>(width) * 2);
+	for (int row = 0; row < height; row++)
+		std::memcpy(source->data[0] + row * source->linesize[0], bytes.data(), bytes.size());
+	SwsContext* sws = sws_getContext(width, height, AV_PIX_FMT_UYVY422, width, height, destination_format, SWS_BICUBIC, nullptr, nullptr, nullptr);
+	Report("swscale", width, height, Benchmarks::Measure([&] { sws_scale_frame(sws, destination, source); }));
+	Report("scalar", width, height, Benchmarks::Measure([&] { ConvertFrame(scalar, source, destination); }));
+	if (avx2)
+		Report("avx2", width, height, Benchmarks::Measure([&] { ConvertFrame(avx2, source, destination); }));
+	sws_freeContext(sws);
+	av_frame_free(&source);
+	av_frame_free(&destination);
+}
+
+int main()
+{
+	FFmpeg::UYVY_ROW_KERNEL yuv422p_avx2 = nullptr;
+	FFmpeg::UYVY_ROW_KERNEL yuv422p10_avx2 = nullptr;
+#ifdef CPU_X64
+	if (Common::CpuFeatures::Instance().HasAvx2())
+	{
+		yuv422p_avx2 = FFmpeg::UyvyToYuv422pAvx2;
+		yuv422p10_avx2 = FFmpeg::UyvyToYuv422p10Avx2;
+	}
+#endif // CPU_X64
+	const int sizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+	for (const auto& size : sizes)
+	{
+		Run(size[0], size[1], AV_PIX_FMT_YUV422P, FFmpeg::UyvyToYuv422pScalar, yuv422p_avx2);
+		Run(size[0], size[1], AV_PIX_FMT_YUV422P10LE, FFmpeg::UyvyToYuv422p10Scalar, yuv422p10_avx2);
+	}
+	return 0;
+}
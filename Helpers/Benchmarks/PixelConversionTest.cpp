@@ -0,0 +1,122 @@
+// Bit-exactness of the PixelConversion row kernels against swscale, which SwScale uses when there is no kernel for the conversion.
+// Every kernel is compared with sws_scale_frame() output for random UYVY frames, for the widths which exercise the scalar tails of the AVX2 loops.
+
+#include "Benchmark.h"
+#include "FFmpeg/PixelConversionKernels.h"
+#include <cstdlib>
+#include <cstring>
+
+extern "C"
+{
+#include "libavutil/frame.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+}
+
+using namespace TVPlayR;
+
+#define TEST_FRAME_HEIGHT 8
+
+struct KernelCase
+{
+	const char* name;
+	FFmpeg::UYVY_ROW_KERNEL kernel;
+	AVPixelFormat destination_format;
+};
+
+static AVFrame* AllocFrame(int width, int height, AVPixelFormat format)
+{
+	AVFrame* frame = av_frame_alloc();
+	frame->width = width;
+	frame->height = height;
+	frame->format = format;
+	if (av_frame_get_buffer(frame, 0) < 0)
+	{
+		std::fprintf(stderr, "frame not allocated\n");
+		std::exit(2);
+	}
+	return frame;
+}
+
+static bool ComparePlanes(const AVFrame* expected, const AVFrame* actual, const char* name, int flags)
+{
+	const AVPixFmtDescriptor* descriptor = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(expected->format));
+	const int bytes_per_sample = descriptor->comp[0].depth > 8 ? 2 : 1;
+	for (int plane = 0; plane < 3; plane++)
+	{
+		const int width = plane == 0 ? expected->width : expected->width / 2;
+		for (int row = 0; row < expected->height; row++)
+		{
+			const uint8_t* expected_row = expected->data[plane] + row * expected->linesize[plane];
+			const uint8_t* actual_row = actual->data[plane] + row * actual->linesize[plane];
+			if (std::memcmp(expected_row, actual_row, static_cast<size_t>(width) * bytes_per_sample) == 0)
+				continue;
+			for (int x = 0; x < width * bytes_per_sample; x++)
+				if (expected_row[x] != actual_row[x])
+				{
+					std::printf("FAIL %s, width %d, flags 0x%x: plane %d, row %d, byte %d: swscale %d, kernel %d\n", name, expected->width, flags, plane, row, x, expected_row[x], actual_row[x]);
+					return false;
+				}
+		}
+	}
+	return true;
+}
+
+static bool TestKernel(const KernelCase& test, int width, int flags)
+{
+	AVFrame* source = AllocFrame(width, TEST_FRAME_HEIGHT, AV_PIX_FMT_UYVY422);
+	AVFrame* expected = AllocFrame(width, TEST_FRAME_HEIGHT, test.destination_format);
+	AVFrame* actual = AllocFrame(width, TEST_FRAME_HEIGHT, test.destination_format);
+	for (int row = 0; row < TEST_FRAME_HEIGHT; row++)
+	{
+		std::vector<uint8_t> bytes = Benchmarks::RandomBytes(static_cast<size_t>(width) * 2, width * TEST_FRAME_HEIGHT + row);
+		std::memcpy(source->data[0] + row * source->linesize[0], bytes.data(), bytes.size());
+	}
+	SwsContext* sws = sws_getContext(width, TEST_FRAME_HEIGHT, AV_PIX_FMT_UYVY422, width, TEST_FRAME_HEIGHT, test.destination_format, flags, nullptr, nullptr, nullptr);
+	bool result = sws && sws_scale_frame(sws, expected, source) >= 0;
+	if (!result)
+		std::printf("FAIL %s, width %d, flags 0x%x: swscale failed\n", test.name, width, flags);
+	for (int row = 0; result && row < TEST_FRAME_HEIGHT; row++)
+		test.kernel(source->data[0] + row * source->linesize[0],
+			actual->data[0] + row * actual->linesize[0],
+			actual->data[1] + row * actual->linesize[1],
+			actual->data[2] + row * actual->linesize[2],
+			width);
+	result = result && ComparePlanes(expected, actual, test.name, flags);
+	sws_freeContext(sws);
+	av_frame_free(&source);
+	av_frame_free(&expected);
+	av_frame_free(&actual);
+	return result;
+}
+
+int main()
+{
+	std::vector<KernelCase> cases = {
+		{ "UyvyToYuv422pScalar", FFmpeg::UyvyToYuv422pScalar, AV_PIX_FMT_YUV422P },
+		{ "UyvyToYuv422p10Scalar", FFmpeg::UyvyToYuv422p10Scalar, AV_PIX_FMT_YUV422P10LE },
+	};
+#ifdef CPU_X64
+	if (Common::CpuFeatures::Instance().HasAvx2())
+	{
+		cases.push_back({ "UyvyToYuv422pAvx2", FFmpeg::UyvyToYuv422pAvx2, AV_PIX_FMT_YUV422P });
+		cases.push_back({ "UyvyToYuv422p10Avx2", FFmpeg::UyvyToYuv422p10Avx2, AV_PIX_FMT_YUV422P10LE });
+	}
+	else
+		std::printf("AVX2 not available, only the scalar kernels are tested\n");
+#endif // CPU_X64
+	// SwScale bypasses the context whatever algorithm the player is set to, so all of them have to give the same result
+	const int flags[] = { SWS_FAST_BILINEAR, SWS_BILINEAR, SWS_BICUBIC, SWS_LANCZOS, SWS_SPLINE };
+	const int widths[] = { 2, 30, 32, 34, 62, 64, 720, 1280, 1918, 1920, 3840 };
+	int failed = 0;
+	int passed = 0;
+	for (const KernelCase& test : cases)
+		for (int flag : flags)
+			for (int width : widths)
+				if (TestKernel(test, width, flag))
+					passed++;
+				else
+					failed++;
+	std::printf("%d passed, %d failed\n", passed, failed);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+// 1080i50 to 2160p50 upconversion throughput against the thread count, with the filter graph PlayerScaler builds for it
+// (bwdif and scale, sliced over the graph threads) and with the swscale context SwScale uses (threads option, sws_scale_frame).
+// The player keeps up when the output frame rate is at least 50.
+
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+extern "C"
+{
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+#include "libavutil/frame.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+}
+
+using namespace TVPlayR;
+
+#define INPUT_WIDTH 1920
+#define INPUT_HEIGHT 1080
+#define OUTPUT_WIDTH 3840
+#define OUTPUT_HEIGHT 2160
+#define INPUT_FORMAT AV_PIX_FMT_YUV422P10LE
+#define OUTPUT_FORMAT AV_PIX_FMT_UYVY422
+#define SOURCE_FRAMES 8 // distinct frames, so the deinterlacer doesn't work on identical fields
+#define MEASURED_FRAMES 50 // input frames per measurement, two seconds of 1080i50
+
+static void Check(int result, const char* what)
+{
+	if (result < 0)
+	{
+		std::fprintf(stderr, "%s failed: %d\n", what, result);
+		std::exit(2);
+	}
+}
+
+static std::vector<AVFrame*> CreateSourceFrames()
+{
+	std::vector<AVFrame*> frames;
+	for (int i = 0; i < SOURCE_FRAMES; i++)
+	{
+		AVFrame* frame = av_frame_alloc();
+		frame->width = INPUT_WIDTH;
+		frame->height = INPUT_HEIGHT;
+		frame->format = INPUT_FORMAT;
+		frame->interlaced_frame = 1;
+		frame->top_field_first = 1;
+		frame->color_range = AVCOL_RANGE_MPEG;
+		frame->colorspace = AVCOL_SPC_BT709;
+		Check(av_frame_get_buffer(frame, 0), "av_frame_get_buffer");
+		for (int plane = 0; plane < 3; plane++)
+		{
+			const int width = plane == 0 ? INPUT_WIDTH : INPUT_WIDTH / 2;
+			for (int row = 0; row < INPUT_HEIGHT; row++)
+			{
+				std::vector<uint8_t> bytes = Benchmarks::RandomBytes(width * 2, i * 10000 + plane * INPUT_HEIGHT + row);
+				uint16_t* samples = reinterpret_cast<uint16_t*>(frame->data[plane] + row * frame->linesize[plane]);
+				for (int x = 0; x < width; x++)
+					samples[x] = static_cast<uint16_t>(64 + (bytes[2 * x] | (bytes[2 * x + 1] << 8)) % 877); // limited range 10-bit
+			}
+		}
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+// the filter PlayerScaler::GetFilterString() gives for interlaced input of half the output frame rate
+static std::string FilterString(const char* algorithm)
+{
+	return std::string("bwdif,scale=w=") + std::to_string(OUTPUT_WIDTH) + ":h=" + std::to_string(OUTPUT_HEIGHT) + ":flags=" + algorithm + ":out_color_matrix=bt709,format=" + std::to_string(static_cast<int>(OUTPUT_FORMAT));
+}
+
+// the same graph setup as FilterGraphCache::Build()
+static double MeasureFilterGraph(const std::vector<AVFrame*>& source, int threads, const char* algorithm)
+{
+	AVFilterGraph* graph = avfilter_graph_alloc();
+	graph->nb_threads = threads;
+	graph->thread_type = AVFILTER_THREAD_SLICE;
+	graph->scale_sws_opts = av_strdup((std::string("flags=") + algorithm).c_str());
+	AVFilterContext* buffer_source = nullptr;
+	AVFilterContext* buffer_sink = nullptr;
+	char args[512];
+	std::snprintf(args, sizeof(args), "video_size=%dx%d:pix_fmt=%d:time_base=1/25:pixel_aspect=1/1", INPUT_WIDTH, INPUT_HEIGHT, INPUT_FORMAT);
+	Check(avfilter_graph_create_filter(&buffer_source, avfilter_get_by_name("buffer"), "vin", args, nullptr, graph), "buffer");
+	Check(avfilter_graph_create_filter(&buffer_sink, avfilter_get_by_name("buffersink"), "vout", nullptr, nullptr, graph), "buffersink");
+	AVFilterInOut* outputs = avfilter_inout_alloc();
+	AVFilterInOut* inputs = avfilter_inout_alloc();
+	outputs->name = av_strdup("in");
+	outputs->filter_ctx = buffer_source;
+	inputs->name = av_strdup("out");
+	inputs->filter_ctx = buffer_sink;
+	Check(avfilter_graph_parse(graph, FilterString(algorithm).c_str(), inputs, outputs, nullptr), "avfilter_graph_parse");
+	Check(avfilter_graph_config(graph, nullptr), "avfilter_graph_config");
+
+	AVFrame* input = av_frame_alloc();
+	AVFrame* output = av_frame_alloc();
+	int64_t pts = 0;
+	int output_frames = 0;
+	auto push = [&](int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			Check(av_frame_ref(input, source[pts % SOURCE_FRAMES]), "av_frame_ref");
+			input->pts = pts++;
+			Check(av_buffersrc_add_frame(buffer_source, input), "av_buffersrc_add_frame");
+			while (av_buffersink_get_frame(buffer_sink, output) >= 0)
+			{
+				output_frames++;
+				av_frame_unref(output);
+			}
+		}
+	};
+	push(4); // bwdif needs the next frame before it outputs one
+	output_frames = 0;
+	const auto start = std::chrono::steady_clock::now();
+	push(MEASURED_FRAMES);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	av_frame_free(&input);
+	av_frame_free(&output);
+	avfilter_graph_free(&graph);
+	return output_frames / seconds;
+}
+
+// the same context setup as SwScale, progressive frames scaled without the filter graph
+static double MeasureSwScale(const std::vector<AVFrame*>& source, int threads, int flags)
+{
+	SwsContext* sws = sws_alloc_context();
+	Check(av_opt_set_int(sws, "srcw", INPUT_WIDTH, 0), "srcw");
+	Check(av_opt_set_int(sws, "srch", INPUT_HEIGHT, 0), "srch");
+	Check(av_opt_set_int(sws, "src_format", INPUT_FORMAT, 0), "src_format");
+	Check(av_opt_set_int(sws, "dstw", OUTPUT_WIDTH, 0), "dstw");
+	Check(av_opt_set_int(sws, "dsth", OUTPUT_HEIGHT, 0), "dsth");
+	Check(av_opt_set_int(sws, "dst_format", OUTPUT_FORMAT, 0), "dst_format");
+	Check(av_opt_set_int(sws, "sws_flags", flags, 0), "sws_flags");
+	Check(av_opt_set_int(sws, "threads", threads, 0), "threads");
+	Check(sws_init_context(sws, nullptr, nullptr), "sws_init_context");
+	AVFrame* output = av_frame_alloc();
+	output->width = OUTPUT_WIDTH;
+	output->height = OUTPUT_HEIGHT;
+	output->format = OUTPUT_FORMAT;
+	Check(av_frame_get_buffer(output, 0), "av_frame_get_buffer");
+	int index = 0;
+	const double microseconds = Benchmarks::Measure([&] { Check(sws_scale_frame(sws, output, source[index++ % SOURCE_FRAMES]), "sws_scale_frame"); });
+	av_frame_free(&output);
+	sws_freeContext(sws);
+	return 1e6 / microseconds;
+}
+
+// optional argument: maximum number of threads, defaults to the number of cores
+int main(int argc, char* argv[])
+{
+	const int max_threads = argc > 1 ? std::max(1, std::atoi(argv[1])) : static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+	std::vector<AVFrame*> source = CreateSourceFrames();
+	std::printf("%dx%d %s interlaced 25 fps -> %dx%d %s 50 fps\n", INPUT_WIDTH, INPUT_HEIGHT, av_get_pix_fmt_name(INPUT_FORMAT), OUTPUT_WIDTH, OUTPUT_HEIGHT, av_get_pix_fmt_name(OUTPUT_FORMAT));
+	const struct { const char* name; int flags; } algorithms[] = { { "bilinear", SWS_BILINEAR }, { "bicubic", SWS_BICUBIC }, { "lanczos", SWS_LANCZOS } };
+	for (const auto& algorithm : algorithms)
+	{
+		std::printf("%s\n  threads   filter graph fps   swscale fps\n", algorithm.name);
+		for (int threads = 1; threads <= max_threads; threads++)
+			std::printf("  %7d %18.1f %13.1f\n", threads, MeasureFilterGraph(source, threads, algorithm.name), MeasureSwScale(source, threads, algorithm.flags));
+	}
+	for (AVFrame* frame : source)
+		av_frame_free(&frame);
+	return 0;
+}
@@ -49,7 +49,10 @@ namespace StudioTVPlayer
             CrashLogger.SaveDump(e.ToString());
 #else
             if (isTerminating)
+            {
+                CrashLogger.SaveDump(e?.ToString() ?? message);
                 MessageBox.Show(message, "Error - terminating application", MessageBoxButton.OK, MessageBoxImage.Error);
+            }
             else
                 MessageBox.Show(message, "Error", MessageBoxButton.OK, MessageBoxImage.Error);
 #endif
@@ -13,6 +13,10 @@ namespace StudioTVPlayer.Providers
             using (var stream = File.CreateText(fileName))
             {
                 stream.Write(text);
+                stream.WriteLine();
+                stream.WriteLine("Recent player events:");
+                foreach (var line in TVPlayR.DebugLog.Lines)
+                    stream.WriteLine(line);
                 stream.Close();
             }
         }
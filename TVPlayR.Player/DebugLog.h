@@ -0,0 +1,33 @@
+#pragma once
+#include "stdafx.h"
+
+using namespace System;
+
+namespace TVPlayR {
+
+	/// <summary>
+	/// Access to the structured event log recorded by the players, also in release builds.
+	/// </summary>
+	public ref class DebugLog sealed
+	{
+	public:
+		// recent events, oldest first
+		static property array<String^>^ Lines
+		{
+			array<String^>^ get()
+			{
+				std::vector<Common::DebugLogEntry> entries = Common::DebugLog::Instance().Snapshot();
+				array<String^>^ lines = gcnew array<String^>(static_cast<int>(entries.size()));
+				for (int i = 0; i < lines->Length; i++)
+					lines[i] = gcnew String(Common::DebugLog::Format(entries[i]).c_str());
+				return lines;
+			}
+		}
+
+		// writes the events to the debugger output
+		static void Dump()
+		{
+			Common::DebugLog::Instance().Dump();
+		}
+	};
+}
@@ -5,6 +5,7 @@
 #include "FFmpeg/ThumbnailFilter.h"
 #include "FFmpeg/FFmpegInput.h"
 #include "FieldOrder.h"
+#include "Player.h"
 
 namespace TVPlayR {
 
@@ -50,6 +51,11 @@ namespace TVPlayR {
 		REWRAP_EXCEPTION(return GetFFmpegInput()->Seek(time.Ticks / 10);)
 	}
 
+	bool FileInput::Prime(Player^ player, int framesCount)
+	{
+		REWRAP_EXCEPTION(return GetFFmpegInput()->Prime(player->GetNativePlayer(), framesCount);)
+	}
+
 	void FileInput::Play()
 	{
 		REWRAP_EXCEPTION(GetFFmpegInput()->Play();)
@@ -82,6 +88,20 @@ namespace TVPlayR {
 	
 	bool FileInput::HaveAlphaChannel::get() { return GetFFmpegInput()->HaveAlphaChannel(); }
 
+	TimeSpan FileInput::TimeToFirstFrame::get()
+	{
+		std::int64_t time = GetFFmpegInput()->GetStatistics().TimeToFirstFrame;
+		return time < 0 ? TimeSpan::Zero : TimeSpan(time * 10);
+	}
+
+	Int64 FileInput::ClipCacheBudget::get() { return static_cast<Int64>(FFmpeg::FFmpegInput::GetClipCacheStatistics().Budget); }
+
+	void FileInput::ClipCacheBudget::set(Int64 bytes) { FFmpeg::FFmpegInput::SetClipCacheBudget(static_cast<size_t>(Math::Max(bytes, 0LL))); }
+
+	double FileInput::ClipCacheHitRate::get() { return FFmpeg::FFmpegInput::GetClipCacheStatistics().HitRate(); }
+
+	Int64 FileInput::ClipCacheResidentBytes::get() { return static_cast<Int64>(FFmpeg::FFmpegInput::GetClipCacheStatistics().ResidentBytes); }
+
 	void FileInput::IsLoop::set(bool isLoop)
 	{
 		if (isLoop == _isLoop)
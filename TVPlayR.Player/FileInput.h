@@ -10,6 +10,7 @@ using namespace System::Runtime::InteropServices;
 namespace TVPlayR {
 
 	value class Rational;
+	ref class Player;
 	enum class FieldOrder;
 	namespace FFmpeg {
 		class FFmpegInput;
@@ -23,6 +24,7 @@ namespace TVPlayR {
 		~FileInput();
 		!FileInput();
 		bool Seek(TimeSpan time);
+		bool Prime(Player^ player, int framesCount);
 		void Play();
 		void Pause();
 		property TimeSpan AudioDuration { TimeSpan get(); }
@@ -37,6 +39,14 @@ namespace TVPlayR {
 		property TVPlayR::Rational FrameRate { TVPlayR::Rational get(); }
 		property int AudioChannelCount { int get(); }
 		property bool HaveAlphaChannel { bool get(); }
+		property TimeSpan TimeToFirstFrame { TimeSpan get(); }
+		static property Int64 ClipCacheBudget
+		{
+			Int64 get();
+			void set(Int64 bytes);
+		}
+		static property double ClipCacheHitRate { double get(); }
+		static property Int64 ClipCacheResidentBytes { Int64 get(); }
 		property bool IsLoop 
 		{
 			bool get() { return _isLoop; }
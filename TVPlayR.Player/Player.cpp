@@ -129,4 +129,20 @@ namespace TVPlayR {
 		_volume = volume;
 	}
 
+	TimeSpan Player::TransitionCrossfade::get()
+	{
+		return _transitionCrossfade;
+	}
+
+	void Player::TransitionCrossfade::set(TimeSpan duration)
+	{
+		REWRAP_EXCEPTION(_player->SetTransitionCrossfade(duration.Ticks / 10);)
+		_transitionCrossfade = duration;
+	}
+
+	Int64 Player::TransitionLostFrames::get()
+	{
+		return _player->GetTransitionStatistics().LostFrames;
+	}
+
 }
\ No newline at end of file
@@ -22,6 +22,7 @@ namespace TVPlayR {
 	private:
 		Core::Player* const _player;
 		float _volume = 1.0f;
+		TimeSpan _transitionCrossfade;
 		VideoFormat^ _videoFormat;
 		const PixelFormat _pixelFormat;
 		delegate void AudioVolumeDelegate(std::vector<float>&, float);
@@ -43,6 +44,8 @@ namespace TVPlayR {
 		void LoadNext(InputBase^ file);
 		void Clear();
 		property float Volume { float get(); void set(float volume); }
+		property TimeSpan TransitionCrossfade { TimeSpan get(); void set(TimeSpan duration); }
+		property Int64 TransitionLostFrames { Int64 get(); }
 		property TVPlayR::VideoFormat^ VideoFormat { TVPlayR::VideoFormat^ get() { return _videoFormat; }}
 		property TVPlayR::PixelFormat PixelFormat { TVPlayR::PixelFormat get() { return _pixelFormat; } }
 		event EventHandler<AudioVolumeEventArgs^>^ AudioVolume;
@@ -0,0 +1,84 @@
+#pragma once
+#include "NonCopyable.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CPU_X64
+#endif
+
+// GCC and Clang need the instruction set enabled for each function using its intrinsics, MSVC allows them anywhere
+#ifdef _MSC_VER
+#define CPU_TARGET(isa)
+#else
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace TVPlayR {
+	namespace Common {
+
+/// <summary>
+/// Instruction set extensions available both in the CPU and enabled by the OS, detected once per process.
+/// SSE2 is always present on x64, so it's not reported.
+/// </summary>
+class CpuFeatures final : Common::NonCopyable
+{
+private:
+	bool avx2_ = false;
+	bool avx512_ = false;
+
+	static void Cpuid(int info[4], int leaf, int subleaf)
+	{
+#ifdef _MSC_VER
+		__cpuidex(info, leaf, subleaf);
+#else
+		__cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+	}
+
+	static unsigned long long Xgetbv()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+	}
+
+	CpuFeatures()
+	{
+		int info[4] = { 0 };
+		Cpuid(info, 0, 0);
+		const int max_leaf = info[0];
+		if (max_leaf < 7)
+			return;
+		Cpuid(info, 1, 0);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx)
+			return;
+		const unsigned long long xcr0 = Xgetbv();
+		const bool ymm_enabled = (xcr0 & 0x06) == 0x06; // XMM and YMM state
+		const bool zmm_enabled = (xcr0 & 0xE6) == 0xE6; // opmask, upper ZMM and high ZMM state too
+		Cpuid(info, 7, 0);
+		avx2_ = ymm_enabled && (info[1] & (1 << 5)) != 0;
+		avx512_ = avx2_ && zmm_enabled && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0; // AVX-512F and AVX-512BW
+	}
+
+public:
+	static const CpuFeatures& Instance()
+	{
+		static CpuFeatures instance;
+		return instance;
+	}
+
+	bool HasAvx2() const { return avx2_; }
+	bool HasAvx512() const { return avx512_; }
+};
+
+}}
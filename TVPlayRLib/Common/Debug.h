@@ -1,9 +1,17 @@
 #pragma once
 
 #define DebugPrintLineIf(condition, severity, message) \
-if (condition) \
+if (!(IsDebugPrinted(severity) && (condition))) {} else \
 	DebugPrintLine(severity, message)
 
+// the message expression is evaluated only when the line is going to be printed
+#define DebugPrintLineLazy(severity, message) \
+if (!IsDebugPrinted(severity)) {} else \
+	DebugPrintLine(severity, message)
+
+#define DEBUG_LOG_CAPACITY 4096 // must be power of 2
+#define DEBUG_LOG_SOURCE_LENGTH 32
+
 namespace TVPlayR {
 	namespace Common {
 
@@ -17,6 +25,93 @@ enum class DebugSeverity
 	fatal
 };
 
+struct DebugLogEntry
+{
+	std::int64_t Time; // microseconds of steady clock
+	enum DebugSeverity Severity;
+	char Source[DEBUG_LOG_SOURCE_LENGTH];
+	const char* Event; // string literal
+	std::int64_t Value1;
+	std::int64_t Value2;
+};
+
+/// <summary>
+/// Fixed size, allocation-free ring of structured events, usable in release builds.
+/// Entries are formatted only when the log is read.
+/// </summary>
+class DebugLog final : NonCopyable
+{
+private:
+	struct Slot
+	{
+		std::atomic_uint64_t sequence = 0ULL; // odd while the entry is being written
+		DebugLogEntry entry;
+	};
+	std::atomic_uint64_t head_ = 0ULL;
+	Slot slots_[DEBUG_LOG_CAPACITY];
+	DebugLog() = default;
+
+public:
+	static DebugLog& Instance()
+	{
+		static DebugLog instance;
+		return instance;
+	}
+
+	void Record(enum DebugSeverity severity, const char* source, const char* event, std::int64_t value1, std::int64_t value2)
+	{
+		std::uint64_t index = head_.fetch_add(1ULL, std::memory_order_relaxed);
+		Slot& slot = slots_[index & (DEBUG_LOG_CAPACITY - 1)];
+		slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.entry.Time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		slot.entry.Severity = severity;
+		size_t length = 0;
+		for (; length < DEBUG_LOG_SOURCE_LENGTH - 1 && source[length]; length++)
+			slot.entry.Source[length] = source[length];
+		slot.entry.Source[length] = '\0';
+		slot.entry.Event = event;
+		slot.entry.Value1 = value1;
+		slot.entry.Value2 = value2;
+		slot.sequence.store(index * 2 + 2, std::memory_order_release);
+	}
+
+	// returns entries in order they were recorded, skipping ones being overwritten at the moment
+	std::vector<DebugLogEntry> Snapshot() const
+	{
+		std::vector<DebugLogEntry> result;
+		std::uint64_t head = head_.load(std::memory_order_acquire);
+		std::uint64_t first = head > DEBUG_LOG_CAPACITY ? head - DEBUG_LOG_CAPACITY : 0ULL;
+		result.reserve(static_cast<size_t>(head - first));
+		for (std::uint64_t index = first; index < head; index++)
+		{
+			const Slot& slot = slots_[index & (DEBUG_LOG_CAPACITY - 1)];
+			if (slot.sequence.load(std::memory_order_acquire) != index * 2 + 2)
+				continue;
+			DebugLogEntry entry = slot.entry;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == index * 2 + 2)
+				result.push_back(entry);
+		}
+		return result;
+	}
+
+	static std::string Format(const DebugLogEntry& entry)
+	{
+		static const char* severity_names[] = { "trace", "debug", "info", "warning", "error", "fatal" };
+		char line[256];
+		snprintf(line, sizeof(line), "%lld [%s] %s: %s %lld %lld", static_cast<long long>(entry.Time), severity_names[static_cast<int>(entry.Severity)], entry.Source, entry.Event, static_cast<long long>(entry.Value1), static_cast<long long>(entry.Value2));
+		return line;
+	}
+
+	// writes the entries to the debugger output
+	void Dump() const
+	{
+		for (const auto& entry : Snapshot())
+			OutputDebugStringA((Format(entry) + "\n").c_str());
+	}
+};
+
 class DebugTarget
 {
 private:
@@ -43,8 +138,24 @@ protected:
 #endif // DEBUG
 	}
 
+	inline bool IsDebugPrinted(enum DebugSeverity severity) const
+	{
+#ifdef DEBUG
+		return severity >= severity_;
+#else
+		return false;
+#endif // DEBUG
+	}
+
+	// cheap, allocation-free alternative to DebugPrintLine, recorded in release builds too
+	inline void DebugRecord(enum DebugSeverity severity, const char* event, std::int64_t value1 = 0LL, std::int64_t value2 = 0LL)
+	{
+		if (severity >= severity_)
+			DebugLog::Instance().Record(severity, name_.c_str(), event, value1, value2);
+	}
+
 	inline enum DebugSeverity DebugSeverity() const { return severity_; }
 };
 
-}	
+}
 }
@@ -24,7 +24,7 @@ namespace TVPlayR {
     {
     private:
         Executor(const Executor&);
-        BlockingCollection<std::function<void()>>  queue_;
+        MpscQueue<Task>   queue_;
         std::atomic_bool  is_running_ = true;
         std::thread       thread_;
 
@@ -44,6 +44,15 @@ namespace TVPlayR {
             thread_.join();
         }
 
+        // fire-and-forget, doesn't create a future. Returns false if the task was not queued.
+        template <typename Func>
+        bool post(Func&& func)
+        {
+            if (!is_running_)
+                THROW_EXCEPTION("Executor: not running.");
+            return queue_.try_add(Task(std::forward<Func>(func))) == BlockingCollectionStatus::Ok;
+        }
+
         template <typename Func>
         auto begin_invoke(Func&& func)
         {
@@ -52,9 +61,10 @@ namespace TVPlayR {
 
             using result_type = decltype(func());
 
-            auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<Func>(func));
-            queue_.try_add([=]() mutable { (*task)(); });
-            return task->get_future();
+            std::packaged_task<result_type()> task(std::forward<Func>(func));
+            auto future = task.get_future();
+            queue_.try_add(Task(std::move(task)));
+            return future;
         }
 
         template <typename Func>
@@ -66,9 +76,10 @@ namespace TVPlayR {
                 THROW_EXCEPTION("Executor: not running.");
 
             using result_type = decltype(func());
-            auto task = std::make_shared<std::packaged_task<result_type()>>(std::forward<Func>(func));
-            queue_.add([=]() mutable { (*task)(); });
-            return task->get_future().get();
+            std::packaged_task<result_type()> task(std::forward<Func>(func));
+            auto future = task.get_future();
+            queue_.add(Task(std::move(task)));
+            return future.get();
         }
 
         template <typename Func>
@@ -97,6 +108,8 @@ namespace TVPlayR {
 
         bool is_running() const { return is_running_; }
 
+        size_t queue_size() const { return queue_.size(); }
+
         bool is_current() const { return std::this_thread::get_id() == thread_.get_id(); }
 
     private:
@@ -105,12 +118,11 @@ namespace TVPlayR {
 #ifdef DEBUG
             SetThreadName(::GetCurrentThreadId(), name.c_str());
 #endif
-            std::function<void()> task;
             while (is_running_) {
                 try {
-                    std::function<void()> task;
+                    Task task;
                     auto status = queue_.take(task);
-                    if (status == BlockingCollectionStatus::AddingCompleted)
+                    if (status != BlockingCollectionStatus::Ok)
                         return;
                     task();
                 }
@@ -0,0 +1,201 @@
+#pragma once
+
+#define MPSC_QUEUE_NODE_POOL_SIZE 64
+
+namespace TVPlayR {
+	namespace Common {
+
+/// <summary>
+/// Lock-free queue for many producer threads and one consumer thread, optionally bounded.
+/// Producers never wait on a lock held by the consumer; the mutex is touched only to wake up a sleeping consumer,
+/// or producers sleeping in add() until a full bounded queue has room.
+/// Nodes are taken from a preallocated pool, the heap is used only when more than MPSC_QUEUE_NODE_POOL_SIZE - 1 items are queued (one node is the stub).
+/// </summary>
+template <typename T>
+class MpscQueue final : NonCopyable
+{
+private:
+	static constexpr std::uint32_t no_node = UINT32_MAX;
+
+	struct Node
+	{
+		std::atomic<Node*> next = nullptr;
+		T value;
+		std::uint32_t pool_index = no_node;
+		std::atomic_uint32_t free_next = no_node;
+	};
+
+	const size_t capacity_;
+	std::unique_ptr<Node[]> node_pool_;
+	std::atomic_uint64_t free_nodes_; // index of the first free pool node in low bits, ABA tag in high bits
+	std::atomic<Node*> head_; // last added node, shared by producers
+	Node* tail_; // already consumed stub node, owned by the consumer
+	std::atomic_size_t size_ = 0;
+	std::atomic_bool adding_completed_ = false;
+	std::atomic_bool consumer_waiting_ = false;
+	std::atomic_int producers_waiting_ = 0;
+	std::mutex mutex_;
+	std::condition_variable wake_up_;
+	std::condition_variable room_available_;
+
+	void wake_consumer()
+	{
+		if (!consumer_waiting_.exchange(false))
+			return;
+		std::lock_guard<std::mutex> lock(mutex_);
+		wake_up_.notify_one();
+	}
+
+	void wake_producers()
+	{
+		if (!producers_waiting_)
+			return;
+		std::lock_guard<std::mutex> lock(mutex_);
+		room_available_.notify_all();
+	}
+
+	static std::uint64_t free_list(std::uint64_t previous, std::uint32_t index) { return (((previous >> 32) + 1) << 32) | index; }
+
+	Node* acquire_node()
+	{
+		std::uint64_t head = free_nodes_.load(std::memory_order_acquire);
+		while (static_cast<std::uint32_t>(head) != no_node)
+		{
+			Node& node = node_pool_[static_cast<std::uint32_t>(head)];
+			if (free_nodes_.compare_exchange_weak(head, free_list(head, node.free_next.load(std::memory_order_relaxed)), std::memory_order_acquire, std::memory_order_acquire))
+			{
+				node.next.store(nullptr, std::memory_order_relaxed);
+				return &node;
+			}
+		}
+		return new Node();
+	}
+
+	void release_node(Node* node)
+	{
+		if (node->pool_index == no_node)
+		{
+			delete node;
+			return;
+		}
+		std::uint64_t head = free_nodes_.load(std::memory_order_relaxed);
+		do
+			node->free_next.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+		while (!free_nodes_.compare_exchange_weak(head, free_list(head, node->pool_index), std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	bool pop(T& item)
+	{
+		Node* next = tail_->next.load();
+		if (!next)
+			return false;
+		item = std::move(next->value);
+		next->value = T();
+		release_node(tail_);
+		tail_ = next;
+		size_--;
+		wake_producers();
+		return true;
+	}
+
+	// moves from the item only when it is accepted
+	BlockingCollectionStatus add_i(T& item)
+	{
+		if (adding_completed_)
+			return BlockingCollectionStatus::AddingCompleted;
+		if (size_.fetch_add(1) >= capacity_)
+		{
+			size_--;
+			return BlockingCollectionStatus::TimedOut;
+		}
+		Node* node = acquire_node();
+		node->value = std::move(item);
+		Node* previous = head_.exchange(node);
+		previous->next.store(node);
+		wake_consumer();
+		return BlockingCollectionStatus::Ok;
+	}
+
+public:
+	explicit MpscQueue(size_t capacity = SIZE_MAX)
+		: capacity_(capacity)
+		, node_pool_(new Node[MPSC_QUEUE_NODE_POOL_SIZE])
+		, free_nodes_(free_list(0, no_node))
+	{
+		for (std::uint32_t i = 0; i < MPSC_QUEUE_NODE_POOL_SIZE; i++)
+		{
+			node_pool_[i].pool_index = i;
+			release_node(&node_pool_[i]);
+		}
+		head_ = acquire_node();
+		tail_ = head_.load();
+	}
+
+	~MpscQueue()
+	{
+		while (tail_)
+		{
+			Node* next = tail_->next.load();
+			release_node(tail_);
+			tail_ = next;
+		}
+	}
+
+	BlockingCollectionStatus try_add(T item) { return add_i(item); }
+
+	// sleeps while the queue is full
+	BlockingCollectionStatus add(T item)
+	{
+		BlockingCollectionStatus status;
+		while ((status = add_i(item)) == BlockingCollectionStatus::TimedOut)
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			producers_waiting_++;
+			// the consumer either sees the counter after it took an item, or the size here is already lower
+			room_available_.wait(lock, [this] { return size_ < capacity_ || adding_completed_; });
+			producers_waiting_--;
+		}
+		return status;
+	}
+
+	// called only from the consumer thread, blocks until an item is available or adding is completed
+	BlockingCollectionStatus take(T& item)
+	{
+		while (true)
+		{
+			if (pop(item))
+				return BlockingCollectionStatus::Ok;
+			if (adding_completed_)
+				return pop(item) ? BlockingCollectionStatus::Ok : BlockingCollectionStatus::AddingCompleted;
+			std::unique_lock<std::mutex> lock(mutex_);
+			consumer_waiting_ = true;
+			if (tail_->next.load() || adding_completed_)
+			{
+				consumer_waiting_ = false;
+				continue;
+			}
+			wake_up_.wait(lock, [this] { return !consumer_waiting_; });
+		}
+	}
+
+	BlockingCollectionStatus try_take(T& item)
+	{
+		if (pop(item))
+			return BlockingCollectionStatus::Ok;
+		return adding_completed_ ? BlockingCollectionStatus::Completed : BlockingCollectionStatus::TimedOut;
+	}
+
+	void complete_adding()
+	{
+		adding_completed_ = true;
+		wake_consumer();
+		std::lock_guard<std::mutex> lock(mutex_);
+		room_available_.notify_all();
+	}
+
+	size_t size() const { return size_; }
+
+	size_t bounded_capacity() const { return capacity_; }
+};
+
+}}
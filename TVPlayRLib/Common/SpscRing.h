@@ -0,0 +1,73 @@
+#pragma once
+
+namespace TVPlayR {
+	namespace Common {
+
+/// <summary>
+/// Bounded, lock-free ring for exactly one producer and one consumer thread.
+/// Non-blocking replacement of BlockingCollection on the per-frame hand-off paths.
+/// </summary>
+template <typename T>
+class SpscRing final : NonCopyable
+{
+private:
+	const size_t capacity_;
+	std::unique_ptr<T[]> slots_;
+	alignas(64) std::atomic_size_t head_ = 0; // count of items taken, written only by the consumer
+	alignas(64) std::atomic_size_t tail_ = 0; // count of items added, written only by the producer
+	std::atomic_bool adding_completed_ = false;
+
+	template <typename U>
+	BlockingCollectionStatus add_i(U&& item)
+	{
+		if (adding_completed_.load(std::memory_order_acquire))
+			return BlockingCollectionStatus::AddingCompleted;
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) >= capacity_)
+			return BlockingCollectionStatus::TimedOut;
+		slots_[tail % capacity_] = std::forward<U>(item);
+		tail_.store(tail + 1, std::memory_order_release);
+		return BlockingCollectionStatus::Ok;
+	}
+
+public:
+	explicit SpscRing(size_t capacity)
+		: capacity_(capacity)
+		, slots_(new T[capacity])
+	{
+		assert(capacity > 0);
+	}
+
+	BlockingCollectionStatus try_add(const T& item) { return add_i(item); }
+
+	BlockingCollectionStatus try_add(T&& item) { return add_i(std::move(item)); }
+
+	template <typename... Args>
+	BlockingCollectionStatus try_emplace(Args&&... args) { return add_i(T(std::forward<Args>(args)...)); }
+
+	BlockingCollectionStatus try_take(T& item)
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire))
+			return adding_completed_.load(std::memory_order_acquire) ? BlockingCollectionStatus::Completed : BlockingCollectionStatus::TimedOut;
+		T& slot = slots_[head % capacity_];
+		item = std::move(slot);
+		slot = T(); // don't keep the frames alive in the ring
+		head_.store(head + 1, std::memory_order_release);
+		return BlockingCollectionStatus::Ok;
+	}
+
+	// after this call, try_add fails and try_take returns remaining items
+	void complete_adding() { adding_completed_.store(true, std::memory_order_release); }
+
+	// accepts new items again, called when neither producer nor consumer is running
+	void activate() { adding_completed_.store(false, std::memory_order_release); }
+
+	bool is_adding_completed() const { return adding_completed_.load(std::memory_order_acquire); }
+
+	size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+	size_t bounded_capacity() const { return capacity_; }
+};
+
+}}
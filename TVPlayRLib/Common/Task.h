@@ -0,0 +1,113 @@
+#pragma once
+
+#define TASK_INLINE_STORAGE_SIZE 96 // enough for a lambda capturing AVSync and a pointer (checked in AVSync.h)
+
+namespace TVPlayR {
+	namespace Common {
+
+/// <summary>
+/// Move-only void() callable. Callables up to TASK_INLINE_STORAGE_SIZE bytes are stored inline, without heap allocation.
+/// </summary>
+class Task final
+{
+private:
+	struct Operations
+	{
+		void(*invoke)(void* storage);
+		void(*move)(void* destination, void* source);
+		void(*destroy)(void* storage);
+	};
+
+	template <typename F>
+	static constexpr bool is_inline = sizeof(F) <= TASK_INLINE_STORAGE_SIZE && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<F>::value;
+
+	template <typename F>
+	struct OperationsFor
+	{
+		static F* get(void* storage)
+		{
+			if constexpr (is_inline<F>)
+				return std::launder(reinterpret_cast<F*>(storage));
+			else
+				return *reinterpret_cast<F**>(storage);
+		}
+		static void invoke(void* storage) { (*get(storage))(); }
+		static void move(void* destination, void* source)
+		{
+			if constexpr (is_inline<F>)
+			{
+				new (destination) F(std::move(*get(source)));
+				get(source)->~F();
+			}
+			else
+				*reinterpret_cast<F**>(destination) = get(source);
+		}
+		static void destroy(void* storage)
+		{
+			if constexpr (is_inline<F>)
+				get(storage)->~F();
+			else
+				delete get(storage);
+		}
+		static constexpr Operations operations = { invoke, move, destroy };
+	};
+
+	alignas(std::max_align_t) unsigned char storage_[TASK_INLINE_STORAGE_SIZE];
+	const Operations* operations_ = nullptr;
+
+public:
+	Task() noexcept = default;
+
+	template <typename Func, typename = std::enable_if_t<!std::is_same<std::decay_t<Func>, Task>::value>>
+	Task(Func&& func)
+	{
+		using F = std::decay_t<Func>;
+		if constexpr (is_inline<F>)
+			new (storage_) F(std::forward<Func>(func));
+		else
+			*reinterpret_cast<F**>(storage_) = new F(std::forward<Func>(func));
+		operations_ = &OperationsFor<F>::operations;
+	}
+
+	Task(Task&& other) noexcept
+	{
+		if (!other.operations_)
+			return;
+		other.operations_->move(storage_, other.storage_);
+		operations_ = other.operations_;
+		other.operations_ = nullptr;
+	}
+
+	Task& operator=(Task&& other) noexcept
+	{
+		if (&other == this)
+			return *this;
+		reset();
+		if (other.operations_)
+		{
+			other.operations_->move(storage_, other.storage_);
+			operations_ = other.operations_;
+			other.operations_ = nullptr;
+		}
+		return *this;
+	}
+
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	~Task() { reset(); }
+
+	void reset() noexcept
+	{
+		if (!operations_)
+			return;
+		operations_->destroy(storage_);
+		operations_ = nullptr;
+	}
+
+	void operator()() { operations_->invoke(storage_); }
+
+	explicit operator bool() const noexcept { return operations_ != nullptr; }
+};
+
+}}
@@ -0,0 +1,136 @@
+#pragma once
+
+namespace TVPlayR {
+	namespace Common {
+
+/// <summary>
+/// Fixed set of threads running indexed jobs (parallel for) submitted by one thread at a time.
+/// The calling thread takes part in the job too, so the pool of N threads gives N + 1 way parallelism.
+/// Threads live as long as the pool, so submitting a job doesn't create threads nor allocate.
+/// </summary>
+class WorkerPool final : NonCopyable
+{
+private:
+	typedef void(*JOB_FUNCTION)(void* context, size_t index);
+	std::mutex submit_mutex_;
+	std::mutex mutex_;
+	std::condition_variable start_cv_;
+	std::condition_variable done_cv_;
+	JOB_FUNCTION job_function_ = nullptr;
+	void* job_context_ = nullptr;
+	size_t job_count_ = 0;
+	std::atomic_size_t next_index_ = 0;
+	std::uint64_t generation_ = 0ULL;
+	size_t busy_threads_ = 0;
+	std::exception_ptr exception_;
+	bool stop_ = false;
+	std::vector<std::thread> threads_;
+
+	void Work(size_t count, JOB_FUNCTION function, void* context)
+	{
+		for (size_t index = next_index_++; index < count; index = next_index_++)
+		{
+			try
+			{
+				function(context, index);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (!exception_)
+					exception_ = std::current_exception();
+			}
+		}
+	}
+
+	void Run([[maybe_unused]] std::string name)
+	{
+#ifdef DEBUG
+		SetThreadName(::GetCurrentThreadId(), name.c_str());
+#endif
+		std::uint64_t generation = 0ULL;
+		while (true)
+		{
+			size_t count;
+			JOB_FUNCTION function;
+			void* context;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				start_cv_.wait(lock, [&] { return stop_ || generation_ != generation; });
+				if (stop_)
+					return;
+				generation = generation_;
+				count = job_count_;
+				function = job_function_;
+				context = job_context_;
+			}
+			Work(count, function, context);
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (--busy_threads_ == 0)
+				done_cv_.notify_one();
+		}
+	}
+
+	void Submit(size_t count, JOB_FUNCTION function, void* context)
+	{
+		if (threads_.empty() || count < 2)
+		{
+			for (size_t index = 0; index < count; index++)
+				function(context, index);
+			return;
+		}
+		std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job_function_ = function;
+			job_context_ = context;
+			job_count_ = count;
+			next_index_ = 0;
+			busy_threads_ = threads_.size();
+			generation_++;
+		}
+		start_cv_.notify_all();
+		Work(count, function, context);
+		std::exception_ptr exception;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			done_cv_.wait(lock, [&] { return busy_threads_ == 0; });
+			std::swap(exception, exception_);
+		}
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+public:
+	WorkerPool(const std::string& name, size_t threads_count)
+	{
+		threads_.reserve(threads_count);
+		for (size_t i = 0; i < threads_count; i++)
+			threads_.emplace_back(&WorkerPool::Run, this, name);
+	}
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		start_cv_.notify_all();
+		for (auto& thread : threads_)
+			thread.join();
+	}
+
+	/// <summary>
+	/// Calls func(index) for every index in [0, count) and returns when all calls are finished.
+	/// The first exception thrown by any call is rethrown here.
+	/// </summary>
+	template <typename Func>
+	void ParallelFor(size_t count, Func&& func)
+	{
+		Submit(count, [](void* context, size_t index) { (*static_cast<std::remove_reference_t<Func>*>(context))(index); }, const_cast<void*>(static_cast<const void*>(std::addressof(func))));
+	}
+
+	size_t Concurrency() const { return threads_.size() + 1; }
+};
+
+}}
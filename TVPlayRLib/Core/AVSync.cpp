@@ -0,0 +1,22 @@
+#include "../pch.h"
+#include "AVSync.h"
+#include "../FFmpeg/FFmpegUtils.h"
+
+namespace TVPlayR {
+	namespace Core {
+
+		std::shared_ptr<AVFrame> AVSync::MakeVideoWritable(int first_row, int rows_count)
+		{
+			if (!Video)
+				return nullptr;
+			if (Video.use_count() > 1 || !av_frame_is_writable(Video.get()))
+			{
+				auto copy = FFmpeg::CopyFrame(Video);
+				THROW_ON_FFMPEG_ERROR(av_frame_copy_props(copy.get(), Video.get()));
+				Video = copy;
+			}
+			return FFmpeg::GetFrameRows(Video, first_row, rows_count);
+		}
+
+	}
+}
@@ -5,9 +5,9 @@ namespace TVPlayR {
 	namespace Core {
 		struct AVSync
 		{
-			AVSync(std::shared_ptr<AVFrame>& audio, std::shared_ptr<AVFrame>& video, FrameTimeInfo time_info)
-				: Audio(audio)
-				, Video(video)
+			AVSync(std::shared_ptr<AVFrame> audio, std::shared_ptr<AVFrame> video, FrameTimeInfo time_info)
+				: Audio(std::move(audio))
+				, Video(std::move(video))
 				, TimeInfo(time_info)
 			{ }
 			AVSync() : AVSync(std::shared_ptr<AVFrame>(), std::shared_ptr<AVFrame>(), FrameTimeInfo()) {}
@@ -16,6 +16,9 @@ namespace TVPlayR {
 			std::shared_ptr<AVFrame> Audio;
 			std::shared_ptr<AVFrame> Video;
 			FrameTimeInfo TimeInfo;
+			// timestamps assigned by a sink, kept beside the frames, so the shared frames don't have to be cloned to change their pts
+			std::int64_t AudioPts = AV_NOPTS_VALUE;
+			std::int64_t VideoPts = AV_NOPTS_VALUE;
 			AVSync operator=(AVSync&& other) noexcept
 			{
 				if (&other == this)
@@ -23,6 +26,8 @@ namespace TVPlayR {
 				Audio = std::move(other.Audio);
 				Video = std::move(other.Video);
 				TimeInfo = std::move(other.TimeInfo);
+				AudioPts = other.AudioPts;
+				VideoPts = other.VideoPts;
 				return *this;
 			}
 			
@@ -31,14 +36,27 @@ namespace TVPlayR {
 				Audio = other.Audio;
 				Video = other.Video;
 				TimeInfo = other.TimeInfo;
+				AudioPts = other.AudioPts;
+				VideoPts = other.VideoPts;
 				return *this;
 			}
 
+			/// <summary>
+			/// Copy-on-write: copies the video frame only if it is shared with other AVSync or its buffer is referenced elsewhere.
+			/// Callers move the frames along rather than copy them, otherwise the frame is always shared and always copied.
+			/// </summary>
+			/// <returns>frame pointing to the rows to be modified, valid as long as Video is not replaced</returns>
+			std::shared_ptr<AVFrame> MakeVideoWritable(int first_row, int rows_count);
+
 			operator bool() const noexcept
 			{
 				return Audio || Video;
 			}
 		};
 
+		// frames are posted to the sinks' executors as [this, sync] lambdas, they must not allocate
+		static_assert(sizeof(AVSync) + sizeof(void*) <= TASK_INLINE_STORAGE_SIZE, "AVSync captured with a pointer doesn't fit Task inline storage");
+		static_assert(std::is_nothrow_move_constructible<AVSync>::value, "AVSync has to be nothrow movable to be stored in Task inline");
+
 
 }}
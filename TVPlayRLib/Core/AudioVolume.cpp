@@ -1,5 +1,6 @@
 #include "../pch.h"
 #include "AudioVolume.h"
+#include "../FFmpeg/FFmpegUtils.h"
 
 namespace TVPlayR {
 	namespace Core {
@@ -16,29 +17,49 @@ void AudioVolume::SetVolume(float volume)
 }
 
 
-std::vector<float> AudioVolume::ProcessVolume(const std::shared_ptr<AVFrame>& frame, float* coherence)
+std::vector<float> AudioVolume::ProcessVolume(const std::shared_ptr<AVFrame>& frame, float* coherence, std::vector<float>* rms)
 {
 	assert(frame->format == AVSampleFormat::AV_SAMPLE_FMT_FLT);
 	float* samples = reinterpret_cast<float*>(frame->data[0]);
-	int channels = frame->ch_layout.nb_channels;
-	int samples_count = frame->nb_samples * channels;
-	std::vector<float> peak_volume(channels, 0LL);
-	for (int sample = 0; sample < samples_count; sample++)
+	const int channels = frame->ch_layout.nb_channels;
+	const size_t rows = static_cast<size_t>(frame->nb_samples);
+	const size_t samples_count = rows * channels;
+	const float new_volume = new_volume_;
+	std::vector<float> peak_volume(channels, 0.0f);
+	if (coherence)
+		*coherence = 0.0f;
+	if (rms)
+		rms->assign(channels, 0.0f);
+	if (!channels || !rows)
 	{
-		if (volume_ != new_volume_ && sample > 0 && (samples[sample] * samples[sample - 1]) < 0) // sign of sample was changed, probably near zero, we can now adjust the volume
-			volume_ = new_volume_;
-		samples[sample] = samples[sample] * volume_;
-		if (std::abs(samples[sample]) > peak_volume[sample % channels])
-			peak_volume[sample % channels] = std::abs(samples[sample]);
+		volume_ = new_volume;
+		return peak_volume;
 	}
-	if (volume_ != new_volume_)
-		volume_ = new_volume_; // in case when volume change failed within one frame period
-	if (coherence)
+	if (!av_frame_is_writable(frame.get()))
 	{
-		//TODO: calculate the coherence
-		*coherence = 0.0;
+		// shared silent frames are read-only, there is nothing to scale in them
+		if (std::all_of(samples, samples + samples_count, [](float sample) { return sample == 0.0f; }))
+		{
+			volume_ = new_volume;
+			return peak_volume;
+		}
+		THROW_ON_FFMPEG_ERROR(av_frame_make_writable(frame.get()));
+		samples = reinterpret_cast<float*>(frame->data[0]);
 	}
-	return peak_volume;
+
+	// gain of the n-th sample of the frame is volume_ + (n + 1) * gain_step, reaching new volume at the last sample
+	const float gain_step = (new_volume - volume_) / rows;
+	const float gain = volume_ + gain_step;
+	volume_ = new_volume;
+
+	VOLUME_KERNEL kernel;
+	const size_t lanes = GetVolumeKernel(&kernel);
+	ScaleAndMeasure(kernel, lanes, samples, channels, rows, gain, gain_step, accumulators_, measurement_);
+	if (coherence)
+		*coherence = measurement_.Coherence;
+	if (rms)
+		*rms = measurement_.Rms;
+	return measurement_.Peak;
 }
 
-}}
\ No newline at end of file
+}}
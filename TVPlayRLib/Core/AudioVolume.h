@@ -1,4 +1,5 @@
 #pragma once
+#include "AudioVolumeKernels.h"
 
 namespace TVPlayR {
 	namespace Core {
@@ -10,14 +11,18 @@ public:
 	void SetVolume(float volume);
 
 	/// <summary>
-	/// Changes volume of the frame and calculates average volume
+	/// Changes volume of the frame, ramping the gain smoothly from the previous value, and measures the result
 	/// </summary>
 	/// <param name="frame">frame to process</param>
-	/// <returns>average volume</returns>
-	std::vector<float> ProcessVolume(const std::shared_ptr<AVFrame>& frame, float* coherence);
+	/// <param name="coherence">receives correlation of the first two channels, from -1 (out of phase) to 1 (in phase), 0 for silence or mono</param>
+	/// <param name="rms">optionally receives RMS of each channel</param>
+	/// <returns>peak volume of each channel</returns>
+	std::vector<float> ProcessVolume(const std::shared_ptr<AVFrame>& frame, float* coherence, std::vector<float>* rms = nullptr);
 private:
 	float volume_;
-	float new_volume_;
+	std::atomic<float> new_volume_;
+	VolumeAccumulators accumulators_;
+	VolumeMeasurement measurement_;
 };
 
-}}
\ No newline at end of file
+}}
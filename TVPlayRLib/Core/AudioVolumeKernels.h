@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+#include "../Common/CpuFeatures.h"
+#ifdef CPU_X64
+#include <immintrin.h>
+#endif
+
+// processing of AudioVolume, without dependencies on the precompiled header and FFmpeg, so the benchmark can build it on its own
+
+namespace TVPlayR {
+	namespace Core {
+
+// Interleaved samples are processed in blocks of least common multiple of channel count and vector width samples,
+// so every vector lane always holds the same channel and per-channel values are gathered from lanes only once per frame.
+// Accumulators layout (each block_size long): row offset of the lane within the block, peak, sum of squares, product with neighbour sample.
+typedef void(*VOLUME_KERNEL)(float* samples, size_t blocks, size_t block_size, size_t rows_per_block, float gain, float gain_step, float* accumulators);
+
+#ifdef CPU_X64
+
+inline void ProcessBlocksSse2(float* samples, size_t blocks, size_t block_size, size_t rows_per_block, float gain, float gain_step, float* accumulators)
+{
+	const float* row_offsets = accumulators;
+	float* peaks = accumulators + block_size;
+	float* sums = peaks + block_size;
+	float* products = sums + block_size;
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	const __m128 step = _mm_set1_ps(gain_step);
+	for (size_t block = 0; block < blocks; block++)
+	{
+		const __m128 block_gain = _mm_set1_ps(gain + gain_step * static_cast<float>(block * rows_per_block));
+		float* data = samples + block * block_size;
+		for (size_t offset = 0; offset < block_size; offset += 4)
+		{
+			__m128 value = _mm_loadu_ps(data + offset);
+			value = _mm_mul_ps(value, _mm_add_ps(block_gain, _mm_mul_ps(step, _mm_loadu_ps(row_offsets + offset))));
+			_mm_storeu_ps(data + offset, value);
+			_mm_storeu_ps(peaks + offset, _mm_max_ps(_mm_loadu_ps(peaks + offset), _mm_andnot_ps(sign_mask, value)));
+			_mm_storeu_ps(sums + offset, _mm_add_ps(_mm_loadu_ps(sums + offset), _mm_mul_ps(value, value)));
+			_mm_storeu_ps(products + offset, _mm_add_ps(_mm_loadu_ps(products + offset), _mm_mul_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)))));
+		}
+	}
+}
+
+CPU_TARGET("avx2") inline void ProcessBlocksAvx2(float* samples, size_t blocks, size_t block_size, size_t rows_per_block, float gain, float gain_step, float* accumulators)
+{
+	const float* row_offsets = accumulators;
+	float* peaks = accumulators + block_size;
+	float* sums = peaks + block_size;
+	float* products = sums + block_size;
+	const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+	const __m256 step = _mm256_set1_ps(gain_step);
+	for (size_t block = 0; block < blocks; block++)
+	{
+		const __m256 block_gain = _mm256_set1_ps(gain + gain_step * static_cast<float>(block * rows_per_block));
+		float* data = samples + block * block_size;
+		for (size_t offset = 0; offset < block_size; offset += 8)
+		{
+			__m256 value = _mm256_loadu_ps(data + offset);
+			value = _mm256_mul_ps(value, _mm256_add_ps(block_gain, _mm256_mul_ps(step, _mm256_loadu_ps(row_offsets + offset))));
+			_mm256_storeu_ps(data + offset, value);
+			_mm256_storeu_ps(peaks + offset, _mm256_max_ps(_mm256_loadu_ps(peaks + offset), _mm256_andnot_ps(sign_mask, value)));
+			_mm256_storeu_ps(sums + offset, _mm256_add_ps(_mm256_loadu_ps(sums + offset), _mm256_mul_ps(value, value)));
+			_mm256_storeu_ps(products + offset, _mm256_add_ps(_mm256_loadu_ps(products + offset), _mm256_mul_ps(value, _mm256_permute_ps(value, _MM_SHUFFLE(2, 3, 0, 1)))));
+		}
+	}
+	_mm256_zeroupper();
+}
+
+#endif // CPU_X64
+
+// returns vector width of the kernel, the kernel is nullptr if all the samples are processed by the scalar loop
+inline size_t GetVolumeKernel(VOLUME_KERNEL* kernel)
+{
+#ifdef CPU_X64
+	if (Common::CpuFeatures::Instance().HasAvx2())
+	{
+		*kernel = ProcessBlocksAvx2;
+		return 8;
+	}
+	*kernel = ProcessBlocksSse2;
+	return 4;
+#else
+	*kernel = nullptr;
+	return 1;
+#endif // CPU_X64
+}
+
+// kept between frames, so the row offsets are computed only when the channel count changes
+struct VolumeAccumulators
+{
+	std::vector<float> Values;
+	int Channels = 0;
+};
+
+struct VolumeMeasurement
+{
+	std::vector<float> Peak;
+	std::vector<float> Rms;
+	float Coherence = 0.0f; // correlation of the first two channels, 0 for silence or mono
+};
+
+/// <summary>
+/// Scales interleaved samples by gain + n * gain_step (n is the row) and measures the result.
+/// </summary>
+inline void ScaleAndMeasure(VOLUME_KERNEL kernel, size_t lanes, float* samples, int channels, size_t rows, float gain, float gain_step, VolumeAccumulators& accumulators, VolumeMeasurement& measurement)
+{
+	measurement.Peak.assign(channels, 0.0f);
+	measurement.Rms.assign(channels, 0.0f);
+	measurement.Coherence = 0.0f;
+	if (!channels || !rows)
+		return;
+	const size_t block_size = lanes * channels / std::gcd(lanes, static_cast<size_t>(channels));
+	const size_t rows_per_block = block_size / channels;
+	if (accumulators.Channels != channels || accumulators.Values.size() != block_size * 4)
+	{
+		accumulators.Values.resize(block_size * 4);
+		for (size_t i = 0; i < block_size; i++)
+			accumulators.Values[i] = static_cast<float>(i / channels);
+		accumulators.Channels = channels;
+	}
+	std::fill(accumulators.Values.begin() + block_size, accumulators.Values.end(), 0.0f);
+	const size_t blocks = kernel ? rows * channels / block_size : 0;
+	if (blocks)
+		kernel(samples, blocks, block_size, rows_per_block, gain, gain_step, accumulators.Values.data());
+
+	std::vector<double> sum_squares(channels, 0.0);
+	double sum_product = 0.0;
+	const float* peaks = accumulators.Values.data() + block_size;
+	const float* sums = peaks + block_size;
+	const float* products = sums + block_size;
+	for (size_t i = 0; i < block_size; i++)
+	{
+		const size_t channel = i % channels;
+		measurement.Peak[channel] = (std::max)(measurement.Peak[channel], peaks[i]);
+		sum_squares[channel] += sums[i];
+		if (channel == 0 && channels % 2 == 0)
+			sum_product += products[i];
+	}
+
+	// samples left after the last whole block
+	for (size_t row = blocks * rows_per_block; row < rows; row++)
+	{
+		const float row_gain = gain + gain_step * static_cast<float>(row);
+		float* data = samples + row * channels;
+		for (int channel = 0; channel < channels; channel++)
+		{
+			const float value = data[channel] * row_gain;
+			data[channel] = value;
+			measurement.Peak[channel] = (std::max)(measurement.Peak[channel], std::abs(value));
+			sum_squares[channel] += value * value;
+		}
+		if (channels >= 2 && channels % 2 == 0)
+			sum_product += data[0] * data[1];
+	}
+
+	if (channels >= 2)
+	{
+		// with odd channel count left channel lands on odd lanes too, the vector products don't pair it with the right one
+		if (channels % 2)
+		{
+			sum_product = 0.0;
+			for (size_t row = 0; row < rows; row++)
+				sum_product += samples[row * channels] * samples[row * channels + 1];
+		}
+		const double energy = std::sqrt(sum_squares[0] * sum_squares[1]);
+		if (energy > 1e-12)
+			measurement.Coherence = static_cast<float>((std::max)(-1.0, (std::min)(1.0, sum_product / energy)));
+	}
+	for (int channel = 0; channel < channels; channel++)
+		measurement.Rms[channel] = static_cast<float>(std::sqrt(sum_squares[channel] / rows));
+}
+
+}}
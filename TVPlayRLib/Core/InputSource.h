@@ -15,6 +15,10 @@ public:
 	typedef std::function<void(FrameTimeInfo&)> TIME_CALLBACK;
 	typedef std::function<void()> LOADED_CALLBACK;
 	virtual Core::AVSync PullSync(const Core::Player& player, int audio_samples_count) = 0;
+	// false if the source would block PullSync now, used to change inputs without waiting
+	virtual bool IsReady() { return true; }
+	// audio remaining after the last frame of the source, spliced with the next source
+	virtual std::shared_ptr<AVFrame> PullTailAudio(int max_samples_count) { return nullptr; }
 	virtual bool IsAddedToPlayer(const Player& player) = 0;
 	virtual void AddToPlayer(const Player& player) = 0;
 	virtual void RemoveFromPlayer(const Core::Player& player) = 0;
@@ -0,0 +1,27 @@
+#include "../pch.h"
+#include "OverlayBlend.h"
+
+namespace TVPlayR {
+	namespace Core {
+
+void BlendOverlay(AVFrame* frame, int x, const std::uint8_t* mask, int mask_width, int mask_height, OverlayColor background, OverlayColor foreground)
+{
+	assert(x >= 0 && x + mask_width <= frame->width && mask_height <= frame->height);
+	switch (frame->format)
+	{
+	case AV_PIX_FMT_UYVY422:
+		assert(x % 2 == 0 && mask_width % 2 == 0);
+		BlendUyvy(frame->data[0], frame->linesize[0], x, mask, mask_width, mask_height, frame->height >= 720, background, foreground);
+		break;
+	case AV_PIX_FMT_X2RGB10LE:
+		BlendX2Rgb10(frame->data[0], frame->linesize[0], x, mask, mask_width, mask_height, background, foreground);
+		break;
+	case AV_PIX_FMT_BGRA:
+		BlendBgra(frame->data[0], frame->linesize[0], x, mask, mask_width, mask_height, background, foreground);
+		break;
+	default:
+		THROW_EXCEPTION("BlendOverlay: unsupported pixel format: " + std::to_string(frame->format));
+	}
+}
+
+}}
@@ -0,0 +1,13 @@
+#pragma once
+#include "OverlayBlendKernels.h"
+
+namespace TVPlayR {
+	namespace Core {
+
+/// <summary>
+/// Blends the background color over the mask_width x mask_height rectangle at (x, 0) of the frame, then the foreground color with the mask coverage.
+/// Works in the native format of the frame: AV_PIX_FMT_UYVY422 (x and mask_width must be even), AV_PIX_FMT_X2RGB10LE or AV_PIX_FMT_BGRA.
+/// </summary>
+void BlendOverlay(AVFrame* frame, int x, const std::uint8_t* mask, int mask_width, int mask_height, OverlayColor background, OverlayColor foreground);
+
+}}
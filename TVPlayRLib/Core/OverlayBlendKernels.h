@@ -0,0 +1,210 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// glyph atlas, text mask and blending of the timecode overlay, without dependencies on the precompiled header and FFmpeg, so the benchmark can build them on its own
+
+namespace TVPlayR {
+	namespace Core {
+
+struct OverlayColor
+{
+	std::uint8_t A;
+	std::uint8_t R;
+	std::uint8_t G;
+	std::uint8_t B;
+};
+
+/// <summary>
+/// 8-bit coverage masks of equally sized character cells, rendered once and reused for every frame.
+/// </summary>
+class GlyphAtlas final
+{
+public:
+	GlyphAtlas(int cell_width, int cell_height)
+		: cell_width_(cell_width)
+		, cell_height_(cell_height)
+	{ }
+	GlyphAtlas(const GlyphAtlas&) = delete;
+	GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+	int CellWidth() const { return cell_width_; }
+	int CellHeight() const { return cell_height_; }
+	// returns zeroed CellWidth() x CellHeight() mask to be filled by the caller, nullptr for characters outside ASCII
+	std::uint8_t* AddGlyph(char c)
+	{
+		if (c < 0)
+			return nullptr;
+		auto& glyph = glyphs_[static_cast<int>(c)];
+		glyph.assign(static_cast<size_t>(cell_width_) * cell_height_, 0);
+		return glyph.data();
+	}
+	// returns nullptr for characters not in the atlas
+	const std::uint8_t* GetGlyph(char c) const
+	{
+		if (c < 0 || glyphs_[static_cast<int>(c)].empty())
+			return nullptr;
+		return glyphs_[static_cast<int>(c)].data();
+	}
+private:
+	const int cell_width_;
+	const int cell_height_;
+	std::vector<std::uint8_t> glyphs_[128];
+};
+
+/// <summary>
+/// Coverage mask of one line of centered text composed from the glyph atlas. Only the characters that changed are copied on update.
+/// </summary>
+class TextMask final
+{
+public:
+	TextMask(const GlyphAtlas& atlas, int width, int height)
+		: atlas_(atlas)
+		, width_(width)
+		, height_(height)
+		, mask_(static_cast<size_t>(width) * height, 0)
+	{ }
+	TextMask(const TextMask&) = delete;
+	TextMask& operator=(const TextMask&) = delete;
+	// returns true if the mask was changed
+	bool Update(const std::string& text)
+	{
+		if (text == text_)
+			return false;
+		if (text.length() != text_.length())
+		{
+			// the text is centered, so all characters move
+			std::fill(mask_.begin(), mask_.end(), static_cast<std::uint8_t>(0));
+			text_.assign(text.length(), '\0');
+		}
+		for (size_t i = 0; i < text.length(); i++)
+			if (text[i] != text_[i])
+				DrawCharacter(i, text[i]);
+		text_ = text;
+		return true;
+	}
+	const std::uint8_t* Data() const { return mask_.data(); }
+	int Width() const { return width_; }
+	int Height() const { return height_; }
+	// left edge of the cell of the character, may be negative when the text is wider than the mask
+	int CharacterLeft(size_t position) const { return (width_ - static_cast<int>(text_.length()) * atlas_.CellWidth()) / 2 + static_cast<int>(position) * atlas_.CellWidth(); }
+	int CharacterTop() const { return (height_ - atlas_.CellHeight()) / 2; }
+private:
+	const GlyphAtlas& atlas_;
+	const int width_;
+	const int height_;
+	std::vector<std::uint8_t> mask_;
+	std::string text_;
+
+	void DrawCharacter(size_t position, char c)
+	{
+		const int cell_width = atlas_.CellWidth();
+		const int cell_height = atlas_.CellHeight();
+		const int left = CharacterLeft(position);
+		const int top = CharacterTop();
+		const std::uint8_t* glyph = atlas_.GetGlyph(c);
+		for (int y = (std::max)(top, 0); y < (std::min)(top + cell_height, height_); y++)
+		{
+			std::uint8_t* mask_row = mask_.data() + static_cast<size_t>(y) * width_;
+			for (int x = (std::max)(left, 0); x < (std::min)(left + cell_width, width_); x++)
+				mask_row[x] = glyph ? glyph[(y - top) * cell_width + x - left] : 0;
+		}
+	}
+};
+
+inline int BlendComponent(int destination, int source, int alpha, int max_alpha)
+{
+	return (destination * (max_alpha - alpha) + source * alpha + max_alpha / 2) / max_alpha;
+}
+
+struct YCbCr
+{
+	int Y;
+	int Cb;
+	int Cr;
+};
+
+// studio range, BT.709 for HD, BT.601 for SD
+inline YCbCr ToYCbCr(const OverlayColor& color, bool bt709)
+{
+	const double kr = bt709 ? 0.2126 : 0.299;
+	const double kb = bt709 ? 0.0722 : 0.114;
+	const double y = kr * color.R + (1.0 - kr - kb) * color.G + kb * color.B;
+	return YCbCr {
+		static_cast<int>(std::lround(16.0 + y * 219.0 / 255.0)),
+		static_cast<int>(std::lround(128.0 + (color.B - y) / (2.0 * (1.0 - kb)) * 224.0 / 255.0)),
+		static_cast<int>(std::lround(128.0 + (color.R - y) / (2.0 * (1.0 - kr)) * 224.0 / 255.0))
+	};
+}
+
+// The kernels blend the background color over mask_width x mask_height pixels starting at column x of the rows, then the foreground color with the mask coverage.
+// data points to the first row to be blended. Coverage multiplied by the foreground alpha is kept in 0..COVERAGE_ALPHA_MAX, not rounded to 8 bits.
+#define COVERAGE_ALPHA_MAX (255 * 255)
+
+// x and mask_width are even, chroma of a pixel pair is blended with the mean coverage of the pair
+inline void BlendUyvy(std::uint8_t* data, std::ptrdiff_t linesize, int x, const std::uint8_t* mask, int mask_width, int mask_height, bool bt709, const OverlayColor& background, const OverlayColor& foreground)
+{
+	const YCbCr bg = ToYCbCr(background, bt709);
+	const YCbCr fg = ToYCbCr(foreground, bt709);
+	for (int row = 0; row < mask_height; row++)
+	{
+		std::uint8_t* pixel = data + row * linesize + x * 2;
+		const std::uint8_t* coverage = mask + static_cast<std::ptrdiff_t>(row) * mask_width;
+		for (int i = 0; i < mask_width; i += 2, pixel += 4)
+		{
+			const int a0 = coverage[i] * foreground.A;
+			const int a1 = coverage[i + 1] * foreground.A;
+			const int ac = (a0 + a1 + 1) / 2;
+			pixel[0] = static_cast<std::uint8_t>(BlendComponent(BlendComponent(pixel[0], bg.Cb, background.A, 255), fg.Cb, ac, COVERAGE_ALPHA_MAX));
+			pixel[1] = static_cast<std::uint8_t>(BlendComponent(BlendComponent(pixel[1], bg.Y, background.A, 255), fg.Y, a0, COVERAGE_ALPHA_MAX));
+			pixel[2] = static_cast<std::uint8_t>(BlendComponent(BlendComponent(pixel[2], bg.Cr, background.A, 255), fg.Cr, ac, COVERAGE_ALPHA_MAX));
+			pixel[3] = static_cast<std::uint8_t>(BlendComponent(BlendComponent(pixel[3], bg.Y, background.A, 255), fg.Y, a1, COVERAGE_ALPHA_MAX));
+		}
+	}
+}
+
+// little-endian 32-bit pixels, 2 unused upper bits are kept
+inline void BlendX2Rgb10(std::uint8_t* data, std::ptrdiff_t linesize, int x, const std::uint8_t* mask, int mask_width, int mask_height, const OverlayColor& background, const OverlayColor& foreground)
+{
+	auto to_10bit = [](std::uint8_t value) { return (value * 1023 + 127) / 255; };
+	const int bg_r = to_10bit(background.R), bg_g = to_10bit(background.G), bg_b = to_10bit(background.B);
+	const int fg_r = to_10bit(foreground.R), fg_g = to_10bit(foreground.G), fg_b = to_10bit(foreground.B);
+	for (int row = 0; row < mask_height; row++)
+	{
+		std::uint32_t* pixel = reinterpret_cast<std::uint32_t*>(data + row * linesize) + x;
+		const std::uint8_t* coverage = mask + static_cast<std::ptrdiff_t>(row) * mask_width;
+		for (int i = 0; i < mask_width; i++, pixel++)
+		{
+			const int a = coverage[i] * foreground.A;
+			const std::uint32_t value = *pixel;
+			const int r = BlendComponent(BlendComponent((value >> 20) & 0x3FF, bg_r, background.A, 255), fg_r, a, COVERAGE_ALPHA_MAX);
+			const int g = BlendComponent(BlendComponent((value >> 10) & 0x3FF, bg_g, background.A, 255), fg_g, a, COVERAGE_ALPHA_MAX);
+			const int b = BlendComponent(BlendComponent(value & 0x3FF, bg_b, background.A, 255), fg_b, a, COVERAGE_ALPHA_MAX);
+			*pixel = (value & 0xC0000000) | (static_cast<std::uint32_t>(r) << 20) | (static_cast<std::uint32_t>(g) << 10) | static_cast<std::uint32_t>(b);
+		}
+	}
+}
+
+inline void BlendBgra(std::uint8_t* data, std::ptrdiff_t linesize, int x, const std::uint8_t* mask, int mask_width, int mask_height, const OverlayColor& background, const OverlayColor& foreground)
+{
+	for (int row = 0; row < mask_height; row++)
+	{
+		std::uint8_t* pixel = data + row * linesize + x * 4;
+		const std::uint8_t* coverage = mask + static_cast<std::ptrdiff_t>(row) * mask_width;
+		for (int i = 0; i < mask_width; i++, pixel += 4)
+		{
+			const int a = coverage[i] * foreground.A;
+			pixel[0] = static_cast<std::uint8_t>(BlendComponent(BlendComponent(pixel[0], background.B, background.A, 255), foreground.B, a, COVERAGE_ALPHA_MAX));
+			pixel[1] = static_cast<std::uint8_t>(BlendComponent(BlendComponent(pixel[1], background.G, background.A, 255), foreground.G, a, COVERAGE_ALPHA_MAX));
+			pixel[2] = static_cast<std::uint8_t>(BlendComponent(BlendComponent(pixel[2], background.R, background.A, 255), foreground.R, a, COVERAGE_ALPHA_MAX));
+			// source-over alpha compositing, like GDI+ on a 32bpp ARGB bitmap
+			const int alpha = BlendComponent(pixel[3], 255, background.A, 255);
+			pixel[3] = static_cast<std::uint8_t>(BlendComponent(alpha, 255, a, COVERAGE_ALPHA_MAX));
+		}
+	}
+}
+
+}}
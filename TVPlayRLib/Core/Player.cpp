@@ -9,15 +9,68 @@
 #include "AVSync.h"
 #include "OverlayBase.h"
 
+#define OUTPUT_SINK_QUEUE_DEPTH 3
+
 namespace TVPlayR {
 	namespace Core {
 
+		// mixes the tail of the previous source into the beginning of the frame, fading it out while the frame fades in
+		static void CrossfadeAudio(const std::shared_ptr<AVFrame>& frame, const std::shared_ptr<AVFrame>& tail)
+		{
+			assert(frame->format == AVSampleFormat::AV_SAMPLE_FMT_FLT && tail->format == AVSampleFormat::AV_SAMPLE_FMT_FLT);
+			const int channels = frame->ch_layout.nb_channels;
+			const int samples = FFMIN(frame->nb_samples, tail->nb_samples);
+			if (samples <= 0 || channels != tail->ch_layout.nb_channels)
+				return;
+			THROW_ON_FFMPEG_ERROR(av_frame_make_writable(frame.get()));
+			float* data = reinterpret_cast<float*>(frame->data[0]);
+			const float* tail_data = reinterpret_cast<const float*>(tail->data[0]);
+			for (int i = 0; i < samples; i++)
+			{
+				const float gain = static_cast<float>(i + 1) / (samples + 1);
+				for (int channel = 0; channel < channels; channel++)
+				{
+					const int index = i * channels + channel;
+					data[index] = data[index] * gain + tail_data[index] * (1.0f - gain);
+				}
+			}
+		}
+
 		struct Player::implementation : Common::DebugTarget
 		{
+			// pushes frames to one sink on its own thread, so a slow sink can't delay the player or other sinks
+			class OutputWorker final : Common::NonCopyable
+			{
+			public:
+				const std::shared_ptr<OutputSink> Sink;
+			private:
+				std::atomic_int64_t pushed_ = 0LL;
+				std::atomic_int64_t dropped_ = 0LL;
+				Common::Executor executor_; // the last one, to be joined before the sink is released
+			public:
+
+				OutputWorker(const std::shared_ptr<OutputSink>& sink, const std::string& player_name)
+					: Sink(sink)
+					, executor_("Output sink for player " + player_name, OUTPUT_SINK_QUEUE_DEPTH)
+				{ }
+
+				// returns false if the frame was dropped because the sink didn't consume previous ones
+				bool Push(AVSync sync)
+				{
+					pushed_++;
+					if (executor_.post([this, sync = std::move(sync)]() mutable { Sink->Push(sync); }))
+						return true;
+					dropped_++;
+					return false;
+				}
+
+				OutputSinkStatistics GetStatistics() const { return OutputSinkStatistics{ executor_.queue_size(), pushed_, dropped_ }; }
+			};
+
 			const Player& player_;
 			const std::string name_;
-			std::mutex devices_mutex_;
-			std::vector<std::shared_ptr<OutputSink>> outputs_;
+			mutable std::mutex devices_mutex_;
+			std::vector<std::unique_ptr<OutputWorker>> outputs_;
 			std::shared_ptr<InputSource> playing_source_;
 			std::shared_ptr<InputSource> next_source_;
 			AudioVolume audio_volume_;
@@ -30,6 +83,12 @@ namespace TVPlayR {
 			const AVSampleFormat audio_sample_format_ = AVSampleFormat::AV_SAMPLE_FMT_FLT;
 			std::mutex audio_volume_callback_mutex_;
 			AUDIO_VOLUME_CALLBACK audio_volume_callback_ = nullptr;
+			std::atomic_int64_t transition_crossfade_ = 0LL;
+			mutable std::mutex settings_mutex_;
+			PlayerBufferSettings buffer_settings_;
+			PlayerScalingSettings scaling_settings_;
+			std::atomic_int64_t transitions_ = 0LL;
+			std::atomic_int64_t transition_lost_frames_ = 0LL;
 			Common::Executor executor_;
 		
 			implementation(const Player& player, const std::string& name, const VideoFormatType& format, TVPlayR::PixelFormat pixel_format, int audio_channels_count, int audio_sample_rate)
@@ -59,11 +118,14 @@ namespace TVPlayR {
 			{
 				if (audio_samples_count < 0)
 					audio_samples_count = 0;
-				executor_.begin_invoke([this, audio_samples_count]()
+				executor_.post([this, audio_samples_count]()
 				{
 					std::vector<float> volume(player_.AudioChannelsCount(), 0.0);
 					float coherence = 0.0;
 					DebugPrintLine(Common::DebugSeverity::trace, "Requested frame with " + std::to_string(audio_samples_count) + " samples of audio");
+					std::shared_ptr<AVFrame> tail_audio;
+					if (playing_source_ && playing_source_->IsEof() && next_source_)
+						tail_audio = ChangeToNextSource(audio_samples_count);
 					if (playing_source_)
 					{
 						auto sync = playing_source_->PullSync(player_, audio_samples_count);
@@ -74,15 +136,11 @@ namespace TVPlayR {
 							video = empty_video_;
 							DebugPrintLine(Common::DebugSeverity::warning, "Played empty video frame");
 						}
+						if (audio && tail_audio)
+							CrossfadeAudio(audio, tail_audio);
 						if (audio)
 							volume = audio_volume_.ProcessVolume(audio, &coherence);
-						AddOverlayAndPushToOutputs(video, audio, sync.TimeInfo);
-						if (playing_source_->IsEof() && next_source_)
-						{
-							playing_source_ = next_source_;
-							next_source_->RaiseLoaded();
-							next_source_.reset();
-						}
+						AddOverlayAndPushToOutputs(std::move(video), std::move(audio), sync.TimeInfo);
 					}
 					else
 					{
@@ -96,29 +154,70 @@ namespace TVPlayR {
 				});
 			}
 
+			// used only in executor thread, switches to next source on the frame following the last frame of the playing one
+			// returns audio of the previous source to be mixed with the first frame of the next one
+			std::shared_ptr<AVFrame> ChangeToNextSource(int audio_samples_count)
+			{
+				if (!next_source_->IsReady())
+				{
+					// previous source holds its last frame until the next one has buffered enough
+					transition_lost_frames_++;
+					DebugPrintLine(Common::DebugSeverity::warning, "Next source not ready, frame lost");
+					DebugRecord(Common::DebugSeverity::warning, "transition frame lost", transition_lost_frames_.load());
+					return nullptr;
+				}
+				const int crossfade_samples = static_cast<int>(FFMIN(av_rescale(transition_crossfade_, audio_sample_rate_, AV_TIME_BASE), static_cast<std::int64_t>(audio_samples_count)));
+				std::shared_ptr<AVFrame> tail_audio = crossfade_samples > 0 ? playing_source_->PullTailAudio(crossfade_samples) : nullptr;
+				playing_source_ = next_source_;
+				next_source_.reset();
+				playing_source_->RaiseLoaded();
+				transitions_++;
+				return tail_audio;
+			}
+
 			// used only in executor thread
 			void AddOverlayAndPushToOutputs(std::shared_ptr<AVFrame> video, std::shared_ptr<AVFrame> audio, FrameTimeInfo time_info)
 			{
-				Core::AVSync sync(audio, video, time_info);
+				Core::AVSync sync(std::move(audio), std::move(video), time_info);
 				for (auto& overlay : overlays_)
 					sync = overlay->Transform(sync);
 				std::lock_guard<std::mutex> lock(devices_mutex_);
-				for (auto& device : outputs_)
-					device->Push(sync);
+				for (auto& output : outputs_)
+					if (!output->Push(sync))
+					{
+						DebugPrintLine(Common::DebugSeverity::warning, "Output sink is busy, frame dropped");
+						DebugRecord(Common::DebugSeverity::warning, "output frame dropped", time_info.TimeFromBegin);
+					}
 			}
 
 			void AddOutputSink(std::shared_ptr<OutputSink>& device)
 			{
 				assert(device);
+				auto worker = std::make_unique<OutputWorker>(device, name_);
 				std::lock_guard<std::mutex> lock(devices_mutex_);
-				outputs_.push_back(device);
+				outputs_.push_back(std::move(worker));
 			}
 
 			void RemoveOutputSink(std::shared_ptr<OutputSink>& device)
 			{
 				assert(device);
+				std::vector<std::unique_ptr<OutputWorker>> removed;
+				{
+					std::lock_guard<std::mutex> lock(devices_mutex_);
+					auto it = std::stable_partition(outputs_.begin(), outputs_.end(), [&](const std::unique_ptr<OutputWorker>& output) { return output->Sink != device; });
+					std::move(it, outputs_.end(), std::back_inserter(removed));
+					outputs_.erase(it, outputs_.end());
+				}
+				// workers are joined here, outside of the lock, after finishing the frame being pushed
+			}
+
+			OutputSinkStatistics GetOutputSinkStatistics(const std::shared_ptr<OutputSink>& device) const
+			{
 				std::lock_guard<std::mutex> lock(devices_mutex_);
-				outputs_.erase(std::remove(outputs_.begin(), outputs_.end(), device), outputs_.end());
+				for (auto& output : outputs_)
+					if (output->Sink == device)
+						return output->GetStatistics();
+				return OutputSinkStatistics{ 0, 0LL, 0LL };
 			}
 
 			void SetFrameClockSource(Player& self, FrameClockSource& clock)
@@ -177,6 +276,11 @@ namespace TVPlayR {
 				});
 			}
 
+			PlayerTransitionStatistics GetTransitionStatistics() const
+			{
+				return PlayerTransitionStatistics{ transitions_, transition_lost_frames_ };
+			}
+
 			void SetVolume(float volume)
 			{
 				executor_.begin_invoke([this, volume]
@@ -202,6 +306,8 @@ namespace TVPlayR {
 			impl_->RemoveOutputSink(sink);
 		}
 
+		OutputSinkStatistics Player::GetOutputSinkStatistics(std::shared_ptr<OutputSink> sink) const { return impl_->GetOutputSinkStatistics(sink); }
+
 		void Player::SetFrameClockSource(FrameClockSource& clock) { impl_->SetFrameClockSource(*this, clock); }
 
 		void Player::RequestFrame(int audio_samples_count) { impl_->RequestFrame(audio_samples_count); }
@@ -240,6 +346,35 @@ namespace TVPlayR {
 
 		void Player::SetAudioVolumeCallback(AUDIO_VOLUME_CALLBACK callback) { impl_->SetAudioVolumeCallback(callback); }
 
+		void Player::SetTransitionCrossfade(std::int64_t duration) { impl_->transition_crossfade_ = FFMAX(duration, 0LL); }
+
+		PlayerTransitionStatistics Player::GetTransitionStatistics() const { return impl_->GetTransitionStatistics(); }
+
+		void Player::SetBufferSettings(const PlayerBufferSettings& settings)
+		{
+			std::lock_guard<std::mutex> lock(impl_->settings_mutex_);
+			impl_->buffer_settings_ = settings;
+		}
+
+		PlayerBufferSettings Player::GetBufferSettings() const
+		{
+			std::lock_guard<std::mutex> lock(impl_->settings_mutex_);
+			return impl_->buffer_settings_;
+		}
+
+		void Player::SetScalingSettings(const PlayerScalingSettings& settings)
+		{
+			std::lock_guard<std::mutex> lock(impl_->settings_mutex_);
+			impl_->scaling_settings_ = settings;
+			impl_->scaling_settings_.ThreadCount = FFMAX(settings.ThreadCount, 0);
+		}
+
+		PlayerScalingSettings Player::GetScalingSettings() const
+		{
+			std::lock_guard<std::mutex> lock(impl_->settings_mutex_);
+			return impl_->scaling_settings_;
+		}
+
 		const std::string& Player::Name() const { return impl_->name_; }
 
 
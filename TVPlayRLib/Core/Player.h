@@ -12,6 +12,44 @@ namespace TVPlayR {
 		class VideoFormat;
 		enum class VideoFormatType;
 
+struct OutputSinkStatistics
+{
+	size_t QueueDepth;
+	std::int64_t Pushed;
+	std::int64_t Dropped;
+};
+
+// limits of the buffer every input keeps between its decoders and the player
+struct PlayerBufferSettings
+{
+	std::int64_t Duration = AV_TIME_BASE; // high watermark: decoding stops when this much video (and audio) is buffered...
+	size_t MaxBytes = 0; // ...or when decoded frames take that many bytes, 0 - no limit
+	int LowWatermarkPercent = 50; // decoding resumes when the buffer falls below that part of the high watermark
+	// above twice the high watermark the oldest frames are dropped
+};
+
+enum class ScalerAlgorithm
+{
+	fast_bilinear,
+	bilinear,
+	bicubic, // swscale's default
+	lanczos,
+	spline
+};
+
+// scaling, pixel format conversion and deinterlacing of the inputs to the player's format
+struct PlayerScalingSettings
+{
+	int ThreadCount = 0; // slice threads of each filter graph (bwdif, yadif, scale) and swscale context, 0 - as many as cores
+	ScalerAlgorithm Algorithm = ScalerAlgorithm::bicubic;
+};
+
+struct PlayerTransitionStatistics
+{
+	std::int64_t Transitions; // changes to the source loaded with LoadNext
+	std::int64_t LostFrames; // frames the last frame of previous source was repeated, because the next one wasn't ready
+};
+
 class ClockTarget {
 public:
 	virtual void RequestFrame(int audio_samples_count) = 0;
@@ -26,6 +64,7 @@ public:
 	virtual ~Player();
 	void AddOutputSink(std::shared_ptr<OutputSink> device);
 	void RemoveOutputSink(std::shared_ptr<OutputSink> device);
+	OutputSinkStatistics GetOutputSinkStatistics(std::shared_ptr<OutputSink> device) const;
 	void SetFrameClockSource(FrameClockSource& clock);
 	void RequestFrame(int audio_samples_count) override;
 	void Load(std::shared_ptr<InputSource> source);
@@ -39,6 +78,15 @@ public:
 	const AVSampleFormat AudioSampleFormat() const;
 	const int AudioSampleRate() const;
 	void SetVolume(float volume);
+	// duration (in AV_TIME_BASE units) of the crossfade from audio left after the end of playing source to the source loaded with LoadNext, 0 cuts it
+	void SetTransitionCrossfade(std::int64_t duration);
+	PlayerTransitionStatistics GetTransitionStatistics() const;
+	// applies to inputs added to the player later
+	void SetBufferSettings(const PlayerBufferSettings& settings);
+	PlayerBufferSettings GetBufferSettings() const;
+	// applies to inputs added to the player later
+	void SetScalingSettings(const PlayerScalingSettings& settings);
+	PlayerScalingSettings GetScalingSettings() const;
 	void SetAudioVolumeCallback(AUDIO_VOLUME_CALLBACK callback);
 	const std::string& Name() const;
 private:
@@ -2,8 +2,7 @@
 #include "TimecodeOverlay.h"
 #include <gdiplus.h>
 #include "AVSync.h"
-#include "../FFmpeg/SwScale.h"
-#include "../FFmpeg/FFmpegUtils.h"
+#include "OverlayBlend.h"
 #include "VideoFormat.h"
 #include "../PixelFormat.h"
 #include "../TimecodeOutputSource.h"
@@ -29,71 +28,94 @@ namespace TVPlayR {
 			const TimecodeOutputSource			timecode_source_;
 			const VideoFormat					video_format_;
 			const TVPlayR::PixelFormat			output_pixel_format_;
-			std::unique_ptr<FFmpeg::SwScale>	in_scaler_;
-			std::unique_ptr<FFmpeg::SwScale>	out_scaler_;
-			Gdiplus::SolidBrush					background_;
-			Gdiplus::SolidBrush					foreground_;
+			const OverlayColor					background_ = { 150, 16, 16, 16 };
+			const OverlayColor					foreground_ = { 255, 232, 232, 232 };
 			Gdiplus::Font						font_;
 			Gdiplus::StringFormat				timecode_format_;
-			float								scale_x_; // for formats with non-square pixels
-			Gdiplus::Rect						background_rect_;
-			Gdiplus::PointF						timecode_position_;
+			const float							scale_x_; // for formats with non-square pixels
+			const Gdiplus::Rect					background_rect_;
+			GlyphAtlas							glyph_atlas_;
+			TextMask							text_mask_;
 
 
 			implementation::implementation(const TimecodeOutputSource source, const VideoFormatType video_format, TVPlayR::PixelFormat output_pixel_format)
 				: timecode_source_(source)
 				, video_format_(video_format)
 				, output_pixel_format_(output_pixel_format)
-				, background_rect_(GetBackgroundRect())
-				, background_(Gdiplus::Color(150, 16, 16, 16))
-				, foreground_(Gdiplus::Color(255, 232, 232, 232))
 				, font_(L"Tahoma", static_cast<Gdiplus::REAL>(video_format_.height() / 7), Gdiplus::FontStyle::FontStyleBold, Gdiplus::Unit::UnitPixel)
-				, timecode_position_(background_rect_.Width / (scale_x_ * 2), static_cast<Gdiplus::REAL>(background_rect_.Height * 21 / 40))
 				, scale_x_(static_cast<float>(video_format_.SampleAspectRatio().Denominator()) / video_format_.SampleAspectRatio().Numerator())
+				, background_rect_(GetBackgroundRect())
+				, glyph_atlas_(GetGlyphWidth(), background_rect_.Height)
+				, text_mask_(glyph_atlas_, background_rect_.Width, background_rect_.Height)
 			{
 				timecode_format_.SetAlignment(Gdiplus::StringAlignmentCenter);
 				timecode_format_.SetLineAlignment(Gdiplus::StringAlignmentCenter);
+				RenderGlyphs();
 			}
 
 
 			Gdiplus::Rect GetBackgroundRect()
 			{
+				// even position and width, as UYVY pixels are blended in pairs
 				int height = video_format_.height() / 6;
-				int width = static_cast<int>(video_format_.height() * scale_x_);
-				return Gdiplus::Rect((video_format_.width() - width) / 2 , video_format_.height() - (height * 4 / 3) , width, height);
+				int width = static_cast<int>(video_format_.height() * scale_x_) & ~1;
+				return Gdiplus::Rect(((video_format_.width() - width) / 2) & ~1, video_format_.height() - (height * 4 / 3), width, height);
+			}
+
+			int GetGlyphWidth()
+			{
+				Gdiplus::Bitmap measure_bitmap(1, 1, PixelFormat32bppARGB);
+				Gdiplus::Graphics measure_graphics(&measure_bitmap);
+				Gdiplus::RectF digit_bounds;
+				measure_graphics.MeasureString(L"0", 1, &font_, Gdiplus::PointF(0.0f, 0.0f), Gdiplus::StringFormat::GenericTypographic(), &digit_bounds);
+				return static_cast<int>(std::ceil(digit_bounds.Width * scale_x_)) + 2;
+			}
+
+			// renders the characters used in timecodes once, with the same font and vertical position the whole string was drawn before
+			void RenderGlyphs()
+			{
+				const int cell_width = glyph_atlas_.CellWidth();
+				const int cell_height = glyph_atlas_.CellHeight();
+				Gdiplus::SolidBrush brush(Gdiplus::Color(255, 255, 255, 255));
+				for (char c : std::string("0123456789:;.-"))
+				{
+					Gdiplus::Bitmap glyph_bitmap(cell_width, cell_height, PixelFormat32bppARGB);
+					Gdiplus::Graphics glyph_graphics(&glyph_bitmap);
+					glyph_graphics.Clear(Gdiplus::Color(0, 0, 0, 0));
+					glyph_graphics.ScaleTransform(scale_x_, 1.0);
+					glyph_graphics.SetTextRenderingHint(Gdiplus::TextRenderingHint::TextRenderingHintAntiAlias);
+					wchar_t glyph_str[2] = { static_cast<wchar_t>(c), L'\0' };
+					glyph_graphics.DrawString(glyph_str, 1, &font_, Gdiplus::PointF(cell_width / (scale_x_ * 2), static_cast<Gdiplus::REAL>(cell_height * 21 / 40)), &timecode_format_, &brush);
+					glyph_graphics.Flush(Gdiplus::FlushIntentionSync);
+					Gdiplus::Rect lock_rect(0, 0, cell_width, cell_height);
+					Gdiplus::BitmapData bitmap_data;
+					if (glyph_bitmap.LockBits(&lock_rect, Gdiplus::ImageLockModeRead, PixelFormat32bppARGB, &bitmap_data) != Gdiplus::Ok)
+						THROW_EXCEPTION("TimecodeOverlay: unable to render glyph");
+					std::uint8_t* glyph = glyph_atlas_.AddGlyph(c);
+					for (int y = 0; y < cell_height; y++)
+					{
+						const std::uint8_t* argb = static_cast<const std::uint8_t*>(bitmap_data.Scan0) + static_cast<ptrdiff_t>(y) * bitmap_data.Stride;
+						for (int x = 0; x < cell_width; x++)
+							glyph[y * cell_width + x] = argb[x * 4 + 3]; // white text, the alpha is the coverage
+					}
+					glyph_bitmap.UnlockBits(&bitmap_data);
+				}
 			}
 
 			Core::AVSync Transform(Core::AVSync& sync)
 			{
 				if (!sync.Video)
 					return sync;
-				std::shared_ptr<AVFrame>& input_frame = sync.Video;
-				assert(input_frame->width == video_format_.width() && input_frame->height == video_format_.height());
-				if (!out_scaler_ && input_frame->format != AV_PIX_FMT_BGRA)
-					out_scaler_ = std::make_unique<FFmpeg::SwScale>(video_format_.width(), video_format_.height(), AV_PIX_FMT_BGRA, input_frame->width, input_frame->height, static_cast<AVPixelFormat>(input_frame->format));
-				if (!in_scaler_ && input_frame->format != AV_PIX_FMT_BGRA)
-					in_scaler_ = std::make_unique<FFmpeg::SwScale>(input_frame->width, input_frame->height, static_cast<AVPixelFormat>(input_frame->format), input_frame->width, input_frame->height, AV_PIX_FMT_BGRA);
-				std::shared_ptr<AVFrame> rgba_frame = in_scaler_ ? in_scaler_->Scale(input_frame) : FFmpeg::CopyFrame(input_frame);
 				std::int64_t time = TimecodeFromFameTimeInfo(sync.TimeInfo, timecode_source_);
-				if (time != AV_NOPTS_VALUE)
-					Draw(rgba_frame, GetTimeString(time));
-				// if incomming frame pixel format is AV_PIX_FMT_BGRA we draw directly on the frame
-				return Core::AVSync(sync.Audio, out_scaler_ ? out_scaler_->Scale(rgba_frame) : rgba_frame, sync.TimeInfo);
-			}
-
-			void Draw(std::shared_ptr<AVFrame>& video, std::string timecode_str)
-			{
-				Gdiplus::Bitmap frame_bitmap(video->width, video->height, video->linesize[0], PixelFormat32bppARGB, video->data[0]);
-				Gdiplus::Graphics frame_graphics(&frame_bitmap);
-				frame_graphics.FillRectangle(&background_, background_rect_);
-				CA2W ca2w(timecode_str.c_str());
-				Gdiplus::Bitmap overlay_bitmap(background_rect_.Width, background_rect_.Height, PixelFormat32bppARGB);
-				Gdiplus::Graphics overlay_graphics(&overlay_bitmap);
-				overlay_graphics.ScaleTransform(scale_x_, 1.0);
-				overlay_graphics.SetTextRenderingHint(Gdiplus::TextRenderingHint::TextRenderingHintAntiAlias);
-				overlay_graphics.DrawString(ca2w, -1, &font_, timecode_position_, &timecode_format_, &foreground_);
-				frame_graphics.DrawImage(&overlay_bitmap, background_rect_);
-				frame_graphics.Flush(Gdiplus::FlushIntentionSync);
+				if (time == AV_NOPTS_VALUE)
+					return sync;
+				assert(sync.Video->width == video_format_.width() && sync.Video->height == video_format_.height());
+				text_mask_.Update(GetTimeString(time)); // copies glyphs of changed characters only
+				Core::AVSync result(std::move(sync)); // a copy would share the frame and MakeVideoWritable() would always copy it
+				// only background_rect_ is blended, in the native pixel format of the frame
+				std::shared_ptr<AVFrame> rows = result.MakeVideoWritable(background_rect_.Y, background_rect_.Height);
+				BlendOverlay(rows.get(), background_rect_.X, text_mask_.Data(), text_mask_.Width(), text_mask_.Height(), background_, foreground_);
+				return result;
 			}
 
 			std::string GetTimeString(int64_t time)
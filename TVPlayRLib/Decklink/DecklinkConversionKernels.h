@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "../Common/CpuFeatures.h"
+#ifdef CPU_X64
+#include <immintrin.h>
+#endif
+
+// kernels of DecklinkVideoFrame conversion, without dependencies on the precompiled header and Decklink SDK, so the benchmark can build them on its own
+
+#define DECKLINK_CONVERSION_ROWS_PER_SLICE 270
+
+namespace TVPlayR {
+	namespace Decklink {
+
+// X2RGB10LE keeps 10-bit components at bits 0-29, Decklink RGBXLE expects them at bits 2-31
+typedef void(*CONVERSION_KERNEL)(const uint32_t* source, uint32_t* destination, size_t count);
+
+inline void ShiftPixelsScalar(const uint32_t* source, uint32_t* destination, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		destination[i] = source[i] << 2;
+}
+
+#ifdef CPU_X64
+
+inline void ShiftPixelsSse2(const uint32_t* source, uint32_t* destination, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_slli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)), 2));
+	ShiftPixelsScalar(source + i, destination + i, count - i);
+}
+
+CPU_TARGET("avx2") inline void ShiftPixelsAvx2(const uint32_t* source, uint32_t* destination, size_t count)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+		__m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i + 8));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_slli_epi32(first, 2));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i + 8), _mm256_slli_epi32(second, 2));
+	}
+	_mm256_zeroupper();
+	ShiftPixelsSse2(source + i, destination + i, count - i);
+}
+
+CPU_TARGET("avx512f") inline void ShiftPixelsAvx512(const uint32_t* source, uint32_t* destination, size_t count)
+{
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32)
+	{
+		__m512i first = _mm512_loadu_si512(source + i);
+		__m512i second = _mm512_loadu_si512(source + i + 16);
+		_mm512_storeu_si512(destination + i, _mm512_slli_epi32(first, 2));
+		_mm512_storeu_si512(destination + i + 16, _mm512_slli_epi32(second, 2));
+	}
+	_mm256_zeroupper();
+	ShiftPixelsSse2(source + i, destination + i, count - i);
+}
+
+#endif // CPU_X64
+
+// the widest kernel the CPU and OS support
+inline CONVERSION_KERNEL GetConversionKernel()
+{
+#ifdef CPU_X64
+	const Common::CpuFeatures& features = Common::CpuFeatures::Instance();
+	if (features.HasAvx512())
+		return ShiftPixelsAvx512;
+	if (features.HasAvx2())
+		return ShiftPixelsAvx2;
+	return ShiftPixelsSse2;
+#else
+	return ShiftPixelsScalar;
+#endif // CPU_X64
+}
+
+}}
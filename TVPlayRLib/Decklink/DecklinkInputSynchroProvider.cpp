@@ -29,7 +29,7 @@ namespace TVPlayR {
 
 		void DecklinkInputSynchroProvider::Push(Core::AVSync& sync)
 		{
-			executor_.begin_invoke([=] {
+			executor_.post([=] {
 				if (process_video_ && sync.Video)
 				{
 					if (!scaler_)
@@ -40,7 +40,8 @@ namespace TVPlayR {
 				}
 				if (sync.Audio)
 				{
-					audio_fifo_.TryPush(audio_resampler_.Resample(sync.Audio));
+					if (auto resampled = audio_resampler_.Resample(sync.Audio))
+						audio_fifo_.TryPush(resampled);
 				}
 			});
 		}
@@ -31,8 +31,9 @@ namespace TVPlayR {
 			std::atomic_int64_t scheduled_frames_;
 			std::atomic_int64_t  scheduled_samples_;
 			int audio_channels_count_ = 0;
-			Common::BlockingCollection<Core::AVSync> input_buffer_;
-			Common::BlockingCollection<DecklinkVideoFrame*> decklink_frames_recycler_;
+			Common::SpscRing<Core::AVSync> input_buffer_;
+			std::unique_ptr<Common::WorkerPool> conversion_pool_;
+			std::unique_ptr<Common::SpscRing<DecklinkVideoFrame*>> decklink_frames_recycler_;
 			std::shared_ptr<AVFrame> last_video_;
 			std::atomic_int64_t last_video_time_;
 			const DecklinkKeyerType keyer_;
@@ -118,7 +119,7 @@ namespace TVPlayR {
 			{
 				std::int64_t frame_time = scheduled_frames_ * format_.FrameRate().Denominator();
 				DecklinkVideoFrame* decklink_frame;
-				if (decklink_frames_recycler_.take(decklink_frame) != Common::BlockingCollectionStatus::Ok)
+				if (decklink_frames_recycler_->try_take(decklink_frame) != Common::BlockingCollectionStatus::Ok)
 				{
 					DebugPrintLine(Common::DebugSeverity::warning, "ScheduleVideo: Can't take frame from recycler");
 					return;
@@ -138,7 +139,7 @@ namespace TVPlayR {
 			void RecycleDecklinkFrame(DecklinkVideoFrame* decklink_frame)
 			{
 				decklink_frame->Recycle();
-				if (decklink_frames_recycler_.add(decklink_frame) != Common::BlockingCollectionStatus::Ok)
+				if (decklink_frames_recycler_->try_add(decklink_frame) != Common::BlockingCollectionStatus::Ok)
 					decklink_frame->Release(); // if the frame is added to recycler, then decklink output will release it.
 			}
 
@@ -179,10 +180,13 @@ namespace TVPlayR {
 				audio_channels_count_ = audio_channel_count;
 				audio_resampler_ = std::make_unique<FFmpeg::SwResample>(audio_channel_count, audio_sample_rate, AVSampleFormat::AV_SAMPLE_FMT_FLT, audio_channels_count_, bmdAudioSampleRate48kHz, AVSampleFormat::AV_SAMPLE_FMT_S32);
 				last_video_time_ = 0LL;
-				decklink_frames_recycler_.activate();
+				// only 10-bit RGB frames need conversion before they are sent to the card
+				int conversion_threads = pixel_format == PixelFormat::rgb10 ? FFMIN(DecklinkVideoFrame::ConversionSlicesCount(format_.height()), static_cast<int>(std::thread::hardware_concurrency())) - 1 : 0;
+				conversion_pool_ = std::make_unique<Common::WorkerPool>("Frame conversion for Decklink " + std::to_string(index_), FFMAX(conversion_threads, 0));
+				decklink_frames_recycler_ = std::make_unique<Common::SpscRing<DecklinkVideoFrame*>>(preroll_buffer_size_ + 1);
 				for (size_t i = 0; i < preroll_buffer_size_ + 1; i++)
 				{
-					DecklinkVideoFrame* decklink_frame = new DecklinkVideoFrame(format_);
+					DecklinkVideoFrame* decklink_frame = new DecklinkVideoFrame(format_, PixelFormatToFFmpegFormat(pixel_format_), *conversion_pool_);
 					decklink_frame->AddRef();
 					RecycleDecklinkFrame(decklink_frame);
 				}
@@ -202,8 +206,8 @@ namespace TVPlayR {
 					output_->DisableAudioOutput();
 				output_->DisableVideoOutput();
 				DecklinkVideoFrame* decklink_frame;
-				decklink_frames_recycler_.complete_adding();
-				while (decklink_frames_recycler_.take(decklink_frame) == Common::BlockingCollectionStatus::Ok)
+				decklink_frames_recycler_->complete_adding();
+				while (decklink_frames_recycler_->try_take(decklink_frame) == Common::BlockingCollectionStatus::Ok)
 					decklink_frame->Release();
 				audio_resampler_.reset();
 			}
@@ -236,9 +240,9 @@ namespace TVPlayR {
 
 			void Push(Core::AVSync& sync)
 			{
-				overlay_executor_.begin_invoke([sync, this]
+				overlay_executor_.post([sync, this]() mutable
 					{
-						Core::AVSync transformed(sync);
+						Core::AVSync transformed(std::move(sync));
 						for (auto& overlay : overlays_)
 							transformed = overlay->Transform(transformed);
 						if (input_buffer_.try_add(transformed) != Common::BlockingCollectionStatus::Ok)
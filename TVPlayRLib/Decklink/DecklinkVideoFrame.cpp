@@ -2,30 +2,27 @@
 #include "DecklinkVideoFrame.h"
 #include "../Core/VideoFormat.h"
 #include "../FFmpeg/FFmpegUtils.h"
-#include <execution>
-#include <emmintrin.h>
+#include "DecklinkConversionKernels.h"
+
+#define DECKLINK_CONVERSION_BUFFER_ALIGN 64
 
 namespace TVPlayR {
 	namespace Decklink {
 
-		static void ConvertFrame(const std::shared_ptr<AVFrame>& source, std::vector<uint32_t>& dest)
+		static void ConvertFrame(const std::shared_ptr<AVFrame>& source, uint8_t* destination, Common::WorkerPool& pool)
 		{
-			if (source->format == AV_PIX_FMT_X2RGB10LE)
-			{
-				int slices[] = { 0, 1, 2, 3 };
-				size_t slice_length = source->linesize[0] * source->height / (sizeof(__m128i) * (sizeof(slices) / sizeof(int)));
-				std::for_each(std::execution::par, std::begin(slices), std::end(slices), [&](int slice) -> void
-					{
-						__m128i* src_data = reinterpret_cast<__m128i*>(source->data[0]) + (slice_length * slice);
-						__m128i* dst_data = reinterpret_cast<__m128i*>(dest.data()) + (slice_length * slice);
-						for (size_t i = 0; i < slice_length; i++)
-						{
-							__m128i data = _mm_load_si128(src_data + i);
-							data = _mm_slli_epi32(data, 2);
-							_mm_store_si128(dst_data + i, data);
-						};
-					});
-			}
+			static const CONVERSION_KERNEL kernel = GetConversionKernel();
+			const size_t row_bytes = source->linesize[0];
+			const int slices = DecklinkVideoFrame::ConversionSlicesCount(source->height);
+			const int slice_rows = (source->height + slices - 1) / slices;
+			pool.ParallelFor(slices, [&](size_t slice)
+				{
+					const int first_row = static_cast<int>(slice) * slice_rows;
+					const int rows = FFMIN(slice_rows, source->height - first_row);
+					if (rows <= 0)
+						return;
+					kernel(reinterpret_cast<const uint32_t*>(source->data[0] + first_row * row_bytes), reinterpret_cast<uint32_t*>(destination + first_row * row_bytes), row_bytes * rows / sizeof(uint32_t));
+				});
 		}
 
 		static BMDPixelFormat GetBMDPixelFormat(const std::shared_ptr<AVFrame>& frame)
@@ -43,14 +40,32 @@ namespace TVPlayR {
 			}
 		}
 
-		DecklinkVideoFrame::DecklinkVideoFrame(Core::VideoFormat& format)
-			: ref_count_(0)
+		DecklinkVideoFrame::DecklinkVideoFrame(Core::VideoFormat& format, AVPixelFormat pixel_format, Common::WorkerPool& conversion_pool)
+			: conversion_pool_(conversion_pool)
+			, buffer_(nullptr, av_free)
+			, buffer_size_(0)
+			, converted_(false)
+			, ref_count_(0)
 			, width_(0)
 			, height_(0)
 			, row_bytes_(0)
 			, pixel_format_(BMDPixelFormat(0))
 			, timecode_(format)
-		{ }
+		{
+			if (pixel_format == AV_PIX_FMT_X2RGB10LE)
+			{
+				// the size of FFmpeg frame with default alignment, so the buffer is allocated once
+				buffer_size_ = static_cast<size_t>(FFALIGN(format.width() * 4, DECKLINK_CONVERSION_BUFFER_ALIGN)) * format.height();
+				buffer_.reset(static_cast<uint8_t*>(av_malloc(buffer_size_)));
+				if (!buffer_)
+					THROW_EXCEPTION("DecklinkVideoFrame: conversion buffer not allocated");
+			}
+		}
+
+		int DecklinkVideoFrame::ConversionSlicesCount(int height)
+		{
+			return FFMAX(1, height / DECKLINK_CONVERSION_ROWS_PER_SLICE);
+		}
 
 		DecklinkVideoFrame::~DecklinkVideoFrame()
 		{
@@ -67,14 +82,22 @@ namespace TVPlayR {
 
 			if (frame->format == AV_PIX_FMT_X2RGB10LE)
 			{
-				buffer_.resize(width_ * height_);
-				ConvertFrame(frame, buffer_);
+				const size_t required_size = static_cast<size_t>(frame->linesize[0]) * frame->height;
+				if (required_size > buffer_size_)
+				{
+					buffer_.reset(static_cast<uint8_t*>(av_malloc(required_size)));
+					buffer_size_ = buffer_ ? required_size : 0;
+					if (!buffer_)
+						THROW_EXCEPTION("DecklinkVideoFrame: conversion buffer not allocated");
+				}
+				ConvertFrame(frame, buffer_.get(), conversion_pool_);
+				converted_ = true;
 				frame_.reset();
 			}
 			else
 			{
 				frame_ = frame;
-				buffer_.clear();
+				converted_ = false;
 			}
 		}
 
@@ -107,9 +130,9 @@ namespace TVPlayR {
 
 		HRESULT STDMETHODCALLTYPE DecklinkVideoFrame::GetBytes(void** buffer)
 		{
-			if (!buffer_.empty())
+			if (converted_)
 			{
-				*buffer = buffer_.data();
+				*buffer = buffer_.get();
 				return S_OK;
 			}
 			if (frame_ && frame_->data[0])
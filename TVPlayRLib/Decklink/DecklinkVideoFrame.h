@@ -11,16 +11,22 @@ namespace TVPlayR {
 		{
 		private:
 			std::shared_ptr<AVFrame> frame_;
-			std::vector<uint32_t> buffer_;
+			Common::WorkerPool& conversion_pool_;
+			std::unique_ptr<uint8_t, void(*)(void*)> buffer_; // holds converted frame, kept for the whole frame life
+			size_t buffer_size_;
+			bool converted_;
 			ULONG ref_count_;
 			int width_, height_;
 			int row_bytes_;
 			BMDPixelFormat pixel_format_;
 			DecklinkTimecode timecode_;
 		public:
-			DecklinkVideoFrame(Core::VideoFormat& format);
+			DecklinkVideoFrame(Core::VideoFormat& format, AVPixelFormat pixel_format, Common::WorkerPool& conversion_pool);
 			virtual ~DecklinkVideoFrame();
 
+			// number of slices the frame of that height is converted in, the conversion pool needs no more threads than this
+			static int ConversionSlicesCount(int height);
+
 			void Update(Core::VideoFormat& format, const std::shared_ptr<AVFrame>& frame, std::int64_t timecode);
 			void Recycle();
 		
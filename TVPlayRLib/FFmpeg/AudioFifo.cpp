@@ -19,7 +19,7 @@ AudioFifo::AudioFifo(AVSampleFormat sample_fmt, int channels_count, int sample_r
 bool AudioFifo::TryPush(std::shared_ptr<AVFrame> frame)
 {
 	assert(frame->format == sample_fmt_);
-    DebugPrintLine(Common::DebugSeverity::trace, "Pushed audio frame to fifo: " + std::to_string(static_cast<float>(PtsToTime(frame->pts, time_base_)) / AV_TIME_BASE) + ", duration: " + std::to_string(PtsToTime(frame->duration, time_base_) / 1000) + " ms");
+    DebugPrintLineLazy(Common::DebugSeverity::trace, "Pushed audio frame to fifo: " + std::to_string(static_cast<float>(PtsToTime(frame->pts, time_base_)) / AV_TIME_BASE) + ", duration: " + std::to_string(PtsToTime(frame->duration, time_base_) / 1000) + " ms");
 	int fifo_space = av_audio_fifo_space(aduio_fifo_.get());
 	int fifo_size = av_audio_fifo_size(aduio_fifo_.get());
 	if (frame->nb_samples * 2 > fifo_space + fifo_size)
@@ -33,7 +33,7 @@ bool AudioFifo::TryPush(std::shared_ptr<AVFrame> frame)
 	{
 		if (fifo_space < frame->nb_samples)
 			return false;
-		if (av_audio_fifo_write(aduio_fifo_.get(), (void**)frame->data, frame->nb_samples) != frame->nb_samples)
+		if (av_audio_fifo_write(aduio_fifo_.get(), (void**)frame->extended_data, frame->nb_samples) != frame->nb_samples)
 			THROW_EXCEPTION("AudioFifo: not all audio samples were written to fifo");
 		end_sample_ += frame->nb_samples;
 		if (frame_start_time <= seek_time_) // first frame
@@ -58,28 +58,30 @@ std::shared_ptr<AVFrame> AudioFifo::Pull(int nb_samples)
 	int samples_in_fifo = av_audio_fifo_size(aduio_fifo_.get());
 	if (nb_samples < 0)
 		return nullptr;
-	auto frame(AllocFrame());
-	frame->nb_samples = nb_samples;
-	frame->format = sample_fmt_;
-	frame->ch_layout = channel_layout_;
-	frame->sample_rate = sample_rate_;
+	auto frame(nb_samples > 0 ? AllocPooledAudioFrame(nb_samples, channel_layout_, sample_fmt_, sample_rate_) : AllocFrame());
+	if (nb_samples == 0)
+	{
+		frame->format = sample_fmt_;
+		frame->ch_layout = channel_layout_;
+		frame->sample_rate = sample_rate_;
+	}
 	frame->pts = av_rescale(start_sample_, time_base_.den, static_cast<std::int64_t>(sample_rate_) * time_base_.num);
 	int samples_from_fifo = min(samples_in_fifo, nb_samples);
 	if (nb_samples > 0)
 	{
-		THROW_ON_FFMPEG_ERROR(av_frame_get_buffer(frame.get(), 0));
-		int readed = av_audio_fifo_read(aduio_fifo_.get(), (void**)frame->data, samples_from_fifo);
+		int readed = av_audio_fifo_read(aduio_fifo_.get(), (void**)frame->extended_data, samples_from_fifo);
 		if (readed >= 0)
 			start_sample_ += readed;
 		assert(readed == samples_from_fifo);
 	}
 	if (samples_from_fifo < nb_samples)
 	{
-		av_samples_set_silence(frame->data, samples_from_fifo, nb_samples - samples_from_fifo, channel_layout_.nb_channels, sample_fmt_);
-		DebugPrintLine(Common::DebugSeverity::debug, "Filled audio with silence at time: " + std::to_string(static_cast<float>(PtsToTime(frame->pts, time_base_)) / AV_TIME_BASE) + ", duration: " + std::to_string(av_rescale(nb_samples - samples_from_fifo, AV_TIME_BASE, frame->sample_rate) / 1000) + " ms");
+		av_samples_set_silence(frame->extended_data, samples_from_fifo, nb_samples - samples_from_fifo, channel_layout_.nb_channels, sample_fmt_);
+		DebugRecord(Common::DebugSeverity::debug, "silence filled", frame->pts, nb_samples - samples_from_fifo);
+		DebugPrintLineLazy(Common::DebugSeverity::debug, "Filled audio with silence at time: " + std::to_string(static_cast<float>(PtsToTime(frame->pts, time_base_)) / AV_TIME_BASE) + ", duration: " + std::to_string(av_rescale(nb_samples - samples_from_fifo, AV_TIME_BASE, frame->sample_rate) / 1000) + " ms");
 	}
 	else
-		DebugPrintLine(Common::DebugSeverity::trace, "Pulled audio frame from fifo at time: " + std::to_string(static_cast<float>(PtsToTime(frame->pts, time_base_)) / AV_TIME_BASE) + ", duration: " + std::to_string(av_rescale(frame->nb_samples, AV_TIME_BASE, frame->sample_rate) / 1000) + " ms");
+		DebugPrintLineLazy(Common::DebugSeverity::trace, "Pulled audio frame from fifo at time: " + std::to_string(static_cast<float>(PtsToTime(frame->pts, time_base_)) / AV_TIME_BASE) + ", duration: " + std::to_string(av_rescale(frame->nb_samples, AV_TIME_BASE, frame->sample_rate) / 1000) + " ms");
 	return frame;
 }
 
@@ -90,7 +92,7 @@ void AudioFifo::DiscardSamples(int nb_samples)
 		nb_samples = samples_in_fifo;
 	if (nb_samples <= 0)
 		return;
-	DebugPrintLine(Common::DebugSeverity::debug,"Audio samples discarded: " + std::to_string(nb_samples));
+	DebugPrintLineLazy(Common::DebugSeverity::debug,"Audio samples discarded: " + std::to_string(nb_samples));
 	if (av_audio_fifo_drain(aduio_fifo_.get(), nb_samples) == 0)
 		start_sample_ += nb_samples;
 }
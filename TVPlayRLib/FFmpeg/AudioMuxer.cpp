@@ -1,67 +1,103 @@
 #include "../pch.h"
 #include "AudioMuxer.h"
 #include "Decoder.h"
-#include "AudioFifo.h"
+#include "SwResample.h"
 #include "FFmpegUtils.h"
+#include "../Core/AudioChannelMapEntry.h"
+#include "AudioMuxerKernels.h"
 
 
 namespace TVPlayR {
 	namespace FFmpeg {
 
+struct AudioMuxer::Input
+{
+	const int StreamIndex;
+	const AVRational TimeBase;
+	// converts frames not in float or not in the output sample rate, created for the format of the first frame
+	std::unique_ptr<SwResample> Resampler;
+	AVSampleFormat ResamplerSampleFormat = AV_SAMPLE_FMT_NONE;
+	int ResamplerSampleRate = 0;
+	int ResamplerChannelsCount = 0;
+	// samples waiting for the other inputs, only if there are more inputs
+	std::unique_ptr<AVAudioFifo, void(*)(AVAudioFifo*)> Fifo;
+	AVSampleFormat FifoSampleFormat = AV_SAMPLE_FMT_NONE;
+	int FifoChannelsCount = 0;
+
+	Input(int stream_index, AVRational time_base)
+		: StreamIndex(stream_index)
+		, TimeBase(time_base)
+		, Fifo(nullptr, [](AVAudioFifo* fifo) { av_audio_fifo_free(fifo); })
+	{ }
+
+	int FifoSize() const { return Fifo ? av_audio_fifo_size(Fifo.get()) : 0; }
+};
+
 AudioMuxer::AudioMuxer(const std::vector<std::unique_ptr<Decoder>>& decoders, std::int64_t output_channel_layout, const AVSampleFormat sample_format, const int sample_rate, const int nb_channels)
 	: Common::DebugTarget(Common::DebugSeverity::info, "Audio muxer")
 	, FilterBase::FilterBase()
 	, decoders_(decoders)
-	, input_time_base_(decoders.empty() ? av_make_q(1, sample_rate) : decoders[0]->TimeBase())
 	, output_sample_rate_(sample_rate)
 	, nb_channels_(nb_channels)
-	, output_channel_layout_(output_channel_layout)
 	, audio_sample_format_(sample_format)
-{ 
-	filter_str_ = GetAudioMuxerString(sample_rate);
-	Reset();
+{
+	if (std::find_if(decoders_.begin(), decoders_.end(), [](const std::unique_ptr<Decoder>& decoder) -> bool { return decoder->MediaType() != AVMEDIA_TYPE_AUDIO; }) != decoders_.end())
+		THROW_EXCEPTION("AudioMuxer: got non-audio stream")
+	// the layout is used only if it has the player's number of channels
+	if (av_popcount64(output_channel_layout) == nb_channels)
+	{
+		THROW_ON_FFMPEG_ERROR(av_channel_layout_from_mask(&output_channel_layout_, output_channel_layout));
+	}
+	else
+		av_channel_layout_default(&output_channel_layout_, nb_channels);
+	for (const auto& decoder : decoders_)
+		inputs_.emplace_back(std::make_unique<Input>(decoder->StreamIndex(), decoder->TimeBase()));
+	SetChannelMap({});
 }
 
-std::string AudioMuxer::GetAudioMuxerString(const int sample_rate)
+AudioMuxer::~AudioMuxer() { }
+
+void AudioMuxer::SetChannelMap(const std::vector<Core::AudioChannelMapEntry>& channel_map)
 {
-	std::ostringstream filter;
-	int total_nb_channels = std::accumulate(decoders_.begin(), decoders_.end(), 0, [](int sum, const std::unique_ptr<Decoder>& curr) { return sum + curr->AudioChannelsCount(); });
-	if (decoders_.size() > 1)
+	channel_sources_.assign(nb_channels_, ChannelSource{ -1, 0 });
+	if (channel_map.empty())
 	{
-		for (int i = 0; i < decoders_.size(); i++)
-			filter << "[a" << i << "]";
-		filter << "amerge=inputs=" << decoders_.size() << ",";
-		if (total_nb_channels > 2)
-			filter << "channelmap=0|1:stereo,";
-		if (total_nb_channels == 1)
-			filter << "channelmap=0|0:stereo,";
+		std::vector<ChannelSource> merged;
+		for (int i = 0; i < static_cast<int>(decoders_.size()); i++)
+			for (int channel = 0; channel < decoders_[i]->AudioChannelsCount(); channel++)
+				merged.push_back(ChannelSource{ i, channel });
+		if (merged.size() == 1)
+			std::fill(channel_sources_.begin(), channel_sources_.end(), merged[0]);
+		else
+			std::copy_n(merged.begin(), FFMIN(merged.size(), channel_sources_.size()), channel_sources_.begin());
+		return;
 	}
-	else
+	for (size_t i = 0; i < channel_sources_.size() && i < channel_map.size(); i++)
 	{
-		if (total_nb_channels > 2)
-			filter << "[a0]channelmap=0|1:stereo,";
-		if (total_nb_channels == 1)
-			filter << "[a0]channelmap=0|0:stereo,";
-		if (total_nb_channels == 2)
-			filter << "[a0]";
+		const Core::AudioChannelMapEntry& entry = channel_map[i];
+		auto input = std::find_if(inputs_.begin(), inputs_.end(), [&entry](const std::unique_ptr<Input>& input) { return input->StreamIndex == entry.StreamIndex; });
+		if (input == inputs_.end() || entry.ChannelNumber < 0)
+		{
+			DebugPrintLine(Common::DebugSeverity::warning, "Channel " + std::to_string(i) + " silent, stream " + std::to_string(entry.StreamIndex) + " channel " + std::to_string(entry.ChannelNumber) + " not found");
+			continue;
+		}
+		channel_sources_[i] = ChannelSource{ static_cast<int>(input - inputs_.begin()), entry.ChannelNumber };
 	}
-	filter << "aresample=out_sample_fmt=" << av_get_sample_fmt_name(audio_sample_format_) << ":out_sample_rate=" << sample_rate;
-	return filter.str();
 }
 
 int AudioMuxer::OutputSampleRate()
 {
-	return av_buffersink_get_sample_rate(sink_ctx_);
+	return output_sample_rate_;
 }
 
 int AudioMuxer::OutputChannelsCount()
 {
-	return av_buffersink_get_channels(sink_ctx_);
+	return nb_channels_;
 }
 
 AVRational AudioMuxer::OutputTimeBase() const
 {
-	return av_buffersink_get_time_base(sink_ctx_);
+	return av_make_q(1, output_sample_rate_);
 }
 
 AVSampleFormat AudioMuxer::OutputSampleFormat()
@@ -69,46 +105,160 @@ AVSampleFormat AudioMuxer::OutputSampleFormat()
 	return audio_sample_format_;
 }
 
+std::shared_ptr<AVFrame> AudioMuxer::Convert(Input& input, const std::shared_ptr<AVFrame>& frame)
+{
+	if (frame->sample_rate == output_sample_rate_ && (frame->format == AV_SAMPLE_FMT_FLT || frame->format == AV_SAMPLE_FMT_FLTP))
+		return frame;
+	const int channels = frame->ch_layout.nb_channels;
+	if (!input.Resampler || input.ResamplerSampleFormat != frame->format || input.ResamplerSampleRate != frame->sample_rate || input.ResamplerChannelsCount != channels)
+	{
+		DebugPrintLine(Common::DebugSeverity::debug, "Stream " + std::to_string(input.StreamIndex) + " resampled from " + av_get_sample_fmt_name(static_cast<AVSampleFormat>(frame->format)) + ", " + std::to_string(frame->sample_rate) + " Hz");
+		input.Resampler = std::make_unique<SwResample>(channels, frame->sample_rate, static_cast<AVSampleFormat>(frame->format), channels, output_sample_rate_, AV_SAMPLE_FMT_FLTP);
+		input.ResamplerSampleFormat = static_cast<AVSampleFormat>(frame->format);
+		input.ResamplerSampleRate = frame->sample_rate;
+		input.ResamplerChannelsCount = channels;
+	}
+	return input.Resampler->Resample(frame);
+}
+
 void AudioMuxer::Push(int stream_index, std::shared_ptr<AVFrame> frame)
 {
-	auto dest = std::find_if(std::begin(source_ctx_), std::end(source_ctx_), [&stream_index](const std::pair<int, AVFilterContext*>& ctx) {return ctx.first == stream_index; });
-	if (dest == std::end(source_ctx_))
+	auto input = std::find_if(inputs_.begin(), inputs_.end(), [stream_index](const std::unique_ptr<Input>& input) { return input->StreamIndex == stream_index; });
+	if (input == inputs_.end())
 		THROW_EXCEPTION("AudioMuxer: stream not found");
-	DebugPrintLine(Common::DebugSeverity::trace, "Pushed to muxer:   " + std::to_string(PtsToTime(frame->pts, input_time_base_) / 1000));
-	int ret = av_buffersrc_write_frame(dest->second, frame.get());
-	switch (ret)
+	DebugPrintLineLazy(Common::DebugSeverity::trace, "Pushed to muxer:   " + std::to_string(PtsToTime(frame->pts, (*input)->TimeBase) / 1000));
+	if (next_pts_ == AV_NOPTS_VALUE && frame->pts != AV_NOPTS_VALUE)
+		next_pts_ = av_rescale_q(frame->pts, (*input)->TimeBase, OutputTimeBase());
+	auto converted = Convert(**input, frame);
+	if (!converted || converted->nb_samples <= 0)
+		return;
+	if (inputs_.size() == 1)
+	{
+		Output({ converted.get() }, converted->nb_samples);
+		return;
+	}
+	Input& merged = **input;
+	const int channels = converted->ch_layout.nb_channels;
+	if (!merged.Fifo || merged.FifoSampleFormat != converted->format || merged.FifoChannelsCount != channels)
+	{
+		if (merged.FifoSize() > 0)
+			DebugPrintLine(Common::DebugSeverity::warning, "Stream " + std::to_string(stream_index) + " changed format, " + std::to_string(merged.FifoSize()) + " samples dropped");
+		merged.Fifo.reset(av_audio_fifo_alloc(static_cast<AVSampleFormat>(converted->format), channels, converted->nb_samples));
+		if (!merged.Fifo)
+			THROW_EXCEPTION("AudioMuxer: fifo not allocated");
+		merged.FifoSampleFormat = static_cast<AVSampleFormat>(converted->format);
+		merged.FifoChannelsCount = channels;
+	}
+	if (av_audio_fifo_write(merged.Fifo.get(), reinterpret_cast<void**>(converted->extended_data), converted->nb_samples) != converted->nb_samples)
+		THROW_EXCEPTION("AudioMuxer: not all audio samples were written to fifo");
+	Merge(false);
+}
+
+// outputs samples present in all the inputs, or in any of them when flushing, missing ones are silent
+void AudioMuxer::Merge(bool flush)
+{
+	int samples_count = flush ? 0 : INT_MAX;
+	for (const auto& input : inputs_)
+		samples_count = flush ? FFMAX(samples_count, input->FifoSize()) : FFMIN(samples_count, input->FifoSize());
+	if (samples_count <= 0)
+		return;
+	std::vector<std::shared_ptr<AVFrame>> frames;
+	std::vector<const AVFrame*> sources;
+	for (const auto& input : inputs_)
+	{
+		if (!input->Fifo)
+		{
+			sources.push_back(nullptr);
+			continue;
+		}
+		AVChannelLayout layout;
+		av_channel_layout_default(&layout, input->FifoChannelsCount);
+		auto frame = AllocPooledAudioFrame(samples_count, layout, input->FifoSampleFormat, output_sample_rate_);
+		int read = av_audio_fifo_read(input->Fifo.get(), reinterpret_cast<void**>(frame->extended_data), samples_count);
+		THROW_ON_FFMPEG_ERROR(read);
+		if (read < samples_count)
+			THROW_ON_FFMPEG_ERROR(av_samples_set_silence(frame->extended_data, read, samples_count - read, input->FifoChannelsCount, input->FifoSampleFormat));
+		frames.push_back(frame);
+		sources.push_back(frame.get());
+	}
+	Output(sources, samples_count);
+}
+
+void AudioMuxer::Output(const std::vector<const AVFrame*>& sources, int samples_count)
+{
+	static const INTERLEAVE_KERNEL interleave = GetInterleaveKernel();
+	const bool planar_output = audio_sample_format_ == AV_SAMPLE_FMT_FLTP;
+	auto frame = AllocPooledAudioFrame(samples_count, output_channel_layout_, planar_output ? AV_SAMPLE_FMT_FLTP : AV_SAMPLE_FMT_FLT, output_sample_rate_);
+	// first sample of each output channel and distance between its samples, nullptr - silence
+	std::vector<const float*> channels(nb_channels_, nullptr);
+	std::vector<int> strides(nb_channels_, 1);
+	for (int i = 0; i < nb_channels_; i++)
+	{
+		const ChannelSource& source = channel_sources_[i];
+		const AVFrame* input = source.Input >= 0 ? sources[source.Input] : nullptr;
+		if (!input || source.Channel >= input->ch_layout.nb_channels)
+			continue;
+		if (input->format == AV_SAMPLE_FMT_FLTP)
+			channels[i] = reinterpret_cast<const float*>(input->extended_data[source.Channel]);
+		else
+		{
+			channels[i] = reinterpret_cast<const float*>(input->extended_data[0]) + source.Channel;
+			strides[i] = input->ch_layout.nb_channels;
+		}
+	}
+	if (planar_output)
+	{
+		for (int i = 0; i < nb_channels_; i++)
+		{
+			float* destination = reinterpret_cast<float*>(frame->extended_data[i]);
+			if (!channels[i])
+				std::fill_n(destination, samples_count, 0.0f);
+			else if (strides[i] == 1)
+				std::copy_n(channels[i], samples_count, destination);
+			else
+				for (int sample = 0; sample < samples_count; sample++)
+					destination[sample] = channels[i][sample * strides[i]];
+		}
+	}
+	else
 	{
-	case 0:
-		break;
-	case AVERROR(EINVAL):
-		Initialize();
-		Push(stream_index, frame);
-		break;
-	default:
-		THROW_ON_FFMPEG_ERROR(ret);
-	}		
+		float* destination = reinterpret_cast<float*>(frame->extended_data[0]);
+		bool is_interleaved_copy = channels[0] && strides[0] == nb_channels_;
+		for (int i = 1; i < nb_channels_ && is_interleaved_copy; i++)
+			is_interleaved_copy = channels[i] == channels[0] + i && strides[i] == nb_channels_;
+		if (is_interleaved_copy)
+			std::copy_n(channels[0], static_cast<size_t>(samples_count) * nb_channels_, destination);
+		else if (nb_channels_ == 2 && channels[0] && channels[1] && strides[0] == 1 && strides[1] == 1)
+			interleave(channels[0], channels[1], destination, samples_count);
+		else
+			for (int i = 0; i < nb_channels_; i++)
+				for (int sample = 0; sample < samples_count; sample++)
+					destination[sample * nb_channels_ + i] = channels[i] ? channels[i][sample * strides[i]] : 0.0f;
+	}
+	frame->pts = next_pts_ == AV_NOPTS_VALUE ? 0LL : next_pts_;
+	next_pts_ = frame->pts + samples_count;
+	if (audio_sample_format_ != AV_SAMPLE_FMT_FLT && !planar_output)
+	{
+		if (!output_converter_)
+			output_converter_ = std::make_unique<SwResample>(nb_channels_, output_sample_rate_, AV_SAMPLE_FMT_FLT, nb_channels_, output_sample_rate_, audio_sample_format_);
+		frame = output_converter_->Resample(frame);
+		if (!frame)
+			return;
+	}
+	output_frames_.push_back(frame);
 }
 
 std::shared_ptr<AVFrame> AudioMuxer::Pull()
 {
-	auto frame = AllocFrame();
-	int ret = av_buffersink_get_frame(sink_ctx_, frame.get());
-	switch (ret)
+	if (output_frames_.empty())
 	{
-		case 0: 
-			DebugPrintLine(Common::DebugSeverity::trace, "Pulled from muxer: " + std::to_string(PtsToTime(frame->pts, av_buffersink_get_time_base(sink_ctx_)) / 1000));
-			return frame;
-		case AVERROR(EAGAIN):
-			break;
-		case AVERROR_EOF:
+		if (is_flushed_)
 			is_eof_ = true;
-			break;
-		default:
-			THROW_ON_FFMPEG_ERROR(ret);
-			break;
-	}
-	if (ret < 0)
 		return nullptr;
+	}
+	auto frame = output_frames_.front();
+	output_frames_.pop_front();
+	DebugPrintLineLazy(Common::DebugSeverity::trace, "Pulled from muxer: " + std::to_string(PtsToTime(frame->pts, OutputTimeBase()) / 1000));
 	return frame;
 }
 
@@ -117,90 +267,34 @@ void AudioMuxer::Flush()
 	if (is_flushed_)
 		return;
 	is_flushed_ = true;
-	for (const auto& ctx : source_ctx_)
-		av_buffersrc_write_frame(ctx.second, NULL);
+	for (const auto& input : inputs_)
+	{
+		if (!input->Resampler)
+			continue;
+		auto delayed = input->Resampler->Flush();
+		if (!delayed)
+			continue;
+		if (inputs_.size() == 1)
+			Output({ delayed.get() }, delayed->nb_samples);
+		else if (input->Fifo && input->FifoSampleFormat == delayed->format && input->FifoChannelsCount == delayed->ch_layout.nb_channels)
+			av_audio_fifo_write(input->Fifo.get(), reinterpret_cast<void**>(delayed->extended_data), delayed->nb_samples);
+	}
+	if (inputs_.size() > 1)
+		Merge(true);
 }
 
 void AudioMuxer::Reset()
 {
-	Initialize();
-}
-
-
-void AudioMuxer::Initialize()
-{
-	if (std::find_if(decoders_.begin(), decoders_.end(), [](const std::unique_ptr<Decoder>& decoder) -> bool { return decoder->MediaType() != AVMEDIA_TYPE_AUDIO; }) != decoders_.end())
-		THROW_EXCEPTION("AudioMuxer::Initialize() got non-audio stream")
-
-	source_ctx_.clear();
-	is_eof_ = false;
-	is_flushed_ = false;
-	graph_.reset(avfilter_graph_alloc());
-
-	AVSampleFormat out_sample_fmts[] = { audio_sample_format_, AV_SAMPLE_FMT_NONE };
-	std::int64_t out_channel_layouts[] = { output_channel_layout_ , -1 };
-	int out_sample_rates[] = { output_sample_rate_, -1 };
-
-	AVFilterInOut * inputs = avfilter_inout_alloc();
-	AVFilterInOut * outputs = avfilter_inout_alloc();
-
-	try
-	{
-		const AVFilter *buffersrc = avfilter_get_by_name("abuffer");
-		const AVFilter *buffersink = avfilter_get_by_name("abuffersink");
-
-		THROW_ON_FFMPEG_ERROR(avfilter_graph_create_filter(&sink_ctx_, buffersink, "aout", NULL, NULL, graph_.get()));
-		THROW_ON_FFMPEG_ERROR(av_opt_set_int_list(sink_ctx_, "sample_fmts", out_sample_fmts, AV_SAMPLE_FMT_NONE, AV_OPT_SEARCH_CHILDREN));
-		THROW_ON_FFMPEG_ERROR(av_opt_set_int_list(sink_ctx_, "channel_layouts", out_channel_layouts, -1, AV_OPT_SEARCH_CHILDREN));
-		THROW_ON_FFMPEG_ERROR(av_opt_set_int_list(sink_ctx_, "sample_rates", out_sample_rates, -1, AV_OPT_SEARCH_CHILDREN));
-
-		char args[512];
-		AVFilterInOut * current_output = outputs;
-		for (int i = 0; i < decoders_.size(); i++)
-		{
-			auto ch_layout = decoders_[i]->AudioChannelLayout();
-			if (!ch_layout)
-				THROW_EXCEPTION("AudioMuxer: decoder's AudioChannelLayout empty");
-			int ret = snprintf(args, sizeof(args),
-				"time_base=%d/%d:sample_rate=%d:sample_fmt=%s:channel_layout=",
-				decoders_[i]->TimeBase().num, decoders_[i]->TimeBase().den, decoders_[i]->AudioSampleRate(),
-				av_get_sample_fmt_name(decoders_[i]->AudioSampleFormat()));
-			av_channel_layout_describe(ch_layout, args + ret, sizeof(args) - ret);
-			auto new_source = std::pair<int, AVFilterContext*>(decoders_[i]->StreamIndex(), NULL);
-			THROW_ON_FFMPEG_ERROR(avfilter_graph_create_filter(&new_source.second, buffersrc, "ain", args, NULL, graph_.get()));
-
-			snprintf(args, sizeof(args), "a%d", i);
-			current_output->name = av_strdup(args);
-			current_output->filter_ctx = new_source.second;
-			current_output->pad_idx = 0;
-			if (i == decoders_.size() - 1)
-				current_output->next = NULL;
-			else
-			{
-				current_output->next = avfilter_inout_alloc();
-				current_output = current_output->next;
-			}
-			//THROW_ON_FFMPEG_ERROR(avfilter_link(new_source.second, 0, sink_ctx_, i));
-			source_ctx_.push_back(new_source);
-		}
-
-		inputs->name = av_strdup("out");
-		inputs->filter_ctx = sink_ctx_;
-		inputs->pad_idx = 0;
-		inputs->next = NULL;
-		if (avfilter_graph_parse_ptr(graph_.get(), filter_str_.c_str(), &inputs, &outputs, NULL) < 0)
-			THROW_EXCEPTION("AudioMuxer: avfilter_graph_parse_ptr failed")
-		if (avfilter_graph_config(graph_.get(), NULL) < 0)
-			THROW_EXCEPTION("AudioMuxer: avfilter_graph_config failed")
-		if (DebugSeverity() <= Common::DebugSeverity::debug)
-			DumpFilter(filter_str_, graph_.get());
-	}
-	catch (const std::exception& e)
+	for (const auto& input : inputs_)
 	{
-		std::cout << e.what();
-		avfilter_inout_free(&inputs);
-		avfilter_inout_free(&outputs);
+		input->Resampler.reset();
+		if (input->Fifo)
+			av_audio_fifo_reset(input->Fifo.get());
 	}
+	output_frames_.clear();
+	next_pts_ = AV_NOPTS_VALUE;
+	is_eof_ = false;
+	is_flushed_ = false;
 }
 
-}}
\ No newline at end of file
+}}
@@ -1,15 +1,26 @@
 #pragma once
 #include "FilterBase.h"
+#include <deque>
 
 namespace TVPlayR {
+	namespace Core {
+		class AudioChannelMapEntry;
+	}
 	namespace FFmpeg {
-		
+
 class Decoder;
+class SwResample;
 
+/// <summary>
+/// Merges audio of the decoders into the output channels, without a filter graph.
+/// Float input at the output sample rate is routed as it is, other streams are converted by swresample first.
+/// Streams are merged sample by sample, so with more than one stream the output waits for the slowest of them.
+/// </summary>
 class AudioMuxer final : public FilterBase, private Common::DebugTarget
 {
 public:
 	AudioMuxer(const std::vector<std::unique_ptr<Decoder>>& decoders, const std::int64_t output_channel_layout, const AVSampleFormat sample_format, const int sample_rate, const int nb_channels);
+	~AudioMuxer();
 	int OutputSampleRate();
 	int OutputChannelsCount();
 	AVRational OutputTimeBase() const override;
@@ -18,18 +29,29 @@ public:
 	std::shared_ptr<AVFrame> Pull() override;
 	void Flush() override;
 	void Reset();
+	// output channel n gets the channel of n-th entry, channels without a valid entry are silent
+	// empty map: channels of all the streams in order, mono stream to all the channels
+	void SetChannelMap(const std::vector<Core::AudioChannelMapEntry>& channel_map);
 private:
-	std::string GetAudioMuxerString(const int sample_rate);
-	void Initialize();
+	struct Input;
+	struct ChannelSource
+	{
+		int Input; // -1 - silence
+		int Channel;
+	};
 	const std::vector<std::unique_ptr<Decoder>>& decoders_;
-	std::vector<std::pair<int, AVFilterContext*>> source_ctx_;
-	const AVRational input_time_base_;
+	std::vector<std::unique_ptr<Input>> inputs_;
+	std::vector<ChannelSource> channel_sources_;
 	const int nb_channels_;
-	const std::int64_t output_channel_layout_;
+	AVChannelLayout output_channel_layout_;
 	const int output_sample_rate_;
 	const AVSampleFormat audio_sample_format_;
-	AVFilterContext* sink_ctx_ = NULL;
-	std::string filter_str_;
+	std::int64_t next_pts_ = AV_NOPTS_VALUE; // 1/output_sample_rate_ time base
+	std::deque<std::shared_ptr<AVFrame>> output_frames_;
+	std::unique_ptr<SwResample> output_converter_; // only if the output sample format isn't float
+	std::shared_ptr<AVFrame> Convert(Input& input, const std::shared_ptr<AVFrame>& frame);
+	void Merge(bool flush);
+	void Output(const std::vector<const AVFrame*>& sources, int samples_count);
 };
 
-}}
\ No newline at end of file
+}}
@@ -0,0 +1,53 @@
+#pragma once
+#include "../Common/CpuFeatures.h"
+#ifdef CPU_X64
+#include <immintrin.h>
+#endif
+
+// sample interleaving of AudioMuxer, without dependencies on the precompiled header, so the benchmark can build it on its own
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+// two planar channels to interleaved stereo
+typedef void(*INTERLEAVE_KERNEL)(const float* left, const float* right, float* destination, int samples_count);
+
+inline void InterleaveStereoScalar(const float* left, const float* right, float* destination, int samples_count)
+{
+	for (int i = 0; i < samples_count; i++)
+	{
+		destination[2 * i] = left[i];
+		destination[2 * i + 1] = right[i];
+	}
+}
+
+#ifdef CPU_X64
+
+CPU_TARGET("avx2") inline void InterleaveStereoAvx2(const float* left, const float* right, float* destination, int samples_count)
+{
+	int i = 0;
+	for (; i + 8 <= samples_count; i += 8)
+	{
+		__m256 l = _mm256_loadu_ps(left + i);
+		__m256 r = _mm256_loadu_ps(right + i);
+		__m256 low = _mm256_unpacklo_ps(l, r); // samples 0, 1 and 4, 5
+		__m256 high = _mm256_unpackhi_ps(l, r); // samples 2, 3 and 6, 7
+		_mm256_storeu_ps(destination + 2 * i, _mm256_permute2f128_ps(low, high, 0x20));
+		_mm256_storeu_ps(destination + 2 * i + 8, _mm256_permute2f128_ps(low, high, 0x31));
+	}
+	_mm256_zeroupper();
+	InterleaveStereoScalar(left + i, right + i, destination + 2 * i, samples_count - i);
+}
+
+#endif // CPU_X64
+
+inline INTERLEAVE_KERNEL GetInterleaveKernel()
+{
+#ifdef CPU_X64
+	if (Common::CpuFeatures::Instance().HasAvx2())
+		return InterleaveStereoAvx2;
+#endif // CPU_X64
+	return InterleaveStereoScalar;
+}
+
+}}
@@ -0,0 +1,158 @@
+#include "../pch.h"
+#include "ClipCache.h"
+#include "FFmpegUtils.h"
+#include "../Core/Player.h"
+#include "../Core/VideoFormat.h"
+#include "../PixelFormat.h"
+#include <filesystem>
+#include <list>
+#include <map>
+#include <tuple>
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+std::shared_ptr<DecodedClip> CreateDecodedClip(const std::vector<std::shared_ptr<AVFrame>>& video, const AVRational video_time_base, std::int64_t video_frame_duration, const std::vector<std::shared_ptr<AVFrame>>& audio, const AVRational audio_time_base)
+{
+	if (video.empty())
+		THROW_EXCEPTION("CreateDecodedClip: no video frames");
+	auto clip = std::make_shared<DecodedClip>();
+	clip->VideoTimeBase = video_time_base;
+	clip->EndTime = PtsToTime(video.back()->pts, video_time_base) + video_frame_duration;
+	clip->Bytes = 0;
+	clip->Frames.reserve(video.size());
+	for (const auto& frame : video)
+	{
+		clip->Frames.push_back(DecodedClipFrame{ frame, {} });
+		clip->Bytes += FrameBytes(frame.get());
+	}
+	size_t index = 0;
+	for (const auto& frame : audio)
+	{
+		std::int64_t start = PtsToTime(frame->pts, audio_time_base);
+		std::int64_t samples_left = av_rescale(clip->EndTime - start, frame->sample_rate, AV_TIME_BASE);
+		if (samples_left <= 0)
+			break;
+		auto cut = frame->nb_samples > samples_left ? CopyAudioSamples(frame, 0, static_cast<int>(samples_left), audio_time_base) : frame;
+		while (index + 1 < clip->Frames.size() && PtsToTime(clip->Frames[index].Video->pts, video_time_base) + video_frame_duration <= start)
+			index++;
+		clip->Frames[index].Audio.push_back(cut);
+		clip->Bytes += FrameBytes(cut.get());
+	}
+	return clip;
+}
+
+bool ClipCacheKey::operator<(const ClipCacheKey& other) const
+{
+	return std::tie(FileName, FileSize, FileTime, VideoFormat, PixelFormat, AudioSampleFormat, AudioChannelsCount, AudioSampleRate, ScalerAlgorithm, ScalerThreadCount)
+		< std::tie(other.FileName, other.FileSize, other.FileTime, other.VideoFormat, other.PixelFormat, other.AudioSampleFormat, other.AudioChannelsCount, other.AudioSampleRate, other.ScalerAlgorithm, other.ScalerThreadCount);
+}
+
+struct ClipCache::implementation
+{
+	typedef std::list<std::pair<ClipCacheKey, std::shared_ptr<const DecodedClip>>> LruList;
+
+	mutable std::mutex mutex_;
+	LruList lru_; // most recently used first
+	std::map<ClipCacheKey, LruList::iterator> index_;
+	size_t budget_;
+	size_t bytes_ = 0;
+	std::int64_t requests_ = 0LL;
+	std::int64_t hits_ = 0LL;
+
+	implementation(size_t budget)
+		: budget_(budget)
+	{ }
+
+	// called with mutex_ locked
+	void Evict()
+	{
+		while (bytes_ > budget_ && !lru_.empty())
+		{
+			bytes_ -= lru_.back().second->Bytes;
+			index_.erase(lru_.back().first);
+			lru_.pop_back();
+		}
+	}
+
+	std::shared_ptr<const DecodedClip> Find(const ClipCacheKey& key)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		requests_++;
+		auto it = index_.find(key);
+		if (it == index_.end())
+			return nullptr;
+		hits_++;
+		lru_.splice(lru_.begin(), lru_, it->second);
+		return it->second->second;
+	}
+
+	void Add(const ClipCacheKey& key, const std::shared_ptr<const DecodedClip>& clip)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!clip || clip->Bytes > budget_ || clip->Bytes > CLIP_CACHE_MAX_CLIP_BYTES)
+			return;
+		auto it = index_.find(key);
+		if (it != index_.end())
+		{
+			bytes_ -= it->second->second->Bytes;
+			lru_.erase(it->second);
+			index_.erase(it);
+		}
+		lru_.emplace_front(key, clip);
+		index_.emplace(key, lru_.begin());
+		bytes_ += clip->Bytes;
+		Evict();
+	}
+};
+
+ClipCache::ClipCache(size_t budget)
+	: impl_(std::make_unique<implementation>(budget))
+{ }
+
+ClipCache::~ClipCache() { }
+
+bool ClipCache::MakeKey(const std::string& file_name, const Core::Player& player, ClipCacheKey& key)
+{
+	std::error_code error;
+	std::filesystem::path path(file_name);
+	std::int64_t size = static_cast<std::int64_t>(std::filesystem::file_size(path, error));
+	if (error)
+		return false;
+	std::int64_t time = static_cast<std::int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+	if (error)
+		return false;
+	const Core::PlayerScalingSettings scaling = player.GetScalingSettings();
+	key = ClipCacheKey{
+		file_name,
+		size,
+		time,
+		static_cast<int>(player.Format().type()),
+		static_cast<int>(player.PixelFormat()),
+		static_cast<int>(player.AudioSampleFormat()),
+		player.AudioChannelsCount(),
+		player.AudioSampleRate(),
+		static_cast<int>(scaling.Algorithm),
+		scaling.ThreadCount
+	};
+	return true;
+}
+
+std::shared_ptr<const DecodedClip> ClipCache::Find(const ClipCacheKey& key) { return impl_->Find(key); }
+
+void ClipCache::Add(const ClipCacheKey& key, const std::shared_ptr<const DecodedClip>& clip) { impl_->Add(key, clip); }
+
+void ClipCache::SetBudget(size_t budget)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	impl_->budget_ = budget;
+	impl_->Evict();
+}
+
+ClipCacheStatistics ClipCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return ClipCacheStatistics{ impl_->requests_, impl_->hits_, impl_->bytes_, impl_->lru_.size(), impl_->budget_ };
+}
+
+}}
@@ -0,0 +1,73 @@
+#pragma once
+
+#define CLIP_CACHE_MAX_CLIP_BYTES (256 * 1024 * 1024) // bigger clips are not added, whatever decoded them
+
+namespace TVPlayR {
+	namespace Core {
+		class Player;
+	}
+	namespace FFmpeg {
+
+struct DecodedClipFrame
+{
+	std::shared_ptr<AVFrame> Video; // in player's format
+	std::vector<std::shared_ptr<AVFrame>> Audio; // samples starting before the end of the video frame
+};
+
+struct DecodedClip
+{
+	std::vector<DecodedClipFrame> Frames;
+	AVRational VideoTimeBase;
+	std::int64_t EndTime; // end of the last video frame, AV_TIME_BASE units
+	size_t Bytes;
+};
+
+// groups audio frames with the video frame they start in, audio after the end of the last video frame is cut
+std::shared_ptr<DecodedClip> CreateDecodedClip(const std::vector<std::shared_ptr<AVFrame>>& video, const AVRational video_time_base, std::int64_t video_frame_duration, const std::vector<std::shared_ptr<AVFrame>>& audio, const AVRational audio_time_base);
+
+struct ClipCacheKey
+{
+	std::string FileName;
+	std::int64_t FileSize;
+	std::int64_t FileTime;
+	int VideoFormat; // of the player
+	int PixelFormat;
+	int AudioSampleFormat;
+	int AudioChannelsCount;
+	int AudioSampleRate;
+	int ScalerAlgorithm; // scaling settings of the player the clip was converted with
+	int ScalerThreadCount;
+	bool operator<(const ClipCacheKey& other) const;
+};
+
+struct ClipCacheStatistics
+{
+	std::int64_t Requests;
+	std::int64_t Hits;
+	double HitRate() const { return Requests ? static_cast<double>(Hits) / Requests : 0.0; }
+	size_t ResidentBytes;
+	size_t ClipsCount;
+	size_t Budget;
+};
+
+/// <summary>
+/// Least recently used clips (stills, stings, jingles), decoded and converted to a player's format, held within a memory budget,
+/// so playing them again costs no decoding. A clip is found only if neither the file nor the player's format and scaling settings changed since it was added.
+/// </summary>
+class ClipCache final : Common::NonCopyable
+{
+public:
+	ClipCache(size_t budget);
+	~ClipCache();
+	// returns false if the file can't be cached (e.g. it's an URL)
+	static bool MakeKey(const std::string& file_name, const Core::Player& player, ClipCacheKey& key);
+	std::shared_ptr<const DecodedClip> Find(const ClipCacheKey& key);
+	void Add(const ClipCacheKey& key, const std::shared_ptr<const DecodedClip>& clip);
+	void SetBudget(size_t budget);
+	ClipCacheStatistics GetStatistics() const;
+private:
+	struct implementation;
+	std::unique_ptr<implementation> impl_;
+};
+
+}}
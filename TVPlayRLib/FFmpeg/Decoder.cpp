@@ -31,16 +31,22 @@ struct Decoder::implementation : Common::DebugTarget
 	const int channels_count_;
 	const int sample_rate_;
 	std::deque<std::shared_ptr<AVPacket>> packet_queue_;
+	size_t queue_bytes_ = 0;
+	std::int64_t queue_duration_ = 0LL;
+	std::int64_t eagain_retries_ = 0LL;
+	std::int64_t rejected_packets_ = 0LL;
 	const AVRational time_base_;
 	AVStream* const stream_;
 	const AVMediaType media_type_;
+	const DecoderSettings settings_;
+	int budget_threads_ = 0; // taken from the DecoderThreadBudget
 	unique_ptr<AVBufferRef> hw_device_ctx_;
-	const unique_ptr<AVCodecContext> ctx_;
+	unique_ptr<AVCodecContext> ctx_;
 	std::int64_t seek_pts_;
 	const std::int64_t duration_;
-	std::mutex mutex_;
+	mutable std::mutex mutex_;
 
-	implementation(const AVCodec* codec, AVStream* const stream, std::int64_t seek_time, Core::HwAccel acceleration, const std::string& hw_device_index)
+	implementation(const AVCodec* codec, AVStream* const stream, std::int64_t seek_time, Core::HwAccel acceleration, const std::string& hw_device_index, const DecoderSettings& settings)
 		: Common::DebugTarget(Common::DebugSeverity::info, "Decoder " + std::string(codec->name))
 		, codec_(codec)
 		, ctx_(CreateCodecContext())
@@ -56,11 +62,47 @@ struct Decoder::implementation : Common::DebugTarget
 		, acceleration_(acceleration)
 		, hw_device_index_(hw_device_index)
 		, media_type_(codec ? codec->type : AVMediaType::AVMEDIA_TYPE_UNKNOWN)
+		, settings_(settings)
 		, hw_device_ctx_(NULL, [](AVBufferRef* p) { })
 	{
 
 	}
 
+	~implementation()
+	{
+		if (budget_threads_)
+			DecoderThreadBudget::Instance().Release(budget_threads_);
+	}
+
+	void SetupThreading(AVCodecContext* ctx)
+	{
+		int thread_count = settings_.ThreadCount;
+		if (thread_count <= 0)
+		{
+			if (media_type_ == AVMEDIA_TYPE_VIDEO && settings_.IsBackground)
+				thread_count = DecoderThreadBudget::Instance().GetBackgroundThreadCount();
+			else if (media_type_ == AVMEDIA_TYPE_VIDEO)
+			{
+				thread_count = DecoderThreadBudget::Instance().Acquire();
+				budget_threads_ = thread_count;
+			}
+			else
+				thread_count = 1;
+		}
+		int thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+		if (settings_.ThreadType == DecoderThreadType::frame)
+			thread_type = FF_THREAD_FRAME;
+		else if (settings_.ThreadType == DecoderThreadType::slice || settings_.LowDelay)
+			thread_type = FF_THREAD_SLICE;
+		ctx->thread_count = thread_count;
+		ctx->thread_type = thread_type;
+		if (settings_.LowDelay)
+			ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+		if (settings_.SkipLoopFilter)
+			ctx->skip_loop_filter = AVDISCARD_ALL;
+		DebugPrintLine(Common::DebugSeverity::debug, "threads: " + std::to_string(thread_count) + ", type: " + std::to_string(thread_type));
+	}
+
 	unique_ptr<AVCodecContext> CreateCodecContext()
 	{
 		auto ctx = unique_ptr<AVCodecContext>(
@@ -103,24 +145,53 @@ struct Decoder::implementation : Common::DebugTarget
 		}
 
 		av_opt_set_int(ctx.get(), "refcounted_frames", 1, 0);
-		av_opt_set_int(ctx.get(), "threads", 4, 0);
-		THROW_ON_FFMPEG_ERROR(avcodec_open2(ctx.get(), codec_, NULL));
+		SetupThreading(ctx.get());
+		int ret = avcodec_open2(ctx.get(), codec_, NULL);
+		if (ret < 0 && budget_threads_)
+		{
+			// destructor won't be called when the constructor throws
+			DecoderThreadBudget::Instance().Release(budget_threads_);
+			budget_threads_ = 0;
+		}
+		THROW_ON_FFMPEG_ERROR(ret);
 		DebugPrintLine(Common::DebugSeverity::debug, "created");
 		return ctx;
 	}
 
-	void Push(const std::shared_ptr<AVPacket>& packet)
+	// called with mutex_ locked
+	bool IsQueueFullLocked() const
+	{
+		return !packet_queue_.empty() && (queue_bytes_ >= settings_.MaxQueueBytes || queue_duration_ >= settings_.MaxQueueDuration);
+	}
+
+	std::int64_t PacketDuration(const AVPacket* packet) const
+	{
+		return packet && packet->duration > 0 ? PtsToTime(packet->duration, time_base_) : 0LL;
+	}
+
+	bool Push(const std::shared_ptr<AVPacket>& packet)
 	{
 		assert(!packet || packet->stream_index == stream_index_);
 		std::lock_guard<std::mutex> lock(mutex_);
+		if (packet && IsQueueFullLocked())
+		{
+			rejected_packets_++;
+			DebugRecord(Common::DebugSeverity::debug, "packet queue full", packet->pts, packet_queue_.size());
+			return false;
+		}
 		packet_queue_.push_back(packet);
+		if (packet)
+		{
+			queue_bytes_ += packet->size;
+			queue_duration_ += PacketDuration(packet.get());
+		}
 #ifdef DEBUG
 		if (packet)
 		{
 			if (ctx_->codec_type == AVMEDIA_TYPE_VIDEO)
-				DebugPrintLine(Common::DebugSeverity::trace, "Queued video packet to decoder:  " + std::to_string(PtsToTime(packet->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(packet->duration, time_base_) / 1000));
+				DebugPrintLineLazy(Common::DebugSeverity::trace, "Queued video packet to decoder:  " + std::to_string(PtsToTime(packet->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(packet->duration, time_base_) / 1000));
 			if (ctx_->codec_type == AVMEDIA_TYPE_AUDIO)
-				DebugPrintLine(Common::DebugSeverity::trace, "Queued audio packet to decoder:  " + std::to_string(PtsToTime(packet->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(packet->duration, time_base_) / 1000));
+				DebugPrintLineLazy(Common::DebugSeverity::trace, "Queued audio packet to decoder:  " + std::to_string(PtsToTime(packet->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(packet->duration, time_base_) / 1000));
 		}
 		else
 		{
@@ -130,6 +201,7 @@ struct Decoder::implementation : Common::DebugTarget
 				DebugPrintLine(Common::DebugSeverity::debug, "Queued flush packet to audio decoder");
 		}
 #endif 
+		return true;
 	}
 
 	void PushNextPacket()
@@ -148,18 +220,34 @@ struct Decoder::implementation : Common::DebugTarget
 #ifdef DEBUG
 		if (ctx_->codec_type == AVMEDIA_TYPE_VIDEO)
 			if (packet)
-				DebugPrintLine(Common::DebugSeverity::trace, "Pushed video packet to video decoder: " + std::to_string(PtsToTime(packet->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(packet->duration, time_base_) / 1000));
+				DebugPrintLineLazy(Common::DebugSeverity::trace, "Pushed video packet to video decoder: " + std::to_string(PtsToTime(packet->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(packet->duration, time_base_) / 1000));
 			else
 				DebugPrintLine(Common::DebugSeverity::debug, "Pushed flush packet to video decoder");
 #endif
+		if (packet && media_type_ == AVMEDIA_TYPE_VIDEO)
+		{
+			// frames ending before the seek target are not shown, so those not used as reference needn't be decoded
+			// without the duration only those starting before the target are known to end before it
+			const bool before_seek = packet->duration > 0 ? packet->pts + packet->duration <= seek_pts_ : packet->pts < seek_pts_;
+			AVDiscard skip_frame = packet->pts != AV_NOPTS_VALUE && seek_pts_ != AV_NOPTS_VALUE && before_seek ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+			if (ctx_->skip_frame != skip_frame)
+				ctx_->skip_frame = skip_frame;
+		}
 		int ret = avcodec_send_packet(ctx_.get(), packet.get());
 		switch (ret)
 		{
 		case 0:
+			if (packet)
+			{
+				queue_bytes_ -= packet->size;
+				queue_duration_ -= PacketDuration(packet.get());
+			}
 			packet_queue_.pop_front();
 			break;
 		case AVERROR(EAGAIN):
+			eagain_retries_++;
 			DebugPrintLine(Common::DebugSeverity::debug, "PushNextPacket: error EAGAIN");
+			DebugRecord(Common::DebugSeverity::debug, "send packet EAGAIN", packet ? packet->pts : AV_NOPTS_VALUE);
 			break;
 		case AVERROR_EOF:
 			THROW_EXCEPTION("Decoder: packet pushed after flush");
@@ -191,9 +279,9 @@ struct Decoder::implementation : Common::DebugTarget
 				}
 #ifdef DEBUG
 				if (ctx_->codec_type == AVMEDIA_TYPE_VIDEO)
-					DebugPrintLine(Common::DebugSeverity::trace, "Pulled video frame from decoder: " + std::to_string(PtsToTime(frame->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(frame->duration, time_base_) / 1000) + ", type: " + av_get_picture_type_char(frame->pict_type));
+					DebugPrintLineLazy(Common::DebugSeverity::trace, "Pulled video frame from decoder: " + std::to_string(PtsToTime(frame->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(frame->duration, time_base_) / 1000) + ", type: " + av_get_picture_type_char(frame->pict_type));
 				if (ctx_->codec_type == AVMEDIA_TYPE_AUDIO)
-					DebugPrintLine(Common::DebugSeverity::trace, "Pulled audio frame from decoder: " + std::to_string(PtsToTime(frame->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(frame->duration, time_base_) / 1000));
+					DebugPrintLineLazy(Common::DebugSeverity::trace, "Pulled audio frame from decoder: " + std::to_string(PtsToTime(frame->pts, time_base_) / 1000) + ", duration: " + std::to_string(PtsToTime(frame->duration, time_base_) / 1000));
 #endif 
 				return frame;
 			}
@@ -219,8 +307,19 @@ struct Decoder::implementation : Common::DebugTarget
 	void Seek(const std::int64_t seek_time)
 	{
 		std::lock_guard<std::mutex> lock(mutex_);
-		avcodec_flush_buffers(ctx_.get());
+		if (budget_threads_ && DecoderThreadBudget::Instance().GetShare() != budget_threads_)
+		{
+			// decoders were added or released since the codec was opened, it's reopened with the current share of the cores
+			DecoderThreadBudget::Instance().Release(budget_threads_);
+			budget_threads_ = 0;
+			ctx_ = CreateCodecContext();
+			flush_packet_pushed_ = false;
+		}
+		else
+			avcodec_flush_buffers(ctx_.get());
 		packet_queue_.clear();
+		queue_bytes_ = 0;
+		queue_duration_ = 0LL;
 		is_eof_ = false;
 		flush_packet_received_ = false;
 		seek_pts_ = TimeToPts(seek_time, time_base_);
@@ -228,17 +327,29 @@ struct Decoder::implementation : Common::DebugTarget
 
 };
 
-Decoder::Decoder(const AVCodec* codec, AVStream* const stream, std::int64_t seek_time, Core::HwAccel acceleration, const std::string& hw_device_index)
-	: impl_(std::make_unique<implementation>(codec, stream, seek_time, acceleration, hw_device_index))
+Decoder::Decoder(const AVCodec* codec, AVStream* const stream, std::int64_t seek_time, Core::HwAccel acceleration, const std::string& hw_device_index, const DecoderSettings& settings)
+	: impl_(std::make_unique<implementation>(codec, stream, seek_time, acceleration, hw_device_index, settings))
 { }
 
-Decoder::Decoder(const AVCodec * codec, AVStream * const stream, std::int64_t seek_time)
-	: Decoder(codec, stream, seek_time, Core::HwAccel::none, "")
+Decoder::Decoder(const AVCodec * codec, AVStream * const stream, std::int64_t seek_time, const DecoderSettings& settings)
+	: Decoder(codec, stream, seek_time, Core::HwAccel::none, "", settings)
 { }
 
 Decoder::~Decoder() { }
 
-void Decoder::Push(const std::shared_ptr<AVPacket>& packet) { impl_->Push(packet); }
+bool Decoder::Push(const std::shared_ptr<AVPacket>& packet) { return impl_->Push(packet); }
+
+bool Decoder::IsQueueFull() const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return impl_->IsQueueFullLocked();
+}
+
+DecoderStatistics Decoder::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return DecoderStatistics{ impl_->packet_queue_.size(), impl_->queue_bytes_, impl_->queue_duration_, impl_->eagain_retries_, impl_->rejected_packets_ };
+}
 
 std::shared_ptr<AVFrame> Decoder::Pull() { return impl_->Pull(); }
 
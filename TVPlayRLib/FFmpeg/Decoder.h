@@ -1,16 +1,28 @@
 ﻿#pragma once
 #include "../Core/HwAccel.h"
+#include "DecoderSettings.h"
 
 namespace TVPlayR {
 	namespace FFmpeg {
 
+struct DecoderStatistics
+{
+	size_t QueueDepth; // packets waiting for the codec
+	size_t QueueBytes;
+	std::int64_t QueueDuration;
+	std::int64_t EagainRetries; // packets refused by the codec until it returned decoded frames
+	std::int64_t RejectedPackets; // pushed when the queue was full
+};
+
 class Decoder final : private Common::NonCopyable
 {
 public:
-	Decoder(const AVCodec* codec, AVStream * const stream, std::int64_t seek_time, Core::HwAccel acceleration, const std::string& device_index);
-	Decoder(const AVCodec* codec, AVStream * const stream, std::int64_t seek_time);
+	Decoder(const AVCodec* codec, AVStream * const stream, std::int64_t seek_time, Core::HwAccel acceleration, const std::string& device_index, const DecoderSettings& settings);
+	Decoder(const AVCodec* codec, AVStream * const stream, std::int64_t seek_time, const DecoderSettings& settings);
 	~Decoder();
-	void Push(const std::shared_ptr<AVPacket>& packet);
+	// returns false if the queue is full and the packet wasn't queued, frames have to be pulled first; flush packet (nullptr) is always queued
+	bool Push(const std::shared_ptr<AVPacket>& packet);
+	bool IsQueueFull() const;
 	std::shared_ptr<AVFrame> Pull();
 	const AVRational& TimeBase() const;
 	bool IsFlushed() const;
@@ -24,6 +36,7 @@ public:
 	AVMediaType MediaType() const;
 	const AVRational& FrameRate() const;
 	int StreamIndex() const;
+	DecoderStatistics GetStatistics() const;
 private:
 	struct implementation;
 	std::unique_ptr<implementation> impl_;
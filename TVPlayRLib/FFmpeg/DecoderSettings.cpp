@@ -0,0 +1,93 @@
+#include "../pch.h"
+#include "DecoderSettings.h"
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+#define DECODER_MAX_THREADS 16 // more threads don't speed up decoding, only add frame threading latency
+#define DECODER_BACKGROUND_MAX_THREADS 2
+
+DecoderThreadBudget& DecoderThreadBudget::Instance()
+{
+	static DecoderThreadBudget instance;
+	return instance;
+}
+
+DecoderThreadBudget::DecoderThreadBudget()
+	: core_count_(FFMAX(static_cast<int>(std::thread::hardware_concurrency()), 1))
+{ }
+
+void DecoderThreadBudget::SetCoreCount(int core_count)
+{
+	if (core_count < 1)
+		THROW_EXCEPTION("DecoderThreadBudget: invalid core count " + std::to_string(core_count));
+	std::lock_guard<std::mutex> lock(mutex_);
+	core_count_ = core_count;
+}
+
+int DecoderThreadBudget::GetCoreCount() const 
+{ 
+	std::lock_guard<std::mutex> lock(mutex_);
+	return core_count_;
+}
+
+void DecoderThreadBudget::SetExpectedDecoderCount(int decoder_count)
+{
+	if (decoder_count < 1)
+		THROW_EXCEPTION("DecoderThreadBudget: invalid decoder count " + std::to_string(decoder_count));
+	std::lock_guard<std::mutex> lock(mutex_);
+	expected_decoders_ = decoder_count;
+}
+
+int DecoderThreadBudget::GetExpectedDecoderCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return expected_decoders_;
+}
+
+int DecoderThreadBudget::GetActiveDecoderCount() const 
+{ 
+	std::lock_guard<std::mutex> lock(mutex_);
+	return active_decoders_;
+}
+
+int DecoderThreadBudget::GetUsedThreadCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return used_threads_;
+}
+
+int DecoderThreadBudget::Acquire()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	active_decoders_++;
+	const int thread_count = Share(active_decoders_);
+	used_threads_ += thread_count;
+	return thread_count;
+}
+
+void DecoderThreadBudget::Release(int thread_count)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	active_decoders_--;
+	used_threads_ -= thread_count;
+}
+
+int DecoderThreadBudget::GetShare() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return Share(FFMAX(active_decoders_, 1));
+}
+
+int DecoderThreadBudget::Share(int active_decoders) const
+{
+	return FFMAX(1, FFMIN(core_count_ / FFMAX(active_decoders, expected_decoders_), DECODER_MAX_THREADS));
+}
+
+int DecoderThreadBudget::GetBackgroundThreadCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return FFMAX(1, FFMIN(core_count_ / 4, DECODER_BACKGROUND_MAX_THREADS));
+}
+
+}}
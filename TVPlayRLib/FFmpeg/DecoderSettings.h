@@ -0,0 +1,59 @@
+#pragma once
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+enum class DecoderThreadType
+{
+	automatic, // frame and slice threading, whatever the codec supports
+	frame, // best throughput, but adds a frame of latency per thread
+	slice // lower throughput, no additional latency
+};
+
+struct DecoderSettings
+{
+	int ThreadCount = 0; // 0 - share of the DecoderThreadBudget
+	bool IsBackground = false; // thumbnails and loop heads, with default thread count they don't take threads from the budget
+	DecoderThreadType ThreadType = DecoderThreadType::automatic;
+	bool LowDelay = false; // also prefers slice threading when the thread type is automatic
+	bool SkipLoopFilter = false; // faster, lower quality decoding, for previews
+	// packets waiting for the codec are limited by both, so a codec refusing input can't make the queue grow without limit
+	size_t MaxQueueBytes = 16 * 1024 * 1024;
+	std::int64_t MaxQueueDuration = AV_TIME_BASE; // of packets with known duration
+};
+
+/// <summary>
+/// Cores available for video decoding of all the inputs together.
+/// Video decoders without explicit thread count get an even share: the cores divided by the number of active decoders, or by the expected
+/// number of decoders while fewer are active, so the first ones don't take the cores the next ones will need.
+/// Thread count of an open codec can't change, decoders whose share has changed since they were opened take the new one on seek.
+/// </summary>
+class DecoderThreadBudget final : Common::NonCopyable
+{
+public:
+	static DecoderThreadBudget& Instance();
+	void SetCoreCount(int core_count);
+	int GetCoreCount() const;
+	// number of inputs decoding video together, e.g. a player and its preloaded next input, for every channel
+	void SetExpectedDecoderCount(int decoder_count);
+	int GetExpectedDecoderCount() const;
+	int GetActiveDecoderCount() const;
+	int GetUsedThreadCount() const;
+	// returns thread count for a new decoder and takes it from the budget until Release() is called with it
+	int Acquire();
+	void Release(int thread_count);
+	// thread count a decoder acquiring now would get
+	int GetShare() const;
+	// for background decoders, not taken from the budget
+	int GetBackgroundThreadCount() const;
+private:
+	DecoderThreadBudget();
+	mutable std::mutex mutex_;
+	int core_count_;
+	int expected_decoders_ = 1;
+	int active_decoders_ = 0;
+	int used_threads_ = 0;
+	int Share(int active_decoders) const;
+};
+
+}}
@@ -0,0 +1,111 @@
+#include "../pch.h"
+#include "EmptyFrameProvider.h"
+#include "FFmpegUtils.h"
+#include "../Core/VideoFormat.h"
+#include "../PixelFormat.h"
+#include "../FieldOrder.h"
+#include <map>
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+struct EmptyFrameProvider::implementation
+{
+	struct SilentBuffer
+	{
+		unique_ptr<AVBufferRef> buffer;
+		int capacity;
+	};
+
+	std::mutex audio_mutex_;
+	std::mutex video_mutex_;
+	std::map<std::pair<int, AVSampleFormat>, SilentBuffer> silent_buffers_;
+	std::map<std::pair<Core::VideoFormatType, TVPlayR::PixelFormat>, std::shared_ptr<AVFrame>> empty_video_frames_;
+
+	static void FreeBuffer(AVBufferRef* buffer) { av_buffer_unref(&buffer); }
+
+	std::shared_ptr<AVFrame> GetSilentAudioFrame(int samples_count, int num_channels, AVSampleFormat format, int sample_rate)
+	{
+		if (samples_count <= 0)
+			return nullptr;
+		assert(num_channels <= 63);
+		if (av_sample_fmt_is_planar(format) && num_channels > AV_NUM_DATA_POINTERS)
+			THROW_EXCEPTION("EmptyFrameProvider: too many planes in silent audio frame");
+		auto frame = AllocFrame();
+		frame->format = format;
+		av_channel_layout_default(&frame->ch_layout, num_channels);
+		frame->nb_samples = samples_count;
+		frame->sample_rate = sample_rate;
+		std::lock_guard<std::mutex> lock(audio_mutex_);
+		SilentBuffer& silence = silent_buffers_.try_emplace(std::make_pair(num_channels, format), SilentBuffer{ unique_ptr<AVBufferRef>(nullptr, FreeBuffer), 0 }).first->second;
+		if (silence.capacity < samples_count)
+		{
+			// frames already handed out keep their own reference to the previous buffer
+			int buffer_size = av_samples_get_buffer_size(NULL, num_channels, samples_count, format, 0);
+			THROW_ON_FFMPEG_ERROR(buffer_size);
+			silence.buffer.reset(av_buffer_alloc(buffer_size));
+			if (!silence.buffer)
+				THROW_EXCEPTION("EmptyFrameProvider: audio buffer not allocated");
+			uint8_t* planes[AV_NUM_DATA_POINTERS] = { 0 };
+			THROW_ON_FFMPEG_ERROR(av_samples_fill_arrays(planes, NULL, silence.buffer->data, num_channels, samples_count, format, 0));
+			THROW_ON_FFMPEG_ERROR(av_samples_set_silence(planes, 0, samples_count, num_channels, format));
+			silence.capacity = samples_count;
+		}
+		frame->buf[0] = av_buffer_ref(silence.buffer.get());
+		if (!frame->buf[0])
+			THROW_EXCEPTION("EmptyFrameProvider: audio buffer not referenced");
+		THROW_ON_FFMPEG_ERROR(av_samples_fill_arrays(frame->data, &frame->linesize[0], frame->buf[0]->data, num_channels, silence.capacity, format, 0));
+		return frame;
+	}
+
+	std::shared_ptr<AVFrame> GetEmptyVideoFrame(const Core::VideoFormat& format, TVPlayR::PixelFormat pix_fmt)
+	{
+		std::lock_guard<std::mutex> lock(video_mutex_);
+		auto& frame = empty_video_frames_[std::make_pair(format.type(), pix_fmt)];
+		if (!frame)
+			frame = CreateEmptyVideoFrame(format, pix_fmt);
+		return CloneFrame(frame);
+	}
+
+	static std::shared_ptr<AVFrame> CreateEmptyVideoFrame(const Core::VideoFormat& format, TVPlayR::PixelFormat pix_fmt)
+	{
+		auto frame = AllocFrame();
+		frame->width = format.width();
+		frame->height = format.height();
+		frame->format = TVPlayR::PixelFormatToFFmpegFormat(pix_fmt);
+		frame->pict_type = AV_PICTURE_TYPE_NONE;
+		frame->sample_aspect_ratio = format.SampleAspectRatio().av();
+		frame->interlaced_frame = format.interlaced();
+		frame->top_field_first = format.field_order() == TVPlayR::FieldOrder::TopFieldFirst;
+		THROW_ON_FFMPEG_ERROR(av_frame_get_buffer(frame.get(), 0));
+		uint32_t* data_begin = reinterpret_cast<uint32_t*>(frame->data[0]);
+		ptrdiff_t linesize[4] = { frame->linesize[0], 0, 0, 0 };
+		switch (pix_fmt)
+		{
+		case TVPlayR::PixelFormat::rgb10:
+		case TVPlayR::PixelFormat::yuv422:
+			THROW_ON_FFMPEG_ERROR(av_image_fill_black(frame->data, linesize, static_cast<AVPixelFormat>(frame->format), AVColorRange::AVCOL_RANGE_MPEG, frame->width, frame->height));
+			break;
+		case TVPlayR::PixelFormat::bgra:
+			// we want fully transparent, black frame here
+			std::fill(data_begin, data_begin + (frame->linesize[0] * frame->height / sizeof(uint32_t)), 0x00000000);
+			break;
+		default:
+			THROW_EXCEPTION("Invalid frame pixel format")
+			break;
+		}
+		return frame;
+	}
+};
+
+EmptyFrameProvider::EmptyFrameProvider()
+	: impl_(std::make_unique<implementation>())
+{ }
+
+EmptyFrameProvider::~EmptyFrameProvider() { }
+
+std::shared_ptr<AVFrame> EmptyFrameProvider::GetSilentAudioFrame(int samples_count, int num_channels, AVSampleFormat format, int sample_rate) { return impl_->GetSilentAudioFrame(samples_count, num_channels, format, sample_rate); }
+
+std::shared_ptr<AVFrame> EmptyFrameProvider::GetEmptyVideoFrame(const Core::VideoFormat& format, TVPlayR::PixelFormat pix_fmt) { return impl_->GetEmptyVideoFrame(format, pix_fmt); }
+
+}}
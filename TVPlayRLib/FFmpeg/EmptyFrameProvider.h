@@ -0,0 +1,26 @@
+#pragma once
+
+namespace TVPlayR {
+	enum class PixelFormat;
+	namespace Core {
+		class VideoFormat;
+	}
+	namespace FFmpeg {
+
+/// <summary>
+/// Keeps silent audio and black video buffers and hands out read-only references to them,
+/// so idle or paused channels don't allocate and clear new buffers every frame.
+/// </summary>
+class EmptyFrameProvider final : Common::NonCopyable
+{
+public:
+	EmptyFrameProvider();
+	~EmptyFrameProvider();
+	std::shared_ptr<AVFrame> GetSilentAudioFrame(int samples_count, int num_channels, AVSampleFormat format, int sample_rate);
+	std::shared_ptr<AVFrame> GetEmptyVideoFrame(const Core::VideoFormat& format, TVPlayR::PixelFormat pix_fmt);
+private:
+	struct implementation;
+	std::unique_ptr<implementation> impl_;
+};
+
+}}
@@ -12,9 +12,24 @@ namespace TVPlayR {
 
 struct FFmpegFileInfo::implementation : FFmpegInputBase
 {
+	// only headers and single frames are read
+	static ReadAheadSettings GetReadAheadSettings()
+	{
+		ReadAheadSettings settings;
+		settings.AccessHint = IoAccessHint::random;
+		return settings;
+	}
+
+	// thumbnails don't take decoding threads from the inputs played
+	static DecoderSettings GetDecoderSettings(const DecoderSettings& decoder_settings)
+	{
+		DecoderSettings settings = decoder_settings;
+		settings.IsBackground = true;
+		return settings;
+	}
 
-	implementation(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device)
-		: FFmpegInputBase(file_name, acceleration, hw_device)
+	implementation(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings)
+		: FFmpegInputBase(file_name, acceleration, hw_device, GetDecoderSettings(decoder_settings), GetReadAheadSettings())
 	{ 
 		input_.LoadStreamData();
 		InitializeVideoDecoder();
@@ -38,7 +53,12 @@ struct FFmpegFileInfo::implementation : FFmpegInputBase
 					continue;
 			if (packet->stream_index != video_decoder_->StreamIndex())
 				continue;
-			video_decoder_->Push(packet);
+			while (!video_decoder_->Push(packet))
+			{
+				auto frame = video_decoder_->Pull();
+				if (frame)
+					return frame;
+			}
 			auto frame = video_decoder_->Pull();
 			if (frame)
 				return frame;
@@ -49,8 +69,8 @@ struct FFmpegFileInfo::implementation : FFmpegInputBase
 };
 
 
-FFmpegFileInfo::FFmpegFileInfo(const std::string & file_name, Core::HwAccel acceleration, const std::string& hw_device)
-	: impl_(std::make_unique<implementation>(file_name, acceleration, hw_device))
+FFmpegFileInfo::FFmpegFileInfo(const std::string & file_name, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings)
+	: impl_(std::make_unique<implementation>(file_name, acceleration, hw_device, decoder_settings))
 { }
 
 FFmpegFileInfo::~FFmpegFileInfo() {}
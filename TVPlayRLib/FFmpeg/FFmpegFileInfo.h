@@ -1,5 +1,6 @@
 #pragma once
 #include "../Core/HwAccel.h"
+#include "DecoderSettings.h"
 
 namespace TVPlayR {
 	enum class FieldOrder;
@@ -14,7 +15,7 @@ namespace TVPlayR {
 class FFmpegFileInfo final
 {
 public:
-	FFmpegFileInfo(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device);
+	FFmpegFileInfo(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings = DecoderSettings());
 	~FFmpegFileInfo();
 	std::shared_ptr<AVFrame> GetFrameAt(std::int64_t time);
 	AVRational GetTimeBase() const;
@@ -8,103 +8,407 @@
 #include "AudioMuxer.h"
 #include "SynchronizingBuffer.h"
 #include "PlayerScaler.h"
+#include "LoopHead.h"
 #include "../Core/StreamInfo.h"
+#include "../Core/AudioChannelMapEntry.h"
 
 
 namespace TVPlayR {
 	namespace FFmpeg {
 			   		 
+#define INPUT_PACKET_QUEUE_MIN_PACKETS 25 // demuxer reads ahead until every stream has at least that many packets queued...
+#define INPUT_PACKET_QUEUES_MAX_BYTES (64 * 1024 * 1024) // ...unless all the queues together hold more than that
+#define INPUT_PACKET_QUEUES_STARVED_MAX_BYTES (256 * 1024 * 1024) // limit while a stream being decoded has no packet at all, e.g. audio interleaved far from video
+#define INPUT_PRIME_TIMEOUT std::chrono::seconds(5)
+#define INPUT_CACHED_CLIP_MAX_DURATION (10 * AV_TIME_BASE) // stills and clips up to that long are kept decoded in the clip cache, unless their frames take more than CLIP_CACHE_MAX_CLIP_BYTES
+#define CLIP_CACHE_DEFAULT_BUDGET (1024LL * 1024 * 1024)
+
+static ClipCache clip_cache(CLIP_CACHE_DEFAULT_BUDGET);
+
 struct FFmpegInput::implementation : Common::DebugTarget, FFmpegInputBase
 {
+	struct PacketQueue
+	{
+		std::deque<std::shared_ptr<AVPacket>> packets;
+		size_t bytes = 0;
+
+		void Push(const std::shared_ptr<AVPacket>& packet) // nullptr is a flush packet
+		{
+			if (packet)
+				bytes += packet->size;
+			packets.push_back(packet);
+		}
+
+		bool TryPop(std::shared_ptr<AVPacket>& packet)
+		{
+			if (packets.empty())
+				return false;
+			packet = std::move(packets.front());
+			packets.pop_front();
+			if (packet)
+				bytes -= packet->size;
+			return true;
+		}
+
+		void Clear()
+		{
+			packets.clear();
+			bytes = 0;
+		}
+	};
+
+	// every stage has a single thread, so only the reader of statistics runs concurrently
+	struct StageStatistics
+	{
+		std::atomic_int64_t processed = 0LL;
+		std::atomic_int64_t total_latency = 0LL;
+		std::atomic_int64_t max_latency = 0LL;
+
+		void Record(std::chrono::steady_clock::time_point start)
+		{
+			std::int64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+			total_latency += latency;
+			if (latency > max_latency)
+				max_latency = latency;
+			processed++;
+		}
+
+		FFmpegInputStageStatistics Get(size_t queue_depth) const
+		{
+			std::int64_t count = processed;
+			return FFmpegInputStageStatistics{ count, count ? total_latency / count : 0LL, max_latency, queue_depth };
+		}
+	};
+
 	std::atomic_bool is_eof_ = false;
 	std::atomic_bool is_playing_ = false;
 	std::atomic_bool is_loop_ = false;
-	bool is_producer_running_ = false;
+	std::atomic_bool is_running_ = true;
 	std::vector<std::unique_ptr<Decoder>> audio_decoders_;
-	const Core::Player* player_ = nullptr;
 	std::unique_ptr<AudioMuxer> audio_muxer_;
 	std::unique_ptr<PlayerScaler> player_scaler_;
 	std::unique_ptr<SynchronizingBuffer> buffer_;
-	std::mutex player_scaler_reset_mutex_;
 	std::mutex buffer_content_mutex_;
-	std::mutex buffer_mutex_;
 	std::condition_variable buffer_cv_;
 
 	TIME_CALLBACK frame_played_callback_ = nullptr;
 	PAUSED_CALLBACK paused_callback_ = nullptr;
-	std::mutex producer_mutex_;
-	std::condition_variable producer_cv_;
-	std::thread producer_;
 
-	implementation(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device)
-		: FFmpegInputBase(file_name, acceleration, hw_device)
+	// each stage holds its mutex while processing, so holding all three means the pipeline is idle
+	std::mutex demux_mutex_;
+	std::mutex video_mutex_;
+	std::mutex audio_mutex_;
+
+	// guards the pipeline state below, every change of it (and of the buffer fill) is signalled with pipeline_cv_
+	std::mutex pipeline_mutex_;
+	std::condition_variable pipeline_cv_;
+	const Core::Player* player_ = nullptr;
+	std::vector<Core::AudioChannelMapEntry> audio_channel_map_;
+	bool is_initialized_ = false;
+	bool demux_eof_ = false;
+	bool video_eof_ = false;
+	bool audio_eof_ = false;
+	bool video_draining_ = false;
+	bool audio_draining_ = false;
+	bool is_finished_ = false;
+	bool has_loop_head_ = false;
+	bool is_replaying_ = false; // decoded clip frames are pushed to the buffer, the decoding stages wait until it's done
+	PacketQueue video_packets_;
+	std::vector<PacketQueue> audio_packets_;
+
+	StageStatistics demux_statistics_;
+	StageStatistics video_statistics_;
+	StageStatistics audio_statistics_;
+
+	// set when the video stage is idle (before initialization or under all stage mutexes), read by the video stage
+	std::chrono::steady_clock::time_point first_frame_requested_;
+	bool first_frame_pending_ = false;
+	std::atomic_int64_t time_to_first_frame_ = -1LL;
+
+	// owned by the demux stage, replay_clip_ is pushed to the buffer from the frame at replay_position_
+	std::unique_ptr<LoopHead> loop_head_;
+	std::shared_ptr<const DecodedClip> whole_clip_; // from the clip cache or recorded while playing
+	std::shared_ptr<const DecodedClip> replay_clip_;
+	size_t replay_position_ = 0;
+	bool is_cacheable_ = false;
+	ClipCacheKey clip_cache_key_;
+
+	// frames pushed to the buffer while the file is played from its start, for the clip cache, guarded by buffer_content_mutex_
+	std::atomic_bool is_recording_ = false;
+	std::vector<std::shared_ptr<AVFrame>> recorded_video_;
+	std::vector<std::shared_ptr<AVFrame>> recorded_audio_;
+	AVRational recorded_video_time_base_ = { 0, 1 };
+	AVRational recorded_audio_time_base_ = { 0, 1 };
+	size_t recorded_bytes_ = 0;
+
+	std::thread demux_thread_;
+	std::thread video_thread_;
+	std::thread audio_thread_;
+
+	implementation(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings, const ReadAheadSettings& read_ahead_settings)
+		: FFmpegInputBase(file_name, acceleration, hw_device, decoder_settings, read_ahead_settings)
 		, Common::DebugTarget(Common::DebugSeverity::debug, "FFmpegInput " + file_name)
-		, producer_(&implementation::ProducerTheradStart, this)
 	{ 
 		input_.LoadStreamData();
+		demux_thread_ = std::thread(&implementation::DemuxThreadStart, this);
+		video_thread_ = std::thread(&implementation::VideoThreadStart, this);
+		audio_thread_ = std::thread(&implementation::AudioThreadStart, this);
 	}
 
 	~implementation()
 	{
-		if (player_)
-			RemoveFromPlayer(*player_);
+		const Core::Player* player;
 		{
-			is_producer_running_ = false;
-			producer_cv_.notify_one();
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			player = player_;
 		}
-		producer_.join();
+		if (player)
+			RemoveFromPlayer(*player);
+		is_running_ = false;
+		NotifyPipeline();
+		demux_thread_.join();
+		video_thread_.join();
+		audio_thread_.join();
 	}
 
-#pragma region Input thread methods
+	// wakes stages after a change made without holding pipeline_mutex_
+	void NotifyPipeline()
+	{
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		}
+		pipeline_cv_.notify_all();
+	}
+
+#pragma region Pipeline threads methods
 
-	void ProducerTheradStart()
+	// stage loop: waits (not holding the stage mutex) until the stage has work, then does one step of it
+	void RunStage(const std::string& name, std::mutex& stage_mutex, bool(implementation::*has_work)(), void(implementation::*step)())
 	{
 #ifdef DEBUG
-		Common::SetThreadName(::GetCurrentThreadId(), ("FFmpegInput " + file_name_).c_str());
+		Common::SetThreadName(::GetCurrentThreadId(), (name + " " + file_name_).c_str());
 #endif
-		is_producer_running_ = true;
-		std::unique_lock<std::mutex> wait_lock(producer_mutex_);
-		producer_cv_.wait(wait_lock, [&]()
+		while (true)
+		{
 			{
-				std::lock_guard<std::mutex> lock(buffer_mutex_);
-				if (player_)
-				{
-					if (!buffer_)
-						InitializeBuffer();
-					while (!buffer_->IsFull())
-					{
-						ProcessNextInputPacket();
-						if (buffer_->IsReady())
-						{
-							std::lock_guard<std::mutex> buffer_content_lock(buffer_content_mutex_);
-							buffer_cv_.notify_one();
-						}
-					}
-				}
-				return !is_producer_running_;
-			});
+				std::unique_lock<std::mutex> lock(pipeline_mutex_);
+				pipeline_cv_.wait(lock, [&] { return !is_running_ || (this->*has_work)(); });
+				if (!is_running_)
+					return;
+			}
+			std::lock_guard<std::mutex> lock(stage_mutex);
+			(this->*step)();
+		}
+	}
+
+	void DemuxThreadStart() { RunStage("FFmpegInput demux", demux_mutex_, &implementation::DemuxHasWork, &implementation::DemuxStep); }
+
+	void VideoThreadStart() { RunStage("FFmpegInput video", video_mutex_, &implementation::VideoHasWork, &implementation::VideoStep); }
+
+	void AudioThreadStart() { RunStage("FFmpegInput audio", audio_mutex_, &implementation::AudioHasWork, &implementation::AudioStep); }
+
+	// called with pipeline_mutex_ locked
+	bool IsBufferFull()
+	{
+		std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+		return buffer_->IsFull();
+	}
+
+	// called with pipeline_mutex_ locked
+	bool IsVideoBufferFull()
+	{
+		std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+		return buffer_->IsVideoFull();
+	}
+
+	// called with pipeline_mutex_ locked
+	bool IsAudioBufferFull()
+	{
+		std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+		return buffer_->IsAudioFull();
+	}
+
+	// called with pipeline_mutex_ locked
+	bool DemuxHasWork()
+	{
+		if (!player_ || is_finished_)
+			return false;
+		if (!is_initialized_)
+			return true;
+		if (is_loop_ && !has_loop_head_ && !is_recording_ && video_decoder_)
+			return true;
+		if (is_replaying_)
+			return !IsBufferFull();
+		if (demux_eof_)
+			return video_eof_ && audio_eof_; // time to loop or flush the buffer
+		size_t bytes = video_packets_.bytes;
+		bool any_queue_short = video_decoder_ && video_packets_.packets.size() < INPUT_PACKET_QUEUE_MIN_PACKETS;
+		bool any_queue_starved = video_decoder_ && !video_eof_ && video_packets_.packets.empty();
+		for (const auto& queue : audio_packets_)
+		{
+			bytes += queue.bytes;
+			any_queue_short |= queue.packets.size() < INPUT_PACKET_QUEUE_MIN_PACKETS;
+			any_queue_starved |= !audio_eof_ && queue.packets.empty();
+		}
+		// a starved stream stalls the buffer, so the other queues may grow over the usual limit until it gets a packet
+		if (any_queue_starved)
+			return bytes < INPUT_PACKET_QUEUES_STARVED_MAX_BYTES;
+		return any_queue_short && bytes < INPUT_PACKET_QUEUES_MAX_BYTES;
+	}
+
+	// called with pipeline_mutex_ locked
+	bool VideoHasWork()
+	{
+		return is_initialized_ && !is_replaying_ && !video_eof_ && (video_draining_ || !video_packets_.packets.empty()) && !IsVideoBufferFull();
+	}
+
+	// called with pipeline_mutex_ locked
+	bool AudioHasWork()
+	{
+		return is_initialized_ && !is_replaying_ && !audio_eof_ && (audio_draining_ || std::any_of(audio_packets_.begin(), audio_packets_.end(), [](const PacketQueue& queue) { return !queue.packets.empty(); })) && !IsAudioBufferFull();
+	}
+
+	void DemuxStep()
+	{
+		bool is_initialized, demux_eof, need_loop_head, is_replaying;
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			if (!player_)
+				return;
+			is_initialized = is_initialized_;
+			demux_eof = demux_eof_;
+			need_loop_head = is_loop_ && !has_loop_head_ && !is_recording_ && video_decoder_;
+			is_replaying = is_replaying_;
+		}
+		if (!is_initialized)
+			InitializeBuffer();
+		else if (need_loop_head)
+			StartLoopHead();
+		else if (is_replaying)
+			ReplayClip();
+		else if (demux_eof)
+			FlushBufferOrLoop();
+		else
+			ReadPacket();
 	}
 
 	void InitializeBuffer()
 	{
+		std::scoped_lock<std::mutex, std::mutex> stages_lock(video_mutex_, audio_mutex_);
+		const Core::Player* player;
+		std::vector<Core::AudioChannelMapEntry> audio_channel_map;
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			player = player_;
+			audio_channel_map = audio_channel_map_;
+		}
 		InitializeVideoDecoder();
 		InitializeAudioDecoders();
-		player_scaler_ = std::make_unique<PlayerScaler>(*player_);
+		player_scaler_ = std::make_unique<PlayerScaler>(*player);
 		if (!audio_decoders_.empty())
-			audio_muxer_ = std::make_unique<AudioMuxer>(audio_decoders_, AV_CH_LAYOUT_STEREO, player_->AudioSampleFormat(), 48000, player_->AudioChannelsCount());
-		buffer_ = std::make_unique<SynchronizingBuffer>(
-			player_,
-			is_playing_,
-			AV_TIME_BASE, // 1s
-			0,
-			input_.ReadStartTimecode(),
-			GetVideoDuration(),
-			GetFieldOrder()
-			);
+		{
+			audio_muxer_ = std::make_unique<AudioMuxer>(audio_decoders_, AV_CH_LAYOUT_STEREO, player->AudioSampleFormat(), 48000, player->AudioChannelsCount());
+			audio_muxer_->SetChannelMap(audio_channel_map);
+		}
+		// cached clips have default channel mapping
+		is_cacheable_ = audio_channel_map.empty() && IsCacheable() && ClipCache::MakeKey(file_name_, *player, clip_cache_key_);
+		whole_clip_ = is_cacheable_ ? clip_cache.Find(clip_cache_key_) : nullptr;
+		if (whole_clip_)
+			DebugPrintLine(Common::DebugSeverity::debug, "Playing from the clip cache");
+		{
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			if (is_cacheable_ && !whole_clip_)
+				StartRecording();
+			buffer_ = std::make_unique<SynchronizingBuffer>(
+				player,
+				is_playing_,
+				player->GetBufferSettings(),
+				0,
+				input_.ReadStartTimecode(),
+				GetVideoDuration(),
+				GetFieldOrder()
+				);
+		}
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		audio_packets_.resize(audio_decoders_.size());
+		ResetPipelineState();
+		if (whole_clip_)
+		{
+			// nothing is read from the file, the pipeline stays at its end, so the clip loops or finishes after it's replayed
+			demux_eof_ = true;
+			video_eof_ = true;
+			audio_eof_ = true;
+			has_loop_head_ = true;
+			replay_clip_ = whole_clip_;
+			replay_position_ = 0;
+			is_replaying_ = true;
+		}
+		is_initialized_ = true;
+		pipeline_cv_.notify_all();
+	}
+
+	bool IsCacheable() const
+	{
+		const Core::StreamInfo* stream = input_.GetVideoStream();
+		if (is_stream_ || !stream)
+			return false;
+		return stream->Stream->nb_frames == 1 || (stream->Duration != AV_NOPTS_VALUE && stream->Duration <= INPUT_CACHED_CLIP_MAX_DURATION);
+	}
+
+	// called with buffer_content_mutex_ locked
+	void StartRecording()
+	{
+		StopRecording();
+		is_recording_ = true;
+	}
+
+	// called with buffer_content_mutex_ locked
+	void StopRecording()
+	{
+		is_recording_ = false;
+		recorded_video_.clear();
+		recorded_audio_.clear();
+		recorded_bytes_ = 0;
+	}
+
+	// called with buffer_content_mutex_ locked
+	void Record(std::vector<std::shared_ptr<AVFrame>>& frames, const std::shared_ptr<AVFrame>& frame)
+	{
+		if (!is_recording_)
+			return;
+		recorded_bytes_ += FrameBytes(frame.get());
+		if (recorded_bytes_ > CLIP_CACHE_MAX_CLIP_BYTES)
+		{
+			DebugPrintLine(Common::DebugSeverity::debug, "Clip too big to be cached");
+			StopRecording();
+			return;
+		}
+		frames.push_back(frame);
+	}
+
+	// called by the demuxer thread at the end of file, with video and audio stage mutexes locked
+	void FinishRecording()
+	{
+		{
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			if (!is_recording_)
+				return;
+			if (!recorded_video_.empty())
+			{
+				const AVRational frame_rate = player_scaler_->Format().FrameRate().av();
+				whole_clip_ = CreateDecodedClip(recorded_video_, recorded_video_time_base_, av_rescale(AV_TIME_BASE, frame_rate.den, frame_rate.num), recorded_audio_, recorded_audio_time_base_);
+				clip_cache.Add(clip_cache_key_, whole_clip_);
+			}
+			StopRecording();
+		}
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		has_loop_head_ = true;
 	}
 
 	void InitializeAudioDecoders()
 	{
+		if (!audio_decoders_.empty())
+			return;
 		auto& streams = input_.GetStreams();
 		auto stream = input_.GetVideoStream();
 		std::int64_t seek = stream ? stream->StartTime : 0;
@@ -112,87 +416,228 @@ struct FFmpegInput::implementation : Common::DebugTarget, FFmpegInputBase
 			for (const auto& stream : streams)
 			{
 				if (stream.Type == Core::MediaType::audio && stream.Language == "pol")
-					audio_decoders_.emplace_back(std::make_unique<Decoder>(stream.Codec, stream.Stream, seek ? seek : stream.StartTime));
+					audio_decoders_.emplace_back(std::make_unique<Decoder>(stream.Codec, stream.Stream, seek ? seek : stream.StartTime, decoder_settings_));
 			}
 		else
 			for (const auto& stream : streams)
 			{
 				if (stream.Type == Core::MediaType::audio)
-					audio_decoders_.emplace_back(std::make_unique<Decoder>(stream.Codec, stream.Stream, seek ? seek : stream.StartTime));
+					audio_decoders_.emplace_back(std::make_unique<Decoder>(stream.Codec, stream.Stream, seek ? seek : stream.StartTime, decoder_settings_));
 			}
 	}
 
-	void ProcessNextInputPacket()
+	// called with pipeline_mutex_ locked, after the decoders, filters and buffer were reset or created
+	void ResetPipelineState()
 	{
-		if (buffer_->IsEof())
-			return;
+		video_packets_.Clear();
+		for (auto& queue : audio_packets_)
+			queue.Clear();
+		demux_eof_ = false;
+		video_eof_ = !video_decoder_;
+		audio_eof_ = !audio_muxer_;
+		video_draining_ = false;
+		audio_draining_ = false;
+		is_finished_ = false;
+		is_replaying_ = false;
+	}
+
+	// the head is decoded on its own thread, long before the loop point
+	void StartLoopHead()
+	{
+		const Core::Player* player;
+		std::vector<Core::AudioChannelMapEntry> audio_channel_map;
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			player = player_;
+			audio_channel_map = audio_channel_map_;
+		}
+		std::vector<int> audio_stream_indexes;
+		for (const auto& decoder : audio_decoders_)
+			audio_stream_indexes.push_back(decoder->StreamIndex());
+		loop_head_ = std::make_unique<LoopHead>(file_name_, *player, video_decoder_->StreamIndex(), audio_stream_indexes, acceleration_, hw_device_, decoder_settings_, audio_channel_map, player->GetBufferSettings().Duration);
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		has_loop_head_ = true;
+	}
+
+	// called with buffer_content_mutex_ locked, returns true when all the clip frames were pushed
+	bool PushClipFrames()
+	{
+		const auto& frames = replay_clip_->Frames;
+		bool pushed = false;
+		while (replay_position_ < frames.size() && !buffer_->IsFull())
+		{
+			const DecodedClipFrame& frame = frames[replay_position_++];
+			buffer_->PushVideo(frame.Video, replay_clip_->VideoTimeBase);
+			for (const auto& audio : frame.Audio)
+				buffer_->PushAudio(audio);
+			pushed = true;
+		}
+		if (buffer_->IsReady())
+			buffer_cv_.notify_all();
+		if (pushed)
+			FirstFramePushed();
+		return replay_position_ == frames.size();
+	}
+
+	void ReplayClip()
+	{
+		{
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			if (!PushClipFrames())
+				return;
+			// the file is read again from where the head ends
+			if (replay_clip_ != whole_clip_)
+				buffer_->SkipAudioUntil(replay_clip_->EndTime);
+		}
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		is_replaying_ = false;
+		pipeline_cv_.notify_all();
+	}
+
+	void ReadPacket()
+	{
+		auto start = std::chrono::steady_clock::now();
 		auto packet = input_.PullPacket();
+		demux_statistics_.Record(start);
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
 		if (!packet)
 		{
 			assert(input_.IsEof());
-			for (const auto& decoder : audio_decoders_)
-			{
-				if (!decoder->IsFlushed())
-					decoder->Flush();
-				ProcessAudio(decoder);
-			}
-			FlushAudioMuxerIfNeeded();
+			// flush packets make decoders return all the frames they hold
 			if (video_decoder_)
-			{
-				if (!video_decoder_->IsFlushed())
-					video_decoder_->Flush();
-				ProcessVideo();
-				FlushPlayerScalerIfNeeded();
-			}
-			FlushBufferOrLoopIfNeeded();
+				video_packets_.Push(nullptr);
+			for (auto& queue : audio_packets_)
+				queue.Push(nullptr);
+			demux_eof_ = true;
 		}
-		else 	// there is no need to flush if packets are comming
-		{
-			if (video_decoder_ && packet->stream_index == video_decoder_->StreamIndex())
+		else if (video_decoder_ && packet->stream_index == video_decoder_->StreamIndex())
+			video_packets_.Push(packet);
+		else
+			for (size_t i = 0; i < audio_decoders_.size(); i++)
 			{
-				video_decoder_->Push(packet);
-				ProcessVideo();
-			}
-			else
-				for (const auto& audio_decoder : audio_decoders_)
+				if (packet->stream_index == audio_decoders_[i]->StreamIndex())
 				{
-					if (packet->stream_index == audio_decoder->StreamIndex())
-					{
-						audio_decoder->Push(packet);
-						ProcessAudio(audio_decoder);
-						break;
-					}
+					audio_packets_[i].Push(packet);
+					break;
 				}
-		}
+			}
+		pipeline_cv_.notify_all();
 	}
 
-	void ProcessVideo()
+	void VideoStep()
 	{
+		std::shared_ptr<AVPacket> packet;
+		bool have_packet;
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			if (!is_initialized_ || video_eof_)
+				return;
+			// a full decoder queue is drained by pulling frames before it gets another packet
+			have_packet = !video_decoder_->IsQueueFull() && video_packets_.TryPop(packet);
+			if (have_packet && !packet)
+				video_draining_ = true;
+		}
+		pipeline_cv_.notify_all(); // demuxer may wait for free space in the queue
+		auto start = std::chrono::steady_clock::now();
+		if (have_packet)
+		{
+			if (packet)
+				video_decoder_->Push(packet);
+			else if (!video_decoder_->IsFlushed())
+				video_decoder_->Flush();
+		}
 		auto decoded = video_decoder_->Pull();
 		if (decoded)
-		{
-			std::lock_guard<std::mutex> lock(player_scaler_reset_mutex_);
 			player_scaler_->Push(decoded, video_decoder_->FrameRate(), video_decoder_->TimeBase());
+		if (video_decoder_->IsEof() && !player_scaler_->IsFlushed())
+			player_scaler_->Flush();
+		bool pushed = false;
+		{
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			while (auto scaled = player_scaler_->Pull())
+			{
+				buffer_->PushVideo(scaled, player_scaler_->OutputTimeBase());
+				recorded_video_time_base_ = player_scaler_->OutputTimeBase();
+				Record(recorded_video_, scaled);
+				pushed = true;
+			}
+			if (buffer_->IsReady())
+				buffer_cv_.notify_all();
+		}
+		video_statistics_.Record(start);
+		if (pushed)
+			FirstFramePushed();
+		// scaler never initialized if the decoder produced no frame
+		if (video_decoder_->IsEof() && (player_scaler_->IsEof() || !player_scaler_->IsInitialized()))
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			video_eof_ = true;
+			video_draining_ = false;
+			pipeline_cv_.notify_all();
 		}
-		std::lock_guard<std::mutex> lock(buffer_content_mutex_);
-		while (auto scaled = player_scaler_->Pull())
-			buffer_->PushVideo(scaled, player_scaler_->OutputTimeBase());
 	}
 
-	void ProcessAudio(const std::unique_ptr<Decoder>& decoder)
+	void AudioStep()
 	{
-		auto decoded = decoder->Pull();
-		if (decoded)
-			audio_muxer_->Push(decoder->StreamIndex(), decoded);
-		std::lock_guard<std::mutex> lock(buffer_content_mutex_);
-		while (auto muxed = audio_muxer_->Pull())
-			buffer_->PushAudio(muxed);
+		std::vector<std::shared_ptr<AVPacket>> packets(audio_decoders_.size());
+		std::vector<bool> have_packets(audio_decoders_.size(), false);
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			if (!is_initialized_ || audio_eof_)
+				return;
+			for (size_t i = 0; i < audio_decoders_.size(); i++)
+			{
+				have_packets[i] = !audio_decoders_[i]->IsQueueFull() && audio_packets_[i].TryPop(packets[i]);
+				if (have_packets[i] && !packets[i])
+					audio_draining_ = true;
+			}
+		}
+		pipeline_cv_.notify_all();
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < audio_decoders_.size(); i++)
+		{
+			const auto& decoder = audio_decoders_[i];
+			if (have_packets[i])
+			{
+				if (packets[i])
+					decoder->Push(packets[i]);
+				else if (!decoder->IsFlushed())
+					decoder->Flush();
+			}
+			auto decoded = decoder->Pull();
+			if (decoded)
+				audio_muxer_->Push(decoder->StreamIndex(), decoded);
+		}
+		FlushAudioMuxerIfNeeded();
+		{
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			while (auto muxed = audio_muxer_->Pull())
+			{
+				buffer_->PushAudio(muxed);
+				recorded_audio_time_base_ = audio_muxer_->OutputTimeBase();
+				Record(recorded_audio_, muxed);
+			}
+			if (buffer_->IsReady())
+				buffer_cv_.notify_all();
+		}
+		audio_statistics_.Record(start);
+		if (audio_muxer_->IsEof())
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			audio_eof_ = true;
+			audio_draining_ = false;
+			pipeline_cv_.notify_all();
+		}
 	}
 
-	void FlushPlayerScalerIfNeeded()
+	// called by the stage pushing video frames to the buffer
+	void FirstFramePushed()
 	{
-		if (video_decoder_->IsEof() && !player_scaler_->IsFlushed())
-			player_scaler_->Flush();
+		if (!first_frame_pending_)
+			return;
+		first_frame_pending_ = false;
+		time_to_first_frame_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - first_frame_requested_).count();
+		DebugPrintLine(Common::DebugSeverity::debug, "Time to first frame: " + std::to_string(time_to_first_frame_ / 1000) + " ms");
 	}
 
 	void FlushAudioMuxerIfNeeded()
@@ -204,35 +649,84 @@ struct FFmpegInput::implementation : Common::DebugTarget, FFmpegInputBase
 			audio_muxer_->Flush();
 	}
 
-	void FlushBufferOrLoopIfNeeded()
+	// called by the demuxer thread when all the stages are done with the file
+	void FlushBufferOrLoop()
 	{
-		if (!buffer_->IsFlushed() && // not flushed yet
-			(player_scaler_->IsEof() || (video_decoder_->IsEof() || player_scaler_->IsInitialized())) && // scaler will provide no more frames
-			(!audio_muxer_ || audio_muxer_->IsEof())) // muxer exists and is Eof
-			if (is_loop_)
+		std::scoped_lock<std::mutex, std::mutex> stages_lock(video_mutex_, audio_mutex_);
+		FinishRecording();
+		if (!whole_clip_ && loop_head_ && loop_head_->IsValid() && loop_head_->IsWholeClip())
+		{
+			whole_clip_ = loop_head_->GetClip();
+			if (is_cacheable_)
+				clip_cache.Add(clip_cache_key_, whole_clip_);
+		}
+		if (is_loop_ && whole_clip_)
+			LoopFromClip(whole_clip_);
+		else if (is_loop_ && loop_head_ && loop_head_->IsValid())
+			LoopFromClip(loop_head_->GetClip());
+		else if (is_loop_)
+		{
+			std::int64_t seek_time = input_.GetVideoStream()->StartTime;
+			input_.Seek(seek_time);
+			ResetDecoders(seek_time);
 			{
-				std::int64_t seek_time = input_.GetVideoStream()->StartTime;
-				input_.Seek(seek_time);
-				video_decoder_->Seek(seek_time);
-				for (const auto& decoder : audio_decoders_)
-					decoder->Seek(seek_time);
-				if (audio_muxer_)
-					audio_muxer_->Reset();
-				if (player_scaler_)
-				{
-					std::lock_guard<std::mutex> lock(player_scaler_reset_mutex_);
-					player_scaler_->Reset();
-				}
 				std::lock_guard<std::mutex> lock(buffer_content_mutex_);
-				if (buffer_)
-					buffer_->Loop();
-				DebugPrintLine(Common::DebugSeverity::info, "Loop");
+				buffer_->Loop();
 			}
-			else
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			ResetPipelineState();
+			pipeline_cv_.notify_all();
+			DebugPrintLine(Common::DebugSeverity::info, "Loop");
+		}
+		else
+		{
 			{
 				std::lock_guard<std::mutex> lock(buffer_content_mutex_);
 				buffer_->Flush();
+				buffer_cv_.notify_all();
 			}
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			is_finished_ = true;
+		}
+	}
+
+	// called with video and audio stage mutexes locked
+	// the buffer gets the head frames first, so reopening the file (if not played from memory) doesn't hold the output
+	void LoopFromClip(const std::shared_ptr<const DecodedClip>& clip)
+	{
+		const bool is_whole_clip = clip == whole_clip_;
+		replay_clip_ = clip;
+		replay_position_ = 0;
+		{
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			buffer_->Loop();
+			PushClipFrames();
+		}
+		if (!is_whole_clip)
+		{
+			input_.Seek(clip->EndTime);
+			ResetDecoders(clip->EndTime);
+		}
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		// a clip played from memory keeps its pipeline at the end of file, so it loops again after the replay
+		if (!is_whole_clip)
+			ResetPipelineState();
+		is_replaying_ = true;
+		pipeline_cv_.notify_all();
+		DebugPrintLine(Common::DebugSeverity::info, is_whole_clip ? "Loop from memory" : "Loop");
+	}
+
+	// called with all stage mutexes locked
+	void ResetDecoders(std::int64_t seek_time)
+	{
+		if (video_decoder_)
+			video_decoder_->Seek(seek_time);
+		for (const auto& decoder : audio_decoders_)
+			decoder->Seek(seek_time);
+		if (audio_muxer_)
+			audio_muxer_->Reset();
+		if (player_scaler_)
+			player_scaler_->Reset();
 	}
 
 #pragma endregion
@@ -243,11 +737,8 @@ struct FFmpegInput::implementation : Common::DebugTarget, FFmpegInputBase
 		bool finished = false;
 		Core::AVSync sync;
 		{
-			if (!(buffer_ && buffer_->IsReady()))
-			{
-				std::unique_lock<std::mutex> lock(buffer_content_mutex_);
-				buffer_cv_.wait(lock);
-			}
+			std::unique_lock<std::mutex> lock(buffer_content_mutex_);
+			buffer_cv_.wait(lock, [&] { return buffer_ && buffer_->IsReady(); });
 			if (is_eof_)
 				return buffer_->PullSync(audio_samples_count);
 			sync = buffer_->PullSync(audio_samples_count);
@@ -263,21 +754,47 @@ struct FFmpegInput::implementation : Common::DebugTarget, FFmpegInputBase
 		}
 		else
 		{
-			producer_cv_.notify_one();
+			NotifyPipeline(); // the buffer has room now
 		}
 		return sync;
 	}
 
+	bool Prime(const Core::Player& player, int frames_count)
+	{
+		if (!IsAddedToPlayer(player))
+			AddToPlayer(player);
+		auto start = std::chrono::steady_clock::now();
+		const size_t frames = static_cast<size_t>(FFMAX(frames_count, 1));
+		std::unique_lock<std::mutex> lock(buffer_content_mutex_);
+		bool primed = buffer_cv_.wait_for(lock, INPUT_PRIME_TIMEOUT, [&] { return buffer_ && buffer_->IsPrimed(frames); });
+		DebugPrintLine(primed ? Common::DebugSeverity::debug : Common::DebugSeverity::warning, (primed ? "Primed in " : "Priming timed out after ") + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()) + " ms");
+		return primed;
+	}
+
+	bool IsReady()
+	{
+		std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+		return buffer_ && buffer_->IsReady();
+	}
+
+	std::shared_ptr<AVFrame> PullTailAudio(int max_samples_count)
+	{
+		std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+		if (!buffer_ || !is_eof_)
+			return nullptr;
+		return buffer_->PullTailAudio(max_samples_count);
+	}
+
 	bool IsAddedToPlayer(const Core::Player& player)
 	{
-		std::lock_guard<std::mutex> lock(buffer_mutex_);
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
 		return &player == player_;
 	}
 
 	void AddToPlayer(const Core::Player& player)
 	{
 		{
-			std::lock_guard<std::mutex> lock(buffer_mutex_);
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
 			if (&player == player_)
 			{
 				DebugPrintLine(Common::DebugSeverity::error, "Already added to this player");
@@ -286,51 +803,62 @@ struct FFmpegInput::implementation : Common::DebugTarget, FFmpegInputBase
 			if (player_)
 				THROW_EXCEPTION("FFmpegInput: already added to another player");
 			player_ = &player;
+			first_frame_requested_ = std::chrono::steady_clock::now();
+			first_frame_pending_ = true;
+			time_to_first_frame_ = -1LL;
 		}
-		producer_cv_.notify_one();
+		pipeline_cv_.notify_all();
 		DebugPrintLine(Common::DebugSeverity::debug, "Added to player");
 	}
 
 	void RemoveFromPlayer(const Core::Player& player)
 	{
+		std::scoped_lock<std::mutex, std::mutex, std::mutex> stages_lock(demux_mutex_, video_mutex_, audio_mutex_);
 		{
-			std::lock_guard<std::mutex> lock(buffer_mutex_);
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
 			if (player_ != &player)
 				return;
 			player_ = nullptr;
+			is_initialized_ = false;
+			has_loop_head_ = false;
+			ResetPipelineState();
+		}
+		// frames are in the player's format
+		loop_head_.reset();
+		whole_clip_.reset();
+		replay_clip_.reset();
+		{
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			StopRecording();
 			buffer_.reset();
-			player_scaler_.reset();
-			audio_muxer_.reset();
 		}
-		producer_cv_.notify_one();
+		player_scaler_.reset();
+		audio_muxer_.reset();
 		DebugPrintLine(Common::DebugSeverity::debug, "Removed from player");
 	}
 
 
 	bool Seek(const std::int64_t time)
 	{
-		std::lock_guard<std::mutex> lock(buffer_content_mutex_);
-		if (input_.Seek(time))
+		std::scoped_lock<std::mutex, std::mutex, std::mutex> stages_lock(demux_mutex_, video_mutex_, audio_mutex_);
+		if (!input_.Seek(time))
+			return false;
+		DebugPrintLine(Common::DebugSeverity::info, "Seek: " + std::to_string(time / 1000));
+		ResetDecoders(time);
 		{
-			DebugPrintLine(Common::DebugSeverity::info, "Seek: " + std::to_string(time / 1000));
-			if (video_decoder_)
-				video_decoder_->Seek(time);
-			for (auto& decoder : audio_decoders_)
-				decoder->Seek(time);
-			if (player_scaler_)
-			{
-				std::lock_guard<std::mutex> lock(player_scaler_reset_mutex_);
-				player_scaler_->Reset();
-			}
-			if (audio_muxer_)
-				audio_muxer_->Reset();
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			StopRecording(); // the clip cache gets whole files only
 			if (buffer_)
 				buffer_->Seek(time);
-			is_eof_ = false;
-			producer_cv_.notify_one();
-			return true;
 		}
-		return false;
+		first_frame_requested_ = std::chrono::steady_clock::now();
+		first_frame_pending_ = true;
+		time_to_first_frame_ = -1LL;
+		is_eof_ = false;
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		ResetPipelineState();
+		pipeline_cv_.notify_all();
+		return true;
 	}
 
 	void Play()
@@ -358,24 +886,112 @@ struct FFmpegInput::implementation : Common::DebugTarget, FFmpegInputBase
 	void SetIsLoop(bool is_loop)
 	{
 		is_loop_ = is_loop;
+		NotifyPipeline(); // demuxer starts decoding the loop head
 	}
 
-	
+	FFmpegInputStatistics GetStatistics()
+	{
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		size_t audio_depth = 0;
+		for (const auto& queue : audio_packets_)
+			audio_depth += queue.packets.size();
+		const size_t video_depth = video_packets_.packets.size();
+		DecoderStatistics video_decoder_statistics{};
+		DecoderStatistics audio_decoders_statistics{};
+		if (is_initialized_)
+		{
+			if (video_decoder_)
+				video_decoder_statistics = video_decoder_->GetStatistics();
+			for (const auto& decoder : audio_decoders_)
+			{
+				DecoderStatistics statistics = decoder->GetStatistics();
+				audio_decoders_statistics.QueueDepth += statistics.QueueDepth;
+				audio_decoders_statistics.QueueBytes += statistics.QueueBytes;
+				audio_decoders_statistics.QueueDuration = FFMAX(audio_decoders_statistics.QueueDuration, statistics.QueueDuration);
+				audio_decoders_statistics.EagainRetries += statistics.EagainRetries;
+				audio_decoders_statistics.RejectedPackets += statistics.RejectedPackets;
+			}
+		}
+		FFmpegInputBufferStatistics buffer_statistics{};
+		{
+			std::lock_guard<std::mutex> buffer_lock(buffer_content_mutex_);
+			if (buffer_)
+				buffer_statistics = buffer_->GetStatistics();
+		}
+		return FFmpegInputStatistics
+		{
+			demux_statistics_.Get(video_depth + audio_depth),
+			video_statistics_.Get(video_depth),
+			audio_statistics_.Get(audio_depth),
+			video_decoder_statistics,
+			audio_decoders_statistics,
+			buffer_statistics,
+			time_to_first_frame_,
+			input_.GetIoWaitTime()
+		};
+	}
 
-	void SetupAudio(const std::vector<Core::AudioChannelMapEntry>& audio_channel_map)
+	// called with all stage mutexes locked, the frames of the clip not pushed yet are decoded from the file again
+	void StopReplay()
 	{
+		const auto& frames = replay_clip_->Frames;
+		const std::int64_t time = replay_position_ < frames.size() ? av_rescale_q(frames[replay_position_].Video->pts, replay_clip_->VideoTimeBase, AV_TIME_BASE_Q) : replay_clip_->EndTime;
+		input_.Seek(time);
+		ResetDecoders(time);
+		{
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			buffer_->SkipAudioUntil(time);
+		}
+		replay_clip_.reset();
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		ResetPipelineState();
+		pipeline_cv_.notify_all();
+		DebugPrintLine(Common::DebugSeverity::debug, "Replay stopped at: " + std::to_string(time / 1000));
+	}
 
+	void SetupAudio(const std::vector<Core::AudioChannelMapEntry>& audio_channel_map)
+	{
+		std::scoped_lock<std::mutex, std::mutex, std::mutex> stages_lock(demux_mutex_, video_mutex_, audio_mutex_);
+		bool is_replaying;
+		{
+			std::lock_guard<std::mutex> lock(pipeline_mutex_);
+			if (std::equal(audio_channel_map.begin(), audio_channel_map.end(), audio_channel_map_.begin(), audio_channel_map_.end(),
+				[](const Core::AudioChannelMapEntry& a, const Core::AudioChannelMapEntry& b) { return a.StreamIndex == b.StreamIndex && a.ChannelNumber == b.ChannelNumber; }))
+				return;
+			audio_channel_map_ = audio_channel_map;
+			is_replaying = is_replaying_;
+		}
+		if (audio_muxer_)
+			audio_muxer_->SetChannelMap(audio_channel_map);
+		if (!audio_channel_map.empty())
+		{
+			// frames recorded so far have another mapping
+			is_cacheable_ = false;
+			std::lock_guard<std::mutex> lock(buffer_content_mutex_);
+			StopRecording();
+		}
+		// decoded clips have the previous mapping, the loop head is decoded again with the new one
+		whole_clip_.reset();
+		loop_head_.reset();
+		if (is_replaying)
+			StopReplay();
+		std::lock_guard<std::mutex> lock(pipeline_mutex_);
+		has_loop_head_ = false;
+		pipeline_cv_.notify_all();
 	}
 
 };
 
 
-FFmpegInput::FFmpegInput(const std::string & file_name, Core::HwAccel acceleration, const std::string& hw_device)
-	: impl_(std::make_unique<implementation>(file_name, acceleration, hw_device))
+FFmpegInput::FFmpegInput(const std::string & file_name, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings, const ReadAheadSettings& read_ahead_settings)
+	: impl_(std::make_unique<implementation>(file_name, acceleration, hw_device, decoder_settings, read_ahead_settings))
 { }
 
 FFmpegInput::~FFmpegInput(){}
 Core::AVSync FFmpegInput::PullSync(const Core::Player& player, int audio_samples_count) { return impl_->PullSync(audio_samples_count); }
+bool FFmpegInput::Prime(const Core::Player& player, int frames_count) { return impl_->Prime(player, frames_count); }
+bool FFmpegInput::IsReady() { return impl_->IsReady(); }
+std::shared_ptr<AVFrame> FFmpegInput::PullTailAudio(int max_samples_count) { return impl_->PullTailAudio(max_samples_count); }
 bool FFmpegInput::Seek(const std::int64_t time) { return impl_->Seek(time); }
 bool FFmpegInput::IsEof() const { return impl_->is_eof_; }
 bool FFmpegInput::IsAddedToPlayer(const Core::Player& player) { return impl_->IsAddedToPlayer(player); }
@@ -402,4 +1018,7 @@ const Core::StreamInfo& FFmpegInput::GetStreamInfo(int index) const { return imp
 void FFmpegInput::SetupAudio(const std::vector<Core::AudioChannelMapEntry>& audio_channel_map) { impl_->SetupAudio(audio_channel_map); }
 void FFmpegInput::SetFramePlayedCallback(TIME_CALLBACK frame_played_callback) { impl_->frame_played_callback_ = frame_played_callback; }
 void FFmpegInput::SetPausedCallback(PAUSED_CALLBACK paused_callback) { impl_->paused_callback_ = paused_callback; }
+FFmpegInputStatistics FFmpegInput::GetStatistics() const { return impl_->GetStatistics(); }
+ClipCacheStatistics FFmpegInput::GetClipCacheStatistics() { return clip_cache.GetStatistics(); }
+void FFmpegInput::SetClipCacheBudget(size_t bytes) { clip_cache.SetBudget(bytes); }
 }}
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
 #include "../Core/InputSource.h"
 #include "../Core/HwAccel.h"
+#include "DecoderSettings.h"
+#include "Decoder.h"
+#include "ReadAheadIO.h"
+#include "ClipCache.h"
 
 namespace TVPlayR {
 	namespace Core {
@@ -10,13 +14,51 @@ namespace TVPlayR {
 	}
 		namespace FFmpeg {
 
+struct FFmpegInputStageStatistics
+{
+	std::int64_t Processed; // packets read by the demuxer, processing steps done by the decoding stages
+	std::int64_t AverageLatency; // microseconds spent on a single packet or step
+	std::int64_t MaxLatency;
+	size_t QueueDepth; // packets waiting for the stage
+};
+
+struct FFmpegInputBufferStatistics
+{
+	size_t VideoFrames;
+	std::int64_t VideoDuration; // AV_TIME_BASE units
+	std::int64_t AudioDuration;
+	size_t Bytes; // decoded video and audio held
+	bool IsFull; // above the high watermark and not yet below the low one
+	std::int64_t DroppedVideoFrames; // on overflow
+	std::int64_t DroppedAudioSamples;
+};
+
+struct FFmpegInputStatistics
+{
+	FFmpegInputStageStatistics Demux;
+	FFmpegInputStageStatistics Video; // decoding and scaling
+	FFmpegInputStageStatistics Audio; // decoding and muxing
+	DecoderStatistics VideoDecoder; // zeroed if the input isn't added to a player
+	DecoderStatistics AudioDecoders; // summed, the longest queue duration
+	FFmpegInputBufferStatistics Buffer;
+	std::int64_t TimeToFirstFrame; // microseconds from adding to the player (or seeking) to the first frame in the output buffer, -1 if still waiting
+	std::int64_t IoWaitTime; // microseconds the demuxer waited for the file data, included in its latency
+};
+
 class FFmpegInput: public Core::InputSource
 {
 public:
 	typedef std::function<void()> PAUSED_CALLBACK;
-	FFmpegInput(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device);
+	FFmpegInput(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings = DecoderSettings(), const ReadAheadSettings& read_ahead_settings = ReadAheadSettings());
 	virtual ~FFmpegInput();
 	Core::AVSync PullSync(const Core::Player& player, int audio_samples_count);
+	/// <summary>
+	/// Adds the input to the player (if not added yet) and waits until first frames_count frames are decoded and converted to player's format,
+	/// so the input can go on air with the next frame requested by the player. Returns false if they weren't ready in time.
+	/// </summary>
+	bool Prime(const Core::Player& player, int frames_count);
+	bool IsReady() override;
+	std::shared_ptr<AVFrame> PullTailAudio(int max_samples_count) override;
 	bool Seek(const std::int64_t time);
 	bool IsEof() const override;
 	bool IsAddedToPlayer(const Core::Player& player) override;
@@ -43,6 +85,10 @@ public:
 	virtual void SetupAudio(const std::vector<Core::AudioChannelMapEntry>& audio_channel_map);
 	void SetFramePlayedCallback(TIME_CALLBACK frame_played_callback) override;
 	virtual void SetPausedCallback(PAUSED_CALLBACK paused_callback);
+	FFmpegInputStatistics GetStatistics() const;
+	// stills and short clips played from their start are kept decoded, in the player's format, by all the inputs
+	static ClipCacheStatistics GetClipCacheStatistics();
+	static void SetClipCacheBudget(size_t bytes);
 private:
 	struct implementation;
 	std::unique_ptr<implementation> impl_;
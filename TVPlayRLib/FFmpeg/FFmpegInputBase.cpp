@@ -14,11 +14,12 @@ namespace TVPlayR {
 			return prefix == "udp://" || prefix == "rtp://";
 		}
 
-		FFmpegInputBase::FFmpegInputBase(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device)
+		FFmpegInputBase::FFmpegInputBase(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings, const ReadAheadSettings& read_ahead_settings)
 			: file_name_(file_name)
-			, input_(file_name)
+			, input_(file_name, read_ahead_settings)
 			, acceleration_(acceleration)
 			, hw_device_(hw_device)
+			, decoder_settings_(decoder_settings)
 			, is_stream_(IsFilenameStream(file_name))
 			, video_decoder_()
 		{
@@ -31,7 +32,7 @@ namespace TVPlayR {
 			auto stream = input_.GetVideoStream();
 			if (stream == nullptr)
 				return;
-			video_decoder_ = std::make_unique<Decoder>(stream->Codec, stream->Stream, stream->StartTime, acceleration_, hw_device_);
+			video_decoder_ = std::make_unique<Decoder>(stream->Codec, stream->Stream, stream->StartTime, acceleration_, hw_device_, decoder_settings_);
 		}
 
 
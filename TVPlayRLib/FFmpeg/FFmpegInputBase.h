@@ -1,6 +1,7 @@
 #pragma once
 
 #include "InputFormat.h"
+#include "DecoderSettings.h"
 
 namespace TVPlayR {
 	enum class FieldOrder;
@@ -15,10 +16,11 @@ namespace TVPlayR {
 struct FFmpegInputBase : Common::NonCopyable
 {
 protected:
-	FFmpegInputBase(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device);
+	FFmpegInputBase(const std::string& file_name, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings, const ReadAheadSettings& read_ahead_settings);
 	const std::string file_name_;
 	const Core::HwAccel acceleration_;
 	const std::string hw_device_;
+	const DecoderSettings decoder_settings_;
 	FFmpeg::InputFormat input_;
 	const bool is_stream_;
 	std::unique_ptr<FFmpeg::Decoder> video_decoder_;
@@ -35,7 +35,7 @@ namespace TVPlayR {
 			std::unique_ptr<SwResample> audio_resampler_;
 			std::unique_ptr<Encoder> video_encoder_;
 			std::unique_ptr<Encoder> audio_encoder_;
-			Common::BlockingCollection<Core::AVSync> buffer_;
+			Common::SpscRing<Core::AVSync> buffer_;
 			std::vector<std::shared_ptr<Core::OverlayBase>> overlays_;
 			std::vector<Core::ClockTarget*> clock_targets_;
 			std::int64_t video_frames_requested_ = 0LL;
@@ -88,7 +88,7 @@ namespace TVPlayR {
 					video_scaler_ = std::make_unique<SwScale>(format_.width(), format_.height(), src_pixel_format_, format_.width(), format_.height(), dest_pixel_format_);
 				else
 					video_filter_ = std::make_unique<OutputVideoFilter>(format_.FrameRate().av(), params_.VideoFilter, dest_pixel_format_);
-				executor_.begin_invoke([this] { Tick(); });
+				executor_.post([this] { Tick(); });
 			}
 
 			void InitializeFrameRequester()
@@ -113,7 +113,7 @@ namespace TVPlayR {
 					std::shared_ptr<AVFrame> processed_video;
 					if (video_filter_)
 					{
-						video_filter_->Push(sync.Video);
+						video_filter_->Push(sync.Video, sync.VideoPts);
 						processed_video = video_filter_->Pull();
 						if (!video_encoder_ && processed_video)
 						{
@@ -126,6 +126,7 @@ namespace TVPlayR {
 					else if (video_scaler_)
 					{
 						processed_video = video_scaler_->Scale(sync.Video);
+						processed_video->pts = sync.VideoPts;
 						if (!video_encoder_ && processed_video)
 							InitializeVideoEncoderAndOutput(processed_video, format_.FrameRate().invert().av(), format_.FrameRate().av());
 					}
@@ -137,7 +138,14 @@ namespace TVPlayR {
 					if (video_encoder_ && processed_video)
 						PushToEncoder(video_encoder_, processed_video);
 					if (sync.Audio)
-						PushToEncoder(audio_encoder_, audio_resampler_->Resample(sync.Audio));
+					{
+						auto resampled = audio_resampler_->Resample(sync.Audio);
+						if (resampled)
+						{
+							resampled->pts = sync.AudioPts;
+							PushToEncoder(audio_encoder_, resampled);
+						}
+					}
 				}
 				else
 					DebugPrintLine(Common::DebugSeverity::info, "Buffer didn't return frame");
@@ -222,18 +230,17 @@ namespace TVPlayR {
 
 			void Push(Core::AVSync& sync)
 			{
-				std::shared_ptr<AVFrame> audio(CloneFrame(sync.Audio));
-				std::shared_ptr<AVFrame> video(CloneFrame(sync.Video));
-				if (audio)
+				Core::AVSync stamped(sync);
+				if (stamped.Audio)
 				{
-					audio->pts = audio_samples_pushed_;
-					audio_samples_pushed_ += audio->nb_samples;
+					stamped.AudioPts = audio_samples_pushed_;
+					audio_samples_pushed_ += stamped.Audio->nb_samples;
 				}
-				video->pts = video_frames_pushed_;
+				stamped.VideoPts = video_frames_pushed_;
 				video_frames_pushed_++;
-				if (buffer_.try_emplace(Core::AVSync(audio, video, sync.TimeInfo)) != Common::BlockingCollectionStatus::Ok)
+				if (buffer_.try_add(std::move(stamped)) != Common::BlockingCollectionStatus::Ok)
 					DebugPrintLine(Common::DebugSeverity::warning, "Frame dropped");
-				executor_.begin_invoke([this]
+				executor_.post([this]
 					{
 						if (!clock_targets_.empty())
 							WaitForNextFrameTime();
@@ -1,8 +1,8 @@
 #include "../pch.h"
 #include "FFmpegUtils.h"
-#include "../Core/VideoFormat.h"
-#include "../PixelFormat.h"
-#include "../FieldOrder.h"
+#include "FramePool.h"
+#include "PacketPool.h"
+#include "EmptyFrameProvider.h"
 
 namespace TVPlayR {
 	namespace FFmpeg {
@@ -33,66 +33,102 @@ namespace TVPlayR {
 		{
 			if (!source)
 				return nullptr;
-			AVFrame* frame = av_frame_alloc();
-			frame->width = source->width;
-			frame->height = source->height;
-			frame->format = source->format;
+			auto frame = AllocPooledVideoFrame(source->width, source->height, static_cast<AVPixelFormat>(source->format));
 			frame->pict_type = source->pict_type;
 			frame->sample_aspect_ratio = source->sample_aspect_ratio;
 			frame->interlaced_frame = source->interlaced_frame;
 			frame->top_field_first = source->top_field_first;
-			THROW_ON_FFMPEG_ERROR(av_frame_get_buffer(frame, 0));
 			av_image_copy(frame->data, frame->linesize, const_cast<const uint8_t**>(source->data), const_cast<const int*>(source->linesize), static_cast<AVPixelFormat>(source->format), source->width, source->height);
-			return std::shared_ptr<AVFrame>(frame, FreeFrame);
+			return frame;
 		}
 
-		std::shared_ptr<AVFrame> CreateEmptyVideoFrame(const Core::VideoFormat& format, TVPlayR::PixelFormat pix_fmt)
+		size_t FrameBytes(const AVFrame* frame)
 		{
-			AVFrame* frame = av_frame_alloc();
-			if (!frame)
-				THROW_EXCEPTION("FFmpegUtils: video frame not allocated");
-			frame->width = format.width();
-			frame->height = format.height();
-			frame->format = TVPlayR::PixelFormatToFFmpegFormat(pix_fmt);
-			frame->pict_type = AV_PICTURE_TYPE_NONE;
-			frame->sample_aspect_ratio = format.SampleAspectRatio().av();
-			frame->interlaced_frame = format.interlaced();
-			frame->top_field_first = format.field_order() == TVPlayR::FieldOrder::TopFieldFirst;
-			THROW_ON_FFMPEG_ERROR(av_frame_get_buffer(frame, 0));
-			uint32_t* data_begin = reinterpret_cast<uint32_t*>(frame->data[0]);
-			ptrdiff_t linesize[4] = { frame->linesize[0], 0, 0, 0 };
-			switch (pix_fmt)
+			size_t bytes = 0;
+			for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++)
+				bytes += frame->buf[i]->size;
+			return bytes;
+		}
+
+		std::shared_ptr<AVFrame> GetFrameRows(const std::shared_ptr<AVFrame>& source, int first_row, int rows_count)
+		{
+			assert(first_row >= 0 && rows_count > 0 && first_row + rows_count <= source->height);
+			const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(source->format));
+			if (!desc || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+				THROW_EXCEPTION("FFmpegUtils: invalid pixel format of the frame");
+			if (first_row % (1 << desc->log2_chroma_h))
+				THROW_EXCEPTION("FFmpegUtils: first row not aligned to chroma subsampling");
+			auto frame = AllocFrame();
+			frame->width = source->width;
+			frame->height = rows_count;
+			frame->format = source->format;
+			frame->sample_aspect_ratio = source->sample_aspect_ratio;
+			frame->interlaced_frame = source->interlaced_frame;
+			frame->top_field_first = source->top_field_first;
+			frame->pts = source->pts;
+			for (int i = 0; i < AV_NUM_DATA_POINTERS && source->data[i]; i++)
 			{
-			case TVPlayR::PixelFormat::rgb10:
-			case TVPlayR::PixelFormat::yuv422:
-				THROW_ON_FFMPEG_ERROR(av_image_fill_black(frame->data, linesize, static_cast<AVPixelFormat>(frame->format), AVColorRange::AVCOL_RANGE_MPEG, frame->width, frame->height));
-				break;
-			case TVPlayR::PixelFormat::bgra:
-				// we want fully transparent, black frame here
-				std::fill(data_begin, data_begin + (frame->linesize[0] * frame->height / sizeof(uint32_t)), 0x00000000);
-				break;
-			default:
-				THROW_EXCEPTION("Invalid frame pixel format")
-				break;
+				frame->linesize[i] = source->linesize[i];
+				if (i == 1 && (desc->flags & AV_PIX_FMT_FLAG_PAL))
+				{
+					frame->data[i] = source->data[i]; // palette
+					continue;
+				}
+				int row = (i == 1 || i == 2) ? first_row >> desc->log2_chroma_h : first_row;
+				frame->data[i] = source->data[i] + static_cast<ptrdiff_t>(row) * source->linesize[i];
 			}
-			return std::shared_ptr<AVFrame>(frame, FreeFrame);
+			return frame;
+		}
+
+		static FramePool frame_pool;
+
+		std::shared_ptr<AVFrame> AllocPooledVideoFrame(int width, int height, AVPixelFormat pix_fmt, int align)
+		{
+			return frame_pool.AllocVideoFrame(width, height, pix_fmt, align);
+		}
+
+		std::shared_ptr<AVFrame> AllocPooledAudioFrame(int nb_samples, const AVChannelLayout& ch_layout, AVSampleFormat sample_fmt, int sample_rate)
+		{
+			return frame_pool.AllocAudioFrame(nb_samples, ch_layout, sample_fmt, sample_rate);
+		}
+
+		FramePoolStatistics GetFramePoolStatistics()
+		{
+			return frame_pool.GetStatistics();
+		}
+
+		std::shared_ptr<AVFrame> CopyAudioSamples(const std::shared_ptr<AVFrame>& source, int first_sample, int samples_count, const AVRational time_base)
+		{
+			assert(first_sample >= 0 && samples_count > 0 && first_sample + samples_count <= source->nb_samples);
+			const AVSampleFormat sample_fmt = static_cast<AVSampleFormat>(source->format);
+			auto frame = AllocPooledAudioFrame(samples_count, source->ch_layout, sample_fmt, source->sample_rate);
+			THROW_ON_FFMPEG_ERROR(av_samples_copy(frame->extended_data, source->extended_data, 0, first_sample, samples_count, source->ch_layout.nb_channels, sample_fmt));
+			frame->pts = source->pts == AV_NOPTS_VALUE ? AV_NOPTS_VALUE : source->pts + av_rescale_q(first_sample, av_make_q(1, source->sample_rate), time_base);
+			return frame;
+		}
+
+		static PacketPool packet_pool;
+
+		std::shared_ptr<AVPacket> AllocPooledPacket()
+		{
+			return packet_pool.AllocPacket();
+		}
+
+		PacketPoolStatistics GetPacketPoolStatistics()
+		{
+			return packet_pool.GetStatistics();
+		}
+
+		static EmptyFrameProvider empty_frame_provider;
+
+		std::shared_ptr<AVFrame> CreateEmptyVideoFrame(const Core::VideoFormat& format, TVPlayR::PixelFormat pix_fmt)
+		{
+			return empty_frame_provider.GetEmptyVideoFrame(format, pix_fmt);
 		}
 
 		std::shared_ptr<AVFrame> CreateSilentAudioFrame(int samples_count, int num_channels, AVSampleFormat format)
 		{
-			if (samples_count <= 0)
-				return nullptr;
-			assert(num_channels <= 63);
-			AVFrame* frame = av_frame_alloc();
-			if (!frame)
-				THROW_EXCEPTION("FFmpegUtils: audio frame not allocated");
-			frame->format = format;
-			av_channel_layout_default(&frame->ch_layout, num_channels);
-			frame->nb_samples = samples_count;
-			frame->sample_rate = 48000;
-			THROW_ON_FFMPEG_ERROR(av_frame_get_buffer(frame, 0));
-			THROW_ON_FFMPEG_ERROR(av_samples_set_silence(frame->data, 0, frame->nb_samples, frame->ch_layout.nb_channels, static_cast<AVSampleFormat>(frame->format)));
-			return std::shared_ptr<AVFrame>(frame, FreeFrame);
+			return empty_frame_provider.GetSilentAudioFrame(samples_count, num_channels, format, 48000);
 		}
 
 		void DumpFilter(const std::string& filter_str, AVFilterGraph* graph)
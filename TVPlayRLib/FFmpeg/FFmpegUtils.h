@@ -8,6 +8,8 @@ namespace TVPlayR {
 		class VideoFormat;
 	}
 	namespace FFmpeg {
+		struct FramePoolStatistics;
+		struct PacketPoolStatistics;
 
 #define ERROR_STRING_LENGTH 128
 
@@ -25,12 +27,40 @@ template<class T> using unique_ptr = std::unique_ptr<T, void(*)(T*)>; // unique
 
 std::shared_ptr<AVPacket> AllocPacket();
 
+/// <summary>
+/// allocates packet reusing AVPacket structures released by previous packets
+/// </summary>
+std::shared_ptr<AVPacket> AllocPooledPacket();
+
+PacketPoolStatistics GetPacketPoolStatistics();
+
 std::shared_ptr<AVFrame> AllocFrame();
 
 std::shared_ptr<AVFrame> CloneFrame(const std::shared_ptr<AVFrame>& source);
 
 std::shared_ptr<AVFrame> CopyFrame(const std::shared_ptr<AVFrame>& source);
 
+// size of the buffers referenced by the frame
+size_t FrameBytes(const AVFrame* frame);
+
+// returns a frame without own buffers, pointing to the rows of the source, valid as long as the source buffers live
+std::shared_ptr<AVFrame> GetFrameRows(const std::shared_ptr<AVFrame>& source, int first_row, int rows_count);
+
+/// <summary>
+/// allocates video frame with buffer taken from the pool of frames of the same geometry and format
+/// </summary>
+std::shared_ptr<AVFrame> AllocPooledVideoFrame(int width, int height, AVPixelFormat pix_fmt, int align = 0);
+
+/// <summary>
+/// allocates audio frame with buffer taken from the pool of frames of the same sample format and channel count
+/// </summary>
+std::shared_ptr<AVFrame> AllocPooledAudioFrame(int nb_samples, const AVChannelLayout& ch_layout, AVSampleFormat sample_fmt, int sample_rate);
+
+FramePoolStatistics GetFramePoolStatistics();
+
+// returns a new audio frame with samples_count samples of the source starting at first_sample, its pts (in time_base) moved accordingly
+std::shared_ptr<AVFrame> CopyAudioSamples(const std::shared_ptr<AVFrame>& source, int first_sample, int samples_count, const AVRational time_base);
+
 inline std::int64_t PtsToTime(std::int64_t pts, const AVRational time_base)
 {
 	if (pts == AV_NOPTS_VALUE)
@@ -45,6 +75,7 @@ inline std::int64_t TimeToPts(std::int64_t time, const AVRational time_base)
 	return av_rescale(time, time_base.den, static_cast<std::int64_t>(time_base.num) * AV_TIME_BASE);
 }
 
+// returned frames share their buffers with other callers and are read-only, use av_frame_make_writable() before modifying them
 std::shared_ptr<AVFrame> CreateEmptyVideoFrame(const Core::VideoFormat& format, TVPlayR::PixelFormat pix_fmt);
 
 std::shared_ptr<AVFrame> CreateSilentAudioFrame(int samples_count, int num_channels, AVSampleFormat format);
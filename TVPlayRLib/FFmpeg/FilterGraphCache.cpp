@@ -0,0 +1,181 @@
+#include "../pch.h"
+#include "FilterGraphCache.h"
+#include "FFmpegUtils.h"
+#include <map>
+#include <tuple>
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+#define FILTER_GRAPH_CACHE_MAX_KEYS 16 // least recently used keys (and their spare graphs) above that are dropped
+
+bool FilterGraphKey::operator<(const FilterGraphKey& other) const
+{
+	return std::make_tuple(std::cref(Filter), Width, Height, PixelFormat, TimeBase.num, TimeBase.den, SampleAspectRatio.num, SampleAspectRatio.den, OutputPixelFormat, ThreadCount, std::cref(SwsFlags))
+		< std::make_tuple(std::cref(other.Filter), other.Width, other.Height, other.PixelFormat, other.TimeBase.num, other.TimeBase.den, other.SampleAspectRatio.num, other.SampleAspectRatio.den, other.OutputPixelFormat, other.ThreadCount, std::cref(other.SwsFlags));
+}
+
+struct FilterGraphCache::implementation : Common::DebugTarget
+{
+	struct Entry
+	{
+		std::unique_ptr<FilterGraph> spare;
+		bool is_building = false;
+		std::uint64_t last_used = 0ULL;
+	};
+
+	mutable std::mutex mutex_;
+	std::map<FilterGraphKey, Entry> entries_;
+	std::uint64_t use_counter_ = 0ULL;
+	std::int64_t requests_ = 0LL;
+	std::int64_t hits_ = 0LL;
+	std::int64_t builds_ = 0LL;
+	std::int64_t total_build_time_ = 0LL;
+	std::int64_t max_build_time_ = 0LL;
+	Common::Executor executor_; // the last one, to be joined before the entries are released
+
+	implementation()
+		: Common::DebugTarget(Common::DebugSeverity::info, "FilterGraphCache")
+		, executor_("Filter graph builder")
+	{ }
+
+	static std::unique_ptr<FilterGraph> Build(const FilterGraphKey& key)
+	{
+		auto graph = std::unique_ptr<FilterGraph>(new FilterGraph{ std::unique_ptr<AVFilterGraph, void(*)(AVFilterGraph*)>(avfilter_graph_alloc(), [](AVFilterGraph* graph) { avfilter_graph_free(&graph); }), NULL, NULL });
+		AVFilterInOut* inputs = avfilter_inout_alloc();
+		AVFilterInOut* outputs = avfilter_inout_alloc();
+		try
+		{
+			graph->Graph->nb_threads = key.ThreadCount;
+			graph->Graph->thread_type = AVFILTER_THREAD_SLICE;
+			if (!key.SwsFlags.empty())
+				graph->Graph->scale_sws_opts = av_strdup(("flags=" + key.SwsFlags).c_str());
+			const AVFilter* buffersrc = avfilter_get_by_name("buffer");
+			const AVFilter* buffersink = avfilter_get_by_name("buffersink");
+			char args[512];
+			snprintf(args, sizeof(args),
+				"video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
+				key.Width, key.Height, key.PixelFormat,
+				key.TimeBase.num, key.TimeBase.den,
+				key.SampleAspectRatio.num, key.SampleAspectRatio.den);
+			THROW_ON_FFMPEG_ERROR(avfilter_graph_create_filter(&graph->Source, buffersrc, "vin", args, NULL, graph->Graph.get()));
+			enum AVPixelFormat pix_fmts[] = { key.OutputPixelFormat, AV_PIX_FMT_NONE };
+			THROW_ON_FFMPEG_ERROR(avfilter_graph_create_filter(&graph->Sink, buffersink, "vout", NULL, NULL, graph->Graph.get()));
+			THROW_ON_FFMPEG_ERROR(av_opt_set_int_list(graph->Sink, "pix_fmts", pix_fmts, AV_PIX_FMT_NONE, AV_OPT_SEARCH_CHILDREN));
+
+			outputs->name = av_strdup("in");
+			outputs->filter_ctx = graph->Source;
+			outputs->pad_idx = 0;
+			outputs->next = NULL;
+
+			inputs->name = av_strdup("out");
+			inputs->filter_ctx = graph->Sink;
+			inputs->pad_idx = 0;
+			inputs->next = NULL;
+			THROW_ON_FFMPEG_ERROR(avfilter_graph_parse(graph->Graph.get(), key.Filter.c_str(), inputs, outputs, NULL));
+			THROW_ON_FFMPEG_ERROR(avfilter_graph_config(graph->Graph.get(), NULL));
+		}
+		catch (const std::exception& e)
+		{
+			avfilter_inout_free(&inputs);
+			avfilter_inout_free(&outputs);
+			throw e;
+		}
+		return graph;
+	}
+
+	std::unique_ptr<FilterGraph> BuildTimed(const FilterGraphKey& key)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto graph = Build(key);
+		std::int64_t build_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		std::lock_guard<std::mutex> lock(mutex_);
+		builds_++;
+		total_build_time_ += build_time;
+		if (build_time > max_build_time_)
+			max_build_time_ = build_time;
+		return graph;
+	}
+
+	// called with mutex_ locked
+	void Evict()
+	{
+		while (entries_.size() > FILTER_GRAPH_CACHE_MAX_KEYS)
+			entries_.erase(std::min_element(entries_.begin(), entries_.end(), [](const auto& a, const auto& b) { return a.second.last_used < b.second.last_used; }));
+	}
+
+	void BuildSpare(const FilterGraphKey& key)
+	{
+		std::unique_ptr<FilterGraph> graph;
+		try
+		{
+			graph = BuildTimed(key);
+		}
+		catch (const std::exception& e)
+		{
+			DebugPrintLine(Common::DebugSeverity::warning, std::string("Spare graph not built: ") + e.what());
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto entry = entries_.find(key);
+		if (entry == entries_.end()) // evicted in the meantime
+			return;
+		entry->second.is_building = false;
+		if (!entry->second.spare)
+			entry->second.spare = std::move(graph);
+	}
+
+	std::unique_ptr<FilterGraph> Get(const FilterGraphKey& key)
+	{
+		std::unique_ptr<FilterGraph> graph;
+		bool build_spare;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			requests_++;
+			Entry& entry = entries_[key];
+			entry.last_used = ++use_counter_;
+			if (entry.spare)
+			{
+				graph = std::move(entry.spare);
+				hits_++;
+			}
+			build_spare = !entry.is_building;
+			entry.is_building = true;
+			Evict();
+		}
+		if (build_spare && !executor_.post([this, key] { BuildSpare(key); }))
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto entry = entries_.find(key);
+			if (entry != entries_.end())
+				entry->second.is_building = false;
+		}
+		if (!graph)
+			graph = BuildTimed(key);
+		return graph;
+	}
+};
+
+FilterGraphCache::FilterGraphCache()
+	: impl_(std::make_unique<implementation>())
+{ }
+
+FilterGraphCache::~FilterGraphCache() { }
+
+std::unique_ptr<FilterGraph> FilterGraphCache::Get(const FilterGraphKey& key) { return impl_->Get(key); }
+
+FilterGraphCacheStatistics FilterGraphCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	size_t graphs_count = static_cast<size_t>(std::count_if(impl_->entries_.begin(), impl_->entries_.end(), [](const auto& entry) { return !!entry.second.spare; }));
+	return FilterGraphCacheStatistics
+	{
+		impl_->requests_,
+		impl_->hits_,
+		impl_->builds_,
+		impl_->builds_ ? impl_->total_build_time_ / impl_->builds_ : 0LL,
+		impl_->max_build_time_,
+		graphs_count
+	};
+}
+
+}}
@@ -0,0 +1,56 @@
+#pragma once
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+struct FilterGraphKey
+{
+	std::string Filter;
+	int Width;
+	int Height;
+	AVPixelFormat PixelFormat;
+	AVRational TimeBase;
+	AVRational SampleAspectRatio;
+	AVPixelFormat OutputPixelFormat;
+	int ThreadCount; // slice threads of the graph, 0 - as many as cores
+	std::string SwsFlags; // scaler algorithm of the scale filters inserted by the graph, empty - swscale's default
+	bool operator<(const FilterGraphKey& other) const;
+};
+
+// configured video filter graph, with its buffer source ("in") and sink ("out")
+struct FilterGraph
+{
+	std::unique_ptr<AVFilterGraph, void(*)(AVFilterGraph*)> Graph;
+	AVFilterContext* Source;
+	AVFilterContext* Sink;
+};
+
+struct FilterGraphCacheStatistics
+{
+	std::int64_t Requests;
+	std::int64_t Hits; // a spare graph was ready, nothing was built on the calling thread
+	std::int64_t Builds; // including the spare ones
+	std::int64_t AverageBuildTime; // microseconds
+	std::int64_t MaxBuildTime;
+	size_t GraphsCount; // spare graphs ready
+};
+
+/// <summary>
+/// Keeps a spare configured graph for each recently used filter string and input (geometry, pixel format, time base).
+/// A graph that got frames can't be rewound (its source is at EOF after flush, stateful filters like bwdif hold previous frames),
+/// so the graph handed out is replaced by a new spare built on a background thread, ready for the next seek, loop or input change.
+/// </summary>
+class FilterGraphCache final : Common::NonCopyable
+{
+public:
+	FilterGraphCache();
+	~FilterGraphCache();
+	// the graph is built on the calling thread only if no spare one is ready
+	std::unique_ptr<FilterGraph> Get(const FilterGraphKey& key);
+	FilterGraphCacheStatistics GetStatistics() const;
+private:
+	struct implementation;
+	std::unique_ptr<implementation> impl_;
+};
+
+}}
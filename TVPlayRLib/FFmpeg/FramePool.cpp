@@ -0,0 +1,144 @@
+#include "../pch.h"
+#include "FramePool.h"
+#include "FFmpegUtils.h"
+#include <map>
+#include <tuple>
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+#define FRAME_POOL_DEFAULT_ALIGN 32
+#define FRAME_POOL_AUDIO_SAMPLES_ALIGN 256
+#define FRAME_POOL_MAX_POOLS 64 // the least recently used pool is released when a new geometry would exceed it
+
+struct FramePool::implementation
+{
+	// media type, width or samples count, height or channels count, pixel or sample format, alignment
+	typedef std::tuple<int, int, int, int, int> PoolKey;
+
+	struct Pool
+	{
+		unique_ptr<AVBufferPool> BufferPool;
+		std::uint64_t LastUse;
+	};
+
+	std::mutex mutex_;
+	std::map<PoolKey, Pool> pools_;
+	std::uint64_t use_counter_ = 0ULL;
+	std::atomic_int64_t requests_ = 0LL;
+	std::atomic_int64_t evictions_ = 0LL;
+	std::atomic_int64_t allocations_ = 0LL;
+
+	static AVBufferRef* AllocBuffer(void* opaque, size_t size)
+	{
+		auto self = static_cast<implementation*>(opaque);
+		self->allocations_++;
+		return av_buffer_alloc(size);
+	}
+
+	AVBufferRef* GetBuffer(const PoolKey& key, size_t size)
+	{
+		AVBufferPool* pool;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto it = pools_.find(key);
+			if (it == pools_.end())
+			{
+				if (pools_.size() >= FRAME_POOL_MAX_POOLS)
+				{
+					// buffers of the released pool still in use are freed when their frames are
+					pools_.erase(std::min_element(pools_.begin(), pools_.end(), [](const auto& a, const auto& b) { return a.second.LastUse < b.second.LastUse; }));
+					evictions_++;
+				}
+				it = pools_.emplace(key, Pool{ unique_ptr<AVBufferPool>(av_buffer_pool_init2(size, this, AllocBuffer, NULL), [](AVBufferPool* p) { av_buffer_pool_uninit(&p); }), 0ULL }).first;
+			}
+			it->second.LastUse = ++use_counter_;
+			pool = it->second.BufferPool.get();
+		}
+		requests_++;
+		return av_buffer_pool_get(pool);
+	}
+
+	std::shared_ptr<AVFrame> AllocVideoFrame(int width, int height, AVPixelFormat pix_fmt, int align)
+	{
+		if (align <= 0)
+			align = FRAME_POOL_DEFAULT_ALIGN;
+		// the same layout av_frame_get_buffer() uses
+		int linesizes[4] = { 0 };
+		for (int i = 1; i <= align; i += i)
+		{
+			THROW_ON_FFMPEG_ERROR(av_image_fill_linesizes(linesizes, pix_fmt, FFALIGN(width, i)));
+			if (!(linesizes[0] & (align - 1)))
+				break;
+		}
+		for (int i = 0; i < 4 && linesizes[i]; i++)
+			linesizes[i] = FFALIGN(linesizes[i], align);
+		const int padded_height = FFALIGN(height, 32);
+		const size_t plane_padding = FFMAX(16 + 16 - 1, align);
+		size_t plane_sizes[4] = { 0 };
+		ptrdiff_t linesizes_ptrdiff[4] = { linesizes[0], linesizes[1], linesizes[2], linesizes[3] };
+		THROW_ON_FFMPEG_ERROR(av_image_fill_plane_sizes(plane_sizes, pix_fmt, padded_height, linesizes_ptrdiff));
+		size_t total_size = 4 * plane_padding;
+		for (int i = 0; i < 4; i++)
+			total_size += plane_sizes[i];
+
+		auto frame = AllocFrame();
+		frame->width = width;
+		frame->height = height;
+		frame->format = pix_fmt;
+		frame->buf[0] = GetBuffer(PoolKey(AVMEDIA_TYPE_VIDEO, width, height, pix_fmt, align), total_size);
+		if (!frame->buf[0])
+			THROW_EXCEPTION("FramePool: video buffer not allocated");
+		THROW_ON_FFMPEG_ERROR(av_image_fill_pointers(frame->data, pix_fmt, padded_height, frame->buf[0]->data, linesizes));
+		for (int i = 1; i < 4; i++)
+			if (frame->data[i])
+				frame->data[i] += i * plane_padding;
+		std::copy(std::begin(linesizes), std::end(linesizes), frame->linesize);
+		return frame;
+	}
+
+	std::shared_ptr<AVFrame> AllocAudioFrame(int nb_samples, const AVChannelLayout& ch_layout, AVSampleFormat sample_fmt, int sample_rate)
+	{
+		auto frame = AllocFrame();
+		frame->nb_samples = nb_samples;
+		frame->format = sample_fmt;
+		frame->sample_rate = sample_rate;
+		THROW_ON_FFMPEG_ERROR(av_channel_layout_copy(&frame->ch_layout, &ch_layout));
+		const int channels = ch_layout.nb_channels;
+		if (av_sample_fmt_is_planar(sample_fmt) && channels > AV_NUM_DATA_POINTERS)
+		{
+			// extended_data would have to be allocated separately, let FFmpeg handle this rare case
+			THROW_ON_FFMPEG_ERROR(av_frame_get_buffer(frame.get(), 0));
+			return frame;
+		}
+		// rounding the capacity lets frames with slightly different sample count (e.g. 1601/1602 for 29.97 fps) share the pool
+		const int capacity = FFALIGN(nb_samples, FRAME_POOL_AUDIO_SAMPLES_ALIGN);
+		int buffer_size = av_samples_get_buffer_size(NULL, channels, capacity, sample_fmt, 0);
+		THROW_ON_FFMPEG_ERROR(buffer_size);
+		frame->buf[0] = GetBuffer(PoolKey(AVMEDIA_TYPE_AUDIO, capacity, channels, sample_fmt, 0), buffer_size);
+		if (!frame->buf[0])
+			THROW_EXCEPTION("FramePool: audio buffer not allocated");
+		THROW_ON_FFMPEG_ERROR(av_samples_fill_arrays(frame->data, &frame->linesize[0], frame->buf[0]->data, channels, capacity, sample_fmt, 0));
+		return frame;
+	}
+
+	FramePoolStatistics GetStatistics()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return FramePoolStatistics{ requests_, allocations_, pools_.size(), evictions_ };
+	}
+};
+
+FramePool::FramePool()
+	: impl_(std::make_unique<implementation>())
+{ }
+
+FramePool::~FramePool() { }
+
+std::shared_ptr<AVFrame> FramePool::AllocVideoFrame(int width, int height, AVPixelFormat pix_fmt, int align) { return impl_->AllocVideoFrame(width, height, pix_fmt, align); }
+
+std::shared_ptr<AVFrame> FramePool::AllocAudioFrame(int nb_samples, const AVChannelLayout& ch_layout, AVSampleFormat sample_fmt, int sample_rate) { return impl_->AllocAudioFrame(nb_samples, ch_layout, sample_fmt, sample_rate); }
+
+FramePoolStatistics FramePool::GetStatistics() { return impl_->GetStatistics(); }
+
+}}
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+struct FramePoolStatistics
+{
+	std::int64_t Requests;
+	std::int64_t Allocations;
+	std::int64_t Hits() const { return Requests - Allocations; }
+	size_t PoolCount;
+	std::int64_t Evictions; // pools released to keep their count within the limit
+};
+
+/// <summary>
+/// Keeps AVBufferPool per frame geometry (width/height/pixel format/alignment for video, samples/channels/sample format for audio)
+/// so frames of the same format reuse their buffers instead of allocating new ones every frame.
+/// The number of pools is limited, the least recently used one is released when a new geometry appears.
+/// </summary>
+class FramePool final : Common::NonCopyable
+{
+public:
+	FramePool();
+	~FramePool();
+	std::shared_ptr<AVFrame> AllocVideoFrame(int width, int height, AVPixelFormat pix_fmt, int align);
+	std::shared_ptr<AVFrame> AllocAudioFrame(int nb_samples, const AVChannelLayout& ch_layout, AVSampleFormat sample_fmt, int sample_rate);
+	FramePoolStatistics GetStatistics();
+private:
+	struct implementation;
+	std::unique_ptr<implementation> impl_;
+};
+
+}}
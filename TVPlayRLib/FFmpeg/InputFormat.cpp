@@ -4,12 +4,21 @@
 #include "../Core/HwAccel.h"
 #include "../Core/StreamInfo.h"
 
+#define KEYFRAME_INDEX_FILE_EXTENSION ".keyframes"
+
 namespace TVPlayR {
 	namespace FFmpeg {
 
-		AVFormatContext* CreateContext(const std::string& file_name, bool dump)
+		AVFormatContext* CreateContext(const std::string& file_name, ReadAheadIO* io, bool dump)
 		{
-			AVFormatContext* ctx = NULL;
+			AVFormatContext* ctx = avformat_alloc_context();
+			if (!ctx)
+				THROW_EXCEPTION("InputFormat: context not allocated for " + file_name);
+			if (io)
+			{
+				ctx->pb = io->GetContext();
+				ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+			}
 			THROW_ON_FFMPEG_ERROR(avformat_open_input(&ctx, file_name.c_str(), NULL, NULL) == 0 && ctx);
 			if (!ctx)
 				THROW_EXCEPTION("InputFormat: context not created for " + file_name);
@@ -19,9 +28,10 @@ namespace TVPlayR {
 		}
 
 
-InputFormat::InputFormat(const std::string& file_name)
+InputFormat::InputFormat(const std::string& file_name, const ReadAheadSettings& read_ahead_settings)
 	: DebugTarget(Common::DebugSeverity::info, "Input format: " + file_name)
-	, format_context_(CreateContext(file_name, DebugSeverity() <= Common::DebugSeverity::info), [](AVFormatContext* ctx){ avformat_close_input(&ctx); })
+	, io_(ReadAheadIO::Create(file_name, read_ahead_settings))
+	, format_context_(CreateContext(file_name, io_.get(), DebugSeverity() <= Common::DebugSeverity::info), [](AVFormatContext* ctx){ avformat_close_input(&ctx); })
 	, file_name_(file_name)
 {
 }
@@ -68,6 +78,7 @@ bool InputFormat::LoadStreamData()
 			});
 	}
 	is_stream_data_loaded_ = true;
+	LoadKeyframeIndex();
 	return true;
 }
 
@@ -75,15 +86,18 @@ std::shared_ptr<AVPacket> InputFormat::PullPacket()
 {
 	if (format_context_)
 	{
-		auto packet = AllocPacket();
+		auto packet = AllocPooledPacket();
 		std::lock_guard<std::mutex> lock(seek_mutex_);
 		int ret = av_read_frame(format_context_.get(), packet.get());
 		switch (ret)
 		{
 		case AVERROR_EOF:
 			is_eof_ = true;
+			CompleteKeyframeIndex();
 			break;
 		case 0:
+			if (packet->stream_index == keyframe_index_stream_ && (packet->flags & AV_PKT_FLAG_KEY) && !keyframe_index_.IsComplete())
+				keyframe_index_.AddKeyframe(packet->pts, packet->dts);
 			return packet;
 		default:
 			break;
@@ -108,7 +122,20 @@ bool InputFormat::Seek(std::int64_t time)
 	std::lock_guard<std::mutex> lock(seek_mutex_);
 	if (!CanSeek())
 		return false;
-	if (FF(av_seek_frame(format_context_.get(), -1, time, AVSEEK_FLAG_BACKWARD)))
+	int ret = -1;
+	if (keyframe_index_stream_ >= 0)
+	{
+		AVStream* stream = format_context_->streams[keyframe_index_stream_];
+		std::int64_t target_pts = TimeToPts(time, stream->time_base);
+		std::int64_t keyframe_ts = keyframe_index_.FindSeekTimestamp(target_pts);
+		if (keyframe_ts != AV_NOPTS_VALUE)
+			ret = av_seek_frame(format_context_.get(), keyframe_index_stream_, keyframe_ts, AVSEEK_FLAG_BACKWARD);
+		// keyframes read after seeking somewhere in the middle don't make the index complete
+		is_reading_sequentially_ = target_pts <= (stream->start_time == AV_NOPTS_VALUE ? 0LL : stream->start_time);
+	}
+	if (ret < 0)
+		ret = av_seek_frame(format_context_.get(), -1, time, AVSEEK_FLAG_BACKWARD);
+	if (FF(ret))
 	{
 		is_eof_ = false;
 		return true;
@@ -125,6 +152,30 @@ int InputFormat::GetTotalAudioChannelCount() const
 	return result;
 }
 
+void InputFormat::LoadKeyframeIndex()
+{
+	auto stream = GetVideoStream();
+	if (!stream)
+		return;
+	keyframe_index_stream_ = stream->Index;
+	if (keyframe_index_.Load(file_name_ + KEYFRAME_INDEX_FILE_EXTENSION, file_name_, keyframe_index_stream_))
+	{
+		DebugPrintLine(Common::DebugSeverity::info, "Keyframe index loaded, " + std::to_string(keyframe_index_.Count()) + " keyframes");
+		return;
+	}
+	keyframe_index_.Initialize(stream->Stream);
+}
+
+void InputFormat::CompleteKeyframeIndex()
+{
+	if (keyframe_index_stream_ < 0 || keyframe_index_.IsComplete() || !is_reading_sequentially_)
+		return;
+	keyframe_index_.SetComplete();
+	// fails silently for streams, non-local files and read-only locations
+	if (keyframe_index_.Save(file_name_ + KEYFRAME_INDEX_FILE_EXTENSION, file_name_, keyframe_index_stream_))
+		DebugPrintLine(Common::DebugSeverity::info, "Keyframe index saved, " + std::to_string(keyframe_index_.Count()) + " keyframes");
+}
+
 const Core::StreamInfo* InputFormat::GetVideoStream() const
 {
 	auto info_iter = std::find_if(streams_.begin(), streams_.end(), [](const Core::StreamInfo& info) { return info.Type == Core::MediaType::video && info.IsPreffered; });
@@ -140,6 +191,17 @@ bool InputFormat::IsValid() const
 	return !!format_context_;
 }
 
+void InputFormat::SetAccessHint(IoAccessHint hint)
+{
+	if (io_)
+		io_->SetAccessHint(hint);
+}
+
+std::int64_t InputFormat::GetIoWaitTime() const
+{
+	return io_ ? io_->GetWaitTime() : 0LL;
+}
+
 
 
 	
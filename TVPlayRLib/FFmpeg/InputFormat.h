@@ -1,4 +1,6 @@
 #pragma once
+#include "KeyframeIndex.h"
+#include "ReadAheadIO.h"
 
 namespace TVPlayR {
 	namespace Core {
@@ -11,14 +13,20 @@ namespace TVPlayR {
 class InputFormat final : public Common::DebugTarget, Common::NonCopyable
 {
 private:
+	const std::unique_ptr<ReadAheadIO> io_; // outlives the format context using it
 	std::unique_ptr<AVFormatContext, void(*)(AVFormatContext*)> format_context_;
 	std::vector<Core::StreamInfo> streams_;
 	const std::string file_name_;
 	bool is_eof_ = false;
 	bool is_stream_data_loaded_ = false;
 	std::mutex seek_mutex_;
+	KeyframeIndex keyframe_index_;
+	int keyframe_index_stream_ = -1;
+	bool is_reading_sequentially_ = true; // all the keyframes from the start of the file were seen
+	void LoadKeyframeIndex();
+	void CompleteKeyframeIndex();
 public:
-	InputFormat(const std::string& fileName);
+	InputFormat(const std::string& fileName, const ReadAheadSettings& read_ahead_settings = ReadAheadSettings());
 	bool LoadStreamData();
 	std::shared_ptr<AVPacket> PullPacket();
 	bool CanSeek() const;
@@ -31,6 +39,8 @@ public:
 	const std::vector<Core::StreamInfo>& GetStreams() const { return streams_; };
 	const Core::StreamInfo* GetVideoStream() const;
 	bool IsValid() const;
+	void SetAccessHint(IoAccessHint hint);
+	std::int64_t GetIoWaitTime() const; // microseconds the demuxer waited for data, 0 if the file is read by the default protocol
 };
 
 }}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "../pch.h"
+#include "KeyframeIndex.h"
+#include <filesystem>
+#include <fstream>
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+#define KEYFRAME_INDEX_FILE_MAGIC 0x3158444946454B54LL // "TKEFIDX1"
+
+KeyframeIndex::KeyframeIndex()
+{ }
+
+void KeyframeIndex::Initialize(AVStream* stream)
+{
+	entries_.clear();
+	is_complete_ = false;
+	if (!stream)
+		return;
+	// index entries hold dts in most containers, pts of the keyframe can be later by the reordering delay
+	std::int64_t frame_duration = stream->avg_frame_rate.num > 0 ? av_rescale_q(1, av_inv_q(stream->avg_frame_rate), stream->time_base) : 0LL;
+	std::int64_t reorder_margin = (stream->codecpar->video_delay + 1) * frame_duration;
+	int count = avformat_index_get_entries_count(stream);
+	entries_.reserve(count);
+	for (int i = 0; i < count; i++)
+	{
+		const AVIndexEntry* entry = avformat_index_get_entry(stream, i);
+		if (entry && (entry->flags & AVINDEX_KEYFRAME) && entry->timestamp != AV_NOPTS_VALUE)
+			entries_.push_back(Entry{ entry->timestamp + reorder_margin, entry->timestamp });
+	}
+	std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.Pts < b.Pts; });
+}
+
+void KeyframeIndex::AddKeyframe(std::int64_t pts, std::int64_t dts)
+{
+	if (pts == AV_NOPTS_VALUE)
+		return;
+	if (dts == AV_NOPTS_VALUE)
+		dts = pts;
+	// exact values replace the estimate taken from the demuxer's index
+	auto same = std::find_if(entries_.rbegin(), entries_.rend(), [dts](const Entry& entry) { return entry.Dts == dts; });
+	if (same != entries_.rend())
+	{
+		if (same->Pts == pts)
+			return;
+		entries_.erase(std::next(same).base());
+	}
+	auto position = std::upper_bound(entries_.begin(), entries_.end(), pts, [](std::int64_t value, const Entry& entry) { return value < entry.Pts; });
+	if (position != entries_.begin() && std::prev(position)->Pts == pts)
+		return;
+	entries_.insert(position, Entry{ pts, dts });
+}
+
+std::int64_t KeyframeIndex::FindSeekTimestamp(std::int64_t target_pts) const
+{
+	auto next = std::upper_bound(entries_.begin(), entries_.end(), target_pts, [](std::int64_t value, const Entry& entry) { return value < entry.Pts; });
+	if (next == entries_.begin())
+		return AV_NOPTS_VALUE;
+	const Entry& keyframe = *std::prev(next);
+	return FFMIN(keyframe.Pts, keyframe.Dts);
+}
+
+static bool GetMediaFileStamp(const std::string& media_file_name, std::int64_t& size, std::int64_t& time)
+{
+	std::error_code error;
+	std::filesystem::path path(media_file_name);
+	size = static_cast<std::int64_t>(std::filesystem::file_size(path, error));
+	if (error)
+		return false;
+	time = static_cast<std::int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+	return !error;
+}
+
+// any failure (corrupt, truncated or foreign file) makes the caller build the index again
+bool KeyframeIndex::Load(const std::string& file_name, const std::string& media_file_name, int stream_index)
+{
+	try
+	{
+		std::int64_t media_size, media_time;
+		if (!GetMediaFileStamp(media_file_name, media_size, media_time))
+			return false;
+		std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+		const std::int64_t file_size = static_cast<std::int64_t>(file.tellg());
+		std::int64_t header[5] = { 0 };
+		if (file_size < static_cast<std::int64_t>(sizeof(header)) || !file.seekg(0) || !file.read(reinterpret_cast<char*>(header), sizeof(header)))
+			return false;
+		if (header[0] != KEYFRAME_INDEX_FILE_MAGIC || header[1] != media_size || header[2] != media_time || header[3] != stream_index || header[4] < 0)
+			return false;
+		// the count has to match the file size before anything is allocated for it
+		if (header[4] != (file_size - static_cast<std::int64_t>(sizeof(header))) / static_cast<std::int64_t>(sizeof(Entry)) || (file_size - static_cast<std::int64_t>(sizeof(header))) % static_cast<std::int64_t>(sizeof(Entry)) != 0)
+			return false;
+		std::vector<Entry> entries(static_cast<size_t>(header[4]));
+		if (!entries.empty() && !file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(Entry)))
+			return false;
+		if (!std::is_sorted(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.Pts < b.Pts; }))
+			return false;
+		entries_ = std::move(entries);
+		is_complete_ = true;
+		return true;
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+}
+
+bool KeyframeIndex::Save(const std::string& file_name, const std::string& media_file_name, int stream_index) const
+{
+	std::int64_t media_size, media_time;
+	if (!is_complete_ || !GetMediaFileStamp(media_file_name, media_size, media_time))
+		return false;
+	std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+	std::int64_t header[5] = { KEYFRAME_INDEX_FILE_MAGIC, media_size, media_time, stream_index, static_cast<std::int64_t>(entries_.size()) };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries_.data()), entries_.size() * sizeof(Entry));
+	return !!file;
+}
+
+}}
@@ -0,0 +1,36 @@
+#pragma once
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+/// <summary>
+/// Sorted list of keyframes of a video stream, used to start decoding at the nearest keyframe preceding the seek target.
+/// Filled from the demuxer's index (if any) and refined with key packets read from the file.
+/// Once the whole file was read, the index can be stored next to the media file and loaded on next open.
+/// Not thread safe.
+/// </summary>
+class KeyframeIndex final : Common::NonCopyable
+{
+public:
+	KeyframeIndex();
+	// adds the keyframes the demuxer knows about, their pts is estimated, so they are used conservatively
+	void Initialize(AVStream* stream);
+	void AddKeyframe(std::int64_t pts, std::int64_t dts);
+	// returns timestamp (in stream time base) to seek to, to have the frame at target_pts decoded, or AV_NOPTS_VALUE if no keyframe known
+	std::int64_t FindSeekTimestamp(std::int64_t target_pts) const;
+	bool IsComplete() const { return is_complete_; }
+	void SetComplete() { is_complete_ = true; }
+	size_t Count() const { return entries_.size(); }
+	bool Load(const std::string& file_name, const std::string& media_file_name, int stream_index);
+	bool Save(const std::string& file_name, const std::string& media_file_name, int stream_index) const;
+private:
+	struct Entry
+	{
+		std::int64_t Pts;
+		std::int64_t Dts;
+	};
+	std::vector<Entry> entries_;
+	bool is_complete_ = false;
+};
+
+}}
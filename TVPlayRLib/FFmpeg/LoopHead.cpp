@@ -0,0 +1,255 @@
+#include "../pch.h"
+#include "LoopHead.h"
+#include "InputFormat.h"
+#include "Decoder.h"
+#include "PlayerScaler.h"
+#include "AudioMuxer.h"
+#include "FFmpegUtils.h"
+#include "../Core/Player.h"
+#include "../Core/StreamInfo.h"
+#include "../Core/AudioChannelMapEntry.h"
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+#define LOOP_HEAD_MAX_CLIP_DURATION (10 * AV_TIME_BASE) // clips up to that long are decoded whole...
+#define LOOP_HEAD_MAX_CLIP_BYTES (512 * 1024 * 1024) // ...unless their frames take more memory
+
+struct LoopHead::implementation : Common::DebugTarget
+{
+	const std::string file_name_;
+	const Core::Player& player_;
+	const int video_stream_index_;
+	const std::vector<int> audio_stream_indexes_;
+	const Core::HwAccel acceleration_;
+	const std::string hw_device_;
+	const DecoderSettings decoder_settings_;
+	const std::vector<Core::AudioChannelMapEntry> audio_channel_map_;
+	const std::int64_t head_duration_;
+	const std::int64_t video_frame_duration_;
+	bool may_be_whole_clip_ = false;
+	std::vector<std::shared_ptr<AVFrame>> video_;
+	std::vector<std::shared_ptr<AVFrame>> audio_;
+	AVRational video_time_base_ = { 0, 1 };
+	AVRational audio_time_base_ = { 0, 1 };
+	std::int64_t video_start_ = AV_NOPTS_VALUE;
+	std::int64_t video_end_ = AV_NOPTS_VALUE;
+	std::int64_t audio_end_ = AV_NOPTS_VALUE;
+	size_t bytes_ = 0;
+	// written by the decoding thread before is_ready_ is set, read-only afterwards
+	std::shared_ptr<const DecodedClip> clip_;
+	bool is_valid_ = false;
+	bool is_whole_clip_ = false;
+	std::atomic_bool is_ready_ = false;
+	std::atomic_bool is_running_ = true;
+	std::thread thread_;
+
+	implementation(const std::string& file_name, const Core::Player& player, int video_stream_index, const std::vector<int>& audio_stream_indexes, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings, const std::vector<Core::AudioChannelMapEntry>& audio_channel_map, std::int64_t head_duration)
+		: Common::DebugTarget(Common::DebugSeverity::info, "LoopHead " + file_name)
+		, file_name_(file_name)
+		, player_(player)
+		, video_stream_index_(video_stream_index)
+		, audio_stream_indexes_(audio_stream_indexes)
+		, acceleration_(acceleration)
+		, hw_device_(hw_device)
+		, decoder_settings_(GetDecoderSettings(decoder_settings))
+		, audio_channel_map_(audio_channel_map)
+		, head_duration_(FFMAX(head_duration, 1LL))
+		, video_frame_duration_(av_rescale(AV_TIME_BASE, player.Format().FrameRate().av().den, player.Format().FrameRate().av().num))
+	{
+		thread_ = std::thread(&implementation::Run, this);
+	}
+
+	// the head is decoded ahead of time, it doesn't take decoding threads from the inputs played
+	static DecoderSettings GetDecoderSettings(const DecoderSettings& decoder_settings)
+	{
+		DecoderSettings settings = decoder_settings;
+		settings.IsBackground = true;
+		return settings;
+	}
+
+	~implementation()
+	{
+		is_running_ = false;
+		thread_.join();
+	}
+
+	void Run()
+	{
+#ifdef DEBUG
+		Common::SetThreadName(::GetCurrentThreadId(), ("LoopHead " + file_name_).c_str());
+#endif
+		try
+		{
+			Decode();
+		}
+		catch (const std::exception& e)
+		{
+			DebugPrintLine(Common::DebugSeverity::error, std::string("Decoding failed: ") + e.what());
+			clip_.reset();
+			is_valid_ = false;
+		}
+		video_.clear();
+		audio_.clear();
+		is_ready_ = true;
+	}
+
+	static const Core::StreamInfo* FindStream(const InputFormat& input, int stream_index)
+	{
+		auto& streams = input.GetStreams();
+		auto stream = std::find_if(streams.begin(), streams.end(), [stream_index](const Core::StreamInfo& info) { return info.Index == stream_index; });
+		return stream == streams.end() ? nullptr : &*stream;
+	}
+
+	void Decode()
+	{
+		InputFormat input(file_name_);
+		if (!input.LoadStreamData())
+			THROW_EXCEPTION("LoopHead: stream data not loaded");
+		const Core::StreamInfo* video_stream = FindStream(input, video_stream_index_);
+		if (!video_stream)
+			THROW_EXCEPTION("LoopHead: video stream not found");
+		may_be_whole_clip_ = video_stream->Duration != AV_NOPTS_VALUE && video_stream->Duration > 0 && video_stream->Duration <= LOOP_HEAD_MAX_CLIP_DURATION;
+		Decoder video_decoder(video_stream->Codec, video_stream->Stream, video_stream->StartTime, acceleration_, hw_device_, decoder_settings_);
+		std::vector<std::unique_ptr<Decoder>> audio_decoders;
+		for (int index : audio_stream_indexes_)
+		{
+			const Core::StreamInfo* stream = FindStream(input, index);
+			if (stream)
+				audio_decoders.emplace_back(std::make_unique<Decoder>(stream->Codec, stream->Stream, video_stream->StartTime ? video_stream->StartTime : stream->StartTime, decoder_settings_));
+		}
+		PlayerScaler scaler(player_);
+		std::unique_ptr<AudioMuxer> audio_muxer;
+		if (!audio_decoders.empty())
+		{
+			audio_muxer = std::make_unique<AudioMuxer>(audio_decoders, AV_CH_LAYOUT_STEREO, player_.AudioSampleFormat(), 48000, player_.AudioChannelsCount());
+			audio_muxer->SetChannelMap(audio_channel_map_);
+		}
+		bool is_eof = false;
+		while (is_running_ && !is_eof && !IsHeadComplete())
+		{
+			auto packet = input.PullPacket();
+			if (!packet)
+			{
+				video_decoder.Flush();
+				for (const auto& decoder : audio_decoders)
+					decoder->Flush();
+				while (is_running_ && !video_decoder.IsEof())
+					PullVideo(video_decoder, scaler);
+				while (is_running_ && audio_muxer && !audio_muxer->IsEof())
+					PullAudio(audio_decoders, *audio_muxer);
+				is_eof = true;
+			}
+			else if (packet->stream_index == video_decoder.StreamIndex())
+			{
+				while (!video_decoder.Push(packet))
+					PullVideo(video_decoder, scaler);
+				while (PullVideo(video_decoder, scaler));
+			}
+			else
+			{
+				auto decoder = std::find_if(audio_decoders.begin(), audio_decoders.end(), [&packet](const std::unique_ptr<Decoder>& d) { return d->StreamIndex() == packet->stream_index; });
+				if (decoder == audio_decoders.end())
+					continue;
+				while (!(*decoder)->Push(packet))
+					PullAudio(audio_decoders, *audio_muxer);
+				while (PullAudio(audio_decoders, *audio_muxer));
+			}
+		}
+		if (!is_running_)
+			return;
+		Finalize(is_eof);
+	}
+
+	// returns true if the decoder returned a frame
+	bool PullVideo(Decoder& decoder, PlayerScaler& scaler)
+	{
+		auto decoded = decoder.Pull();
+		if (decoded)
+			scaler.Push(decoded, decoder.FrameRate(), decoder.TimeBase());
+		if (decoder.IsEof() && !scaler.IsFlushed())
+			scaler.Flush();
+		if (!scaler.IsInitialized())
+			return !!decoded;
+		while (auto scaled = scaler.Pull())
+		{
+			video_time_base_ = scaler.OutputTimeBase();
+			std::int64_t time = PtsToTime(scaled->pts, video_time_base_);
+			if (video_start_ == AV_NOPTS_VALUE)
+				video_start_ = time;
+			video_end_ = time + video_frame_duration_;
+			bytes_ += FrameBytes(scaled.get());
+			video_.push_back(scaled);
+		}
+		return !!decoded;
+	}
+
+	// returns true if any decoder returned a frame
+	bool PullAudio(const std::vector<std::unique_ptr<Decoder>>& decoders, AudioMuxer& muxer)
+	{
+		bool decoded_any = false;
+		for (const auto& decoder : decoders)
+		{
+			auto decoded = decoder->Pull();
+			if (!decoded)
+				continue;
+			muxer.Push(decoder->StreamIndex(), decoded);
+			decoded_any = true;
+		}
+		if (!muxer.IsFlushed() && std::all_of(decoders.begin(), decoders.end(), [](const std::unique_ptr<Decoder>& decoder) { return decoder->IsEof(); }))
+			muxer.Flush();
+		while (auto muxed = muxer.Pull())
+		{
+			audio_time_base_ = muxer.OutputTimeBase();
+			audio_end_ = PtsToTime(muxed->pts, audio_time_base_) + av_rescale(muxed->nb_samples, AV_TIME_BASE, muxed->sample_rate);
+			bytes_ += FrameBytes(muxed.get());
+			audio_.push_back(muxed);
+		}
+		return decoded_any;
+	}
+
+	bool IsHeadComplete() const
+	{
+		if (video_.empty() || video_end_ - video_start_ < head_duration_)
+			return false;
+		// audio interleaved late in the file is waited for, but not longer than another head duration
+		if (!audio_stream_indexes_.empty() && audio_end_ < video_end_ && video_end_ - video_start_ < head_duration_ * 2)
+			return false;
+		return !may_be_whole_clip_ || bytes_ > LOOP_HEAD_MAX_CLIP_BYTES;
+	}
+
+	void Finalize(bool is_whole_clip)
+	{
+		if (video_.empty())
+			THROW_EXCEPTION("LoopHead: no video frame decoded");
+		size_t video_count = video_.size();
+		if (!is_whole_clip)
+		{
+			video_count = 0;
+			while (video_count < video_.size() && PtsToTime(video_[video_count]->pts, video_time_base_) - video_start_ < head_duration_)
+				video_count++;
+			video_count = FFMAX(video_count, static_cast<size_t>(1));
+			video_.resize(video_count);
+		}
+		clip_ = CreateDecodedClip(video_, video_time_base_, video_frame_duration_, audio_, audio_time_base_);
+		is_whole_clip_ = is_whole_clip;
+		is_valid_ = true;
+		DebugPrintLine(Common::DebugSeverity::info, std::string(is_whole_clip ? "Whole clip" : "Head") + " decoded: " + std::to_string(clip_->Frames.size()) + " frames, " + std::to_string(clip_->Bytes / (1024 * 1024)) + " MB");
+	}
+};
+
+LoopHead::LoopHead(const std::string& file_name, const Core::Player& player, int video_stream_index, const std::vector<int>& audio_stream_indexes, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings, const std::vector<Core::AudioChannelMapEntry>& audio_channel_map, std::int64_t head_duration)
+	: impl_(std::make_unique<implementation>(file_name, player, video_stream_index, audio_stream_indexes, acceleration, hw_device, decoder_settings, audio_channel_map, head_duration))
+{ }
+
+LoopHead::~LoopHead() { }
+
+bool LoopHead::IsReady() const { return impl_->is_ready_; }
+
+bool LoopHead::IsValid() const { return impl_->is_ready_ && impl_->is_valid_; }
+
+bool LoopHead::IsWholeClip() const { return impl_->is_whole_clip_; }
+
+std::shared_ptr<const DecodedClip> LoopHead::GetClip() const { return IsValid() ? impl_->clip_ : nullptr; }
+
+}}
@@ -0,0 +1,33 @@
+#pragma once
+#include "DecoderSettings.h"
+#include "ClipCache.h"
+
+namespace TVPlayR {
+	namespace Core {
+		class Player;
+		class AudioChannelMapEntry;
+		enum class HwAccel;
+	}
+	namespace FFmpeg {
+
+/// <summary>
+/// Beginning of a looped file, decoded and converted to player's format ahead of the loop point by a separate demuxer and decoders on its own thread.
+/// At the loop point the input pushes these frames to its buffer, while its own pipeline seeks to the end of the clip (which the frames cover),
+/// or, if the whole clip was short enough to be decoded here, loops from memory without reading the file again.
+/// </summary>
+class LoopHead final : Common::NonCopyable
+{
+public:
+	LoopHead(const std::string& file_name, const Core::Player& player, int video_stream_index, const std::vector<int>& audio_stream_indexes, Core::HwAccel acceleration, const std::string& hw_device, const DecoderSettings& decoder_settings, const std::vector<Core::AudioChannelMapEntry>& audio_channel_map, std::int64_t head_duration);
+	~LoopHead();
+	bool IsReady() const;
+	bool IsValid() const;
+	bool IsWholeClip() const;
+	// nullptr until the head is ready and valid
+	std::shared_ptr<const DecodedClip> GetClip() const;
+private:
+	struct implementation;
+	std::unique_ptr<implementation> impl_;
+};
+
+}}
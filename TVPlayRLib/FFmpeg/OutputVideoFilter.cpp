@@ -15,5 +15,10 @@ namespace TVPlayR
 		{
 			return VideoFilterBase::Push(frame);
 		}
+
+		bool OutputVideoFilter::Push(const std::shared_ptr<AVFrame>& frame, std::int64_t pts)
+		{
+			return VideoFilterBase::Push(frame, pts);
+		}
 	}
 }
@@ -12,6 +12,7 @@ namespace TVPlayR {
 		public:
 			OutputVideoFilter(AVRational input_frame_rate, const std::string& filter_str, AVPixelFormat output_pix_fmt);
 			bool Push(std::shared_ptr<AVFrame> frame);
+			bool Push(const std::shared_ptr<AVFrame>& frame, std::int64_t pts);
 		};
 
 	}
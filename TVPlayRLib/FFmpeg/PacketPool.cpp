@@ -0,0 +1,75 @@
+#include "../pch.h"
+#include "PacketPool.h"
+#include "FFmpegUtils.h"
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+#define PACKET_POOL_MAX_COUNT 1024
+
+struct PacketPool::implementation
+{
+	std::mutex mutex_;
+	std::vector<AVPacket*> free_packets_;
+	std::atomic_int64_t requests_ = 0LL;
+	std::atomic_int64_t allocations_ = 0LL;
+
+	~implementation()
+	{
+		for (AVPacket* packet : free_packets_)
+			av_packet_free(&packet);
+	}
+
+	AVPacket* Get()
+	{
+		requests_++;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!free_packets_.empty())
+			{
+				AVPacket* packet = free_packets_.back();
+				free_packets_.pop_back();
+				return packet;
+			}
+		}
+		allocations_++;
+		return av_packet_alloc();
+	}
+
+	void Release(AVPacket* packet)
+	{
+		av_packet_unref(packet);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (free_packets_.size() < PACKET_POOL_MAX_COUNT)
+			{
+				free_packets_.push_back(packet);
+				return;
+			}
+		}
+		av_packet_free(&packet);
+	}
+};
+
+PacketPool::PacketPool()
+	: impl_(std::make_shared<implementation>())
+{ }
+
+PacketPool::~PacketPool() { }
+
+std::shared_ptr<AVPacket> PacketPool::AllocPacket()
+{
+	AVPacket* packet = impl_->Get();
+	if (!packet)
+		return nullptr;
+	std::shared_ptr<implementation> pool = impl_;
+	return std::shared_ptr<AVPacket>(packet, [pool](AVPacket* p) { pool->Release(p); });
+}
+
+PacketPoolStatistics PacketPool::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return PacketPoolStatistics{ impl_->requests_, impl_->allocations_, impl_->free_packets_.size() };
+}
+
+}}
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+struct PacketPoolStatistics
+{
+	std::int64_t Requests;
+	std::int64_t Allocations;
+	std::int64_t Hits() const { return Requests - Allocations; }
+	size_t PoolCount;
+};
+
+/// <summary>
+/// Keeps released AVPacket structures (with their side data arrays freed) to reuse them for next packets read from the demuxer,
+/// instead of allocating a new one every packet. Packet data buffers are owned by the demuxer and are not pooled here.
+/// </summary>
+class PacketPool final : Common::NonCopyable
+{
+public:
+	PacketPool();
+	~PacketPool();
+	std::shared_ptr<AVPacket> AllocPacket();
+	PacketPoolStatistics GetStatistics();
+private:
+	struct implementation;
+	// shared with the deleters of allocated packets, so packets can outlive the pool
+	std::shared_ptr<implementation> impl_;
+};
+
+}}
@@ -66,15 +66,11 @@ namespace TVPlayR {
 		std::shared_ptr<AVFrame> PauseBuffer::FrameToField(std::shared_ptr<AVFrame>& source, bool top_field)
 		{
 			assert(field_order_ == FieldOrder::BottomFieldFirst || field_order_ == FieldOrder::TopFieldFirst);
-			std::shared_ptr<AVFrame> dest = AllocFrame();
-			dest->width = source->width;
-			dest->height = source->height;
-			dest->format = source->format;
+			std::shared_ptr<AVFrame> dest = AllocPooledVideoFrame(source->width, source->height, static_cast<AVPixelFormat>(source->format));
 			dest->pict_type = source->pict_type;
 			dest->sample_aspect_ratio = source->sample_aspect_ratio;
 			dest->interlaced_frame = source->interlaced_frame;
 			dest->top_field_first = source->top_field_first;
-			THROW_ON_FFMPEG_ERROR(av_frame_get_buffer(dest.get(), 0));
 
 			const uint8_t* source_data[AV_NUM_DATA_POINTERS] = { 0 };
 			int source_linesizes[AV_NUM_DATA_POINTERS] = { 0 };
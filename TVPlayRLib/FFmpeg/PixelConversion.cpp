@@ -0,0 +1,37 @@
+#include "../pch.h"
+#include "PixelConversion.h"
+#include "PixelConversionKernels.h"
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+template <UYVY_ROW_KERNEL kernel>
+static void ConvertUyvyToPlanar(const AVFrame* source, AVFrame* destination)
+{
+	for (int row = 0; row < source->height; row++)
+		kernel(source->data[0] + static_cast<ptrdiff_t>(row) * source->linesize[0],
+			destination->data[0] + static_cast<ptrdiff_t>(row) * destination->linesize[0],
+			destination->data[1] + static_cast<ptrdiff_t>(row) * destination->linesize[1],
+			destination->data[2] + static_cast<ptrdiff_t>(row) * destination->linesize[2],
+			source->width);
+}
+
+PIXEL_CONVERSION GetPixelConversion(AVPixelFormat source_format, AVPixelFormat destination_format, int width, bool reference)
+{
+	if (source_format != AV_PIX_FMT_UYVY422 || width % 2 != 0)
+		return nullptr;
+	const bool avx2 = !reference && Common::CpuFeatures::Instance().HasAvx2();
+#ifdef CPU_X64
+	if (avx2 && destination_format == AV_PIX_FMT_YUV422P)
+		return ConvertUyvyToPlanar<UyvyToYuv422pAvx2>;
+	if (avx2 && destination_format == AV_PIX_FMT_YUV422P10LE)
+		return ConvertUyvyToPlanar<UyvyToYuv422p10Avx2>;
+#endif // CPU_X64
+	if (destination_format == AV_PIX_FMT_YUV422P)
+		return ConvertUyvyToPlanar<UyvyToYuv422pScalar>;
+	if (destination_format == AV_PIX_FMT_YUV422P10LE)
+		return ConvertUyvyToPlanar<UyvyToYuv422p10Scalar>;
+	return nullptr;
+}
+
+}}
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+// converts whole frame of the same size, destination buffers have to be allocated
+typedef void(*PIXEL_CONVERSION)(const AVFrame* source, AVFrame* destination);
+
+/// <summary>
+/// Same size conversions between pixel formats used by the players and the outputs, done by repacking and shifting only.
+/// Only UYVY to planar 4:2:2 (8 and 10 bit) is handled, with the same result as swscale (see Benchmarks/PixelConversionTest.cpp).
+/// Conversions that need rounding or a colour matrix, like X2RGB10 or BGRA to UYVY, are left to swscale.
+/// AVX2 kernels are used if the CPU has them.
+/// Returns nullptr if there is no conversion for the pair (including frames of odd width for 4:2:2 formats),
+/// reference selects the scalar implementation, regardless of the CPU.
+/// </summary>
+PIXEL_CONVERSION GetPixelConversion(AVPixelFormat source_format, AVPixelFormat destination_format, int width, bool reference = false);
+
+}}
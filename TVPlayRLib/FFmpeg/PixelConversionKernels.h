@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include "../Common/CpuFeatures.h"
+#ifdef CPU_X64
+#include <immintrin.h>
+#endif
+
+// row kernels of PixelConversion, without dependencies on the precompiled header, so the tests and benchmarks can build them on their own
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+// UYVY row to planar 4:2:2 rows, width is even
+typedef void(*UYVY_ROW_KERNEL)(const uint8_t* source, uint8_t* y, uint8_t* u, uint8_t* v, int width);
+
+inline void UyvyToYuv422pScalar(const uint8_t* source, uint8_t* y, uint8_t* u, uint8_t* v, int width)
+{
+	for (int x = 0; x < width / 2; x++)
+	{
+		u[x] = source[4 * x];
+		y[2 * x] = source[4 * x + 1];
+		v[x] = source[4 * x + 2];
+		y[2 * x + 1] = source[4 * x + 3];
+	}
+}
+
+// components moved to the upper bits, as swscale does when the bit depth grows in unscaled conversion of packed input
+inline void UyvyToYuv422p10Scalar(const uint8_t* source, uint8_t* y, uint8_t* u, uint8_t* v, int width)
+{
+	uint16_t* y16 = reinterpret_cast<uint16_t*>(y);
+	uint16_t* u16 = reinterpret_cast<uint16_t*>(u);
+	uint16_t* v16 = reinterpret_cast<uint16_t*>(v);
+	for (int x = 0; x < width / 2; x++)
+	{
+		u16[x] = static_cast<uint16_t>(source[4 * x] << 2);
+		y16[2 * x] = static_cast<uint16_t>(source[4 * x + 1] << 2);
+		v16[x] = static_cast<uint16_t>(source[4 * x + 2] << 2);
+		y16[2 * x + 1] = static_cast<uint16_t>(source[4 * x + 3] << 2);
+	}
+}
+
+#ifdef CPU_X64
+
+// 32 pixels: Y, U and V bytes of each 128-bit lane gathered, then the 64-bit quarters put in order
+CPU_TARGET("avx2") inline void SplitUyvyAvx2(const uint8_t* source, __m256i& y, __m128i& u, __m128i& v)
+{
+	const __m256i split = _mm256_setr_epi8(
+		1, 3, 5, 7, 9, 11, 13, 15, 0, 4, 8, 12, 2, 6, 10, 14,
+		1, 3, 5, 7, 9, 11, 13, 15, 0, 4, 8, 12, 2, 6, 10, 14);
+	const __m256i separate = _mm256_setr_epi8(
+		0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15,
+		0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15);
+	__m256i first = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)), split);
+	__m256i second = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 32)), split);
+	y = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+	__m256i uv = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+	uv = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(uv, separate), _MM_SHUFFLE(3, 1, 2, 0));
+	u = _mm256_castsi256_si128(uv);
+	v = _mm256_extracti128_si256(uv, 1);
+}
+
+CPU_TARGET("avx2") inline void UyvyToYuv422pAvx2(const uint8_t* source, uint8_t* y, uint8_t* u, uint8_t* v, int width)
+{
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		__m256i luma;
+		__m128i cb, cr;
+		SplitUyvyAvx2(source + 2 * x, luma, cb, cr);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(y + x), luma);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(u + x / 2), cb);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(v + x / 2), cr);
+	}
+	_mm256_zeroupper();
+	UyvyToYuv422pScalar(source + 2 * x, y + x, u + x / 2, v + x / 2, width - x);
+}
+
+CPU_TARGET("avx2") inline void UyvyToYuv422p10Avx2(const uint8_t* source, uint8_t* y, uint8_t* u, uint8_t* v, int width)
+{
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		__m256i luma;
+		__m128i cb, cr;
+		SplitUyvyAvx2(source + 2 * x, luma, cb, cr);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(y + 2 * x), _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(luma)), 2));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(y + 2 * x + 32), _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(luma, 1)), 2));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(u + x), _mm256_slli_epi16(_mm256_cvtepu8_epi16(cb), 2));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(v + x), _mm256_slli_epi16(_mm256_cvtepu8_epi16(cr), 2));
+	}
+	_mm256_zeroupper();
+	UyvyToYuv422p10Scalar(source + 2 * x, y + 2 * x, u + x, v + x, width - x);
+}
+
+#endif // CPU_X64
+
+}}
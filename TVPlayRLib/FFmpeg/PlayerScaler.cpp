@@ -1,5 +1,7 @@
 #include "../pch.h"
 #include "PlayerScaler.h"
+#include "SwScale.h"
+#include "FFmpegUtils.h"
 #include "../Core/InputSource.h"
 #include "../PixelFormat.h"
 #include "../ColorSpace.h"
@@ -27,17 +29,118 @@ PlayerScaler::PlayerScaler(const Core::Player& player)
 	: VideoFilterBase(TVPlayR::PixelFormatToFFmpegFormat(player.PixelFormat()))
 	, output_format_(player.Format())
 	, output_pixel_format_(TVPlayR::PixelFormatToFFmpegFormat(player.PixelFormat()))
+	, scaling_settings_(player.GetScalingSettings())
 {
+	VideoFilterBase::SetGraphOptions(scaling_settings_.ThreadCount, SwsFlagsName(scaling_settings_.Algorithm));
 }
 
+PlayerScaler::~PlayerScaler() { }
 
 bool PlayerScaler::Push(std::shared_ptr<AVFrame> frame, AVRational input_frame_rate, AVRational input_time_base)
 {
-	if (!IsInitialized())
+	if (mode_ != ScalerMode::filter)
+	{
+		if (IsNativeFrame(frame, input_frame_rate))
+		{
+			if (mode_ == ScalerMode::undetermined)
+				DebugPrintLine(Common::DebugSeverity::debug, frame->format == output_pixel_format_ ? "Input in player's format, frames passed through" : "Input differs from player's format in pixel format only, frames converted with swscale");
+			mode_ = ScalerMode::native;
+			input_time_base_ = input_time_base;
+			last_native_frame_ = frame;
+			native_frame_rate_ = input_frame_rate;
+			PushNative(frame);
+			return true;
+		}
+		// frames already converted are still pulled, rescaled to the graph's time base
+		mode_ = ScalerMode::filter;
 		VideoFilterBase::SetFilter(GetFilterString(frame, input_frame_rate), input_time_base);
+	}
 	return VideoFilterBase::Push(frame);
 }
 
+std::shared_ptr<AVFrame> PlayerScaler::Pull()
+{
+	if (!native_frames_.empty())
+	{
+		auto frame = native_frames_.front();
+		native_frames_.pop_front();
+		if (mode_ == ScalerMode::filter)
+		{
+			frame = CloneFrame(frame);
+			frame->pts = av_rescale_q(frame->pts, input_time_base_, VideoFilterBase::OutputTimeBase());
+		}
+		return frame;
+	}
+	if (mode_ == ScalerMode::filter)
+		return VideoFilterBase::Pull();
+	if (mode_ == ScalerMode::native && is_flushed_)
+		is_eof_ = true;
+	return nullptr;
+}
+
+AVRational PlayerScaler::OutputTimeBase() const
+{
+	return mode_ == ScalerMode::filter ? VideoFilterBase::OutputTimeBase() : input_time_base_;
+}
+
+void PlayerScaler::Flush()
+{
+	if (mode_ == ScalerMode::filter)
+		VideoFilterBase::Flush();
+	else
+		is_flushed_ = true;
+}
+
+void PlayerScaler::Reset()
+{
+	VideoFilterBase::Reset();
+	mode_ = ScalerMode::undetermined;
+	native_frames_.clear();
+	last_native_frame_.reset();
+}
+
+bool PlayerScaler::IsInitialized() const
+{
+	return mode_ == ScalerMode::native || VideoFilterBase::IsInitialized();
+}
+
+bool PlayerScaler::IsNativeFrame(std::shared_ptr<AVFrame>& frame, Common::Rational<int> input_frame_rate)
+{
+	if (mode_ == ScalerMode::native && last_native_frame_ && input_frame_rate == native_frame_rate_ &&
+		frame->width == last_native_frame_->width &&
+		frame->height == last_native_frame_->height &&
+		frame->format == last_native_frame_->format &&
+		frame->interlaced_frame == last_native_frame_->interlaced_frame &&
+		frame->top_field_first == last_native_frame_->top_field_first &&
+		av_cmp_q(frame->sample_aspect_ratio, last_native_frame_->sample_aspect_ratio) == 0)
+		return true;
+	// anything but the pixel format conversion requires the graph
+	if (GetFilterString(frame, input_frame_rate) != "format=" + std::to_string(static_cast<int>(output_pixel_format_)))
+		return false;
+	if (frame->interlaced_frame && output_format_.field_order() != (frame->top_field_first ? TVPlayR::FieldOrder::TopFieldFirst : TVPlayR::FieldOrder::BottomFieldFirst))
+		return false;
+	if (frame->format == output_pixel_format_)
+		return true;
+	if (!sws_isSupportedInput(static_cast<AVPixelFormat>(frame->format)) || !sws_isSupportedOutput(output_pixel_format_))
+		return false;
+	// swscale doesn't convert chroma of each field separately
+	const AVPixFmtDescriptor* input_descriptor = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+	const AVPixFmtDescriptor* output_descriptor = av_pix_fmt_desc_get(output_pixel_format_);
+	return !frame->interlaced_frame || (input_descriptor && output_descriptor && input_descriptor->log2_chroma_h == output_descriptor->log2_chroma_h);
+}
+
+void PlayerScaler::PushNative(const std::shared_ptr<AVFrame>& frame)
+{
+	if (frame->format == output_pixel_format_)
+	{
+		native_frames_.push_back(frame);
+		return;
+	}
+	if (!converter_ || converter_->GetSrcPixelFormat() != frame->format || converter_->GetSrcWidth() != frame->width || converter_->GetSrcHeight() != frame->height)
+		converter_ = std::make_unique<SwScale>(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format), frame->width, frame->height, output_pixel_format_, scaling_settings_.ThreadCount, SwsFlags(scaling_settings_.Algorithm));
+	native_frames_.push_back(converter_->Scale(frame));
+}
+
 std::string PlayerScaler::GetFilterString(std::shared_ptr<AVFrame>& frame, Common::Rational<int> input_frame_rate)
 {
 	std::ostringstream filter;
@@ -58,22 +161,22 @@ std::string PlayerScaler::GetFilterString(std::shared_ptr<AVFrame>& frame, Commo
 		if (input_interlaced)
 		{
 			if (input_height < output_format_.height() && output_format_.field_order() != TVPlayR::FieldOrder::Progressive) // bwdif used only when upscaling
-				filter << "bwdif,scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ",interlace,";
+				filter << "bwdif,scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":flags=" << SwsFlagsName(scaling_settings_.Algorithm) << ",interlace,";
 			else if ((input_height != output_format_.height() || input_width != output_format_.width()) && output_format_.field_order() != TVPlayR::FieldOrder::Progressive)
-				filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ":interl=1,";
+				filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":flags=" << SwsFlagsName(scaling_settings_.Algorithm) << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ":interl=1,";
 			else if (output_format_.field_order() == TVPlayR::FieldOrder::Progressive)
 				filter << "yadif,";
 		}
 		else // progressive input
 			if ((input_height != output_format_.height() || input_width != output_format_.width()))
-				filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ",";
+				filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":flags=" << SwsFlagsName(scaling_settings_.Algorithm) << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ",";
 	}
 	else if (input_frame_rate == output_format_.FrameRate() * 2)
 	{
 		if (input_interlaced)
 			filter << "yadif,";
 		if (input_height != output_format_.height() || input_width != output_format_.width())
-			filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ",";
+			filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":flags=" << SwsFlagsName(scaling_settings_.Algorithm) << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ",";
 		if (output_format_.interlaced())
 			filter << "interlace,";
 		else
@@ -84,7 +187,7 @@ std::string PlayerScaler::GetFilterString(std::shared_ptr<AVFrame>& frame, Commo
 		if (input_interlaced)
 			filter << "bwdif,";
 		if (input_height != output_format_.height() || input_width != output_format_.width())
-			filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ",";
+			filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":flags=" << SwsFlagsName(scaling_settings_.Algorithm) << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ",";
 		if (!input_interlaced)
 			filter << "fps=" << output_format_.FrameRate().Numerator() << "/" << output_format_.FrameRate().Denominator() << ",";
 	}
@@ -93,7 +196,7 @@ std::string PlayerScaler::GetFilterString(std::shared_ptr<AVFrame>& frame, Commo
 		if (input_interlaced)
 			filter << "bwdif,"; // this will make the interlaced content as fluent as possible
 		if (input_height != output_format_.height() || input_width != output_format_.width())
-			filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ",";
+			filter << "scale=w=" << output_format_.width() << ":h=" << output_format_.height() << ":flags=" << SwsFlagsName(scaling_settings_.Algorithm) << ":out_color_matrix=" << ColorSpaceToString(output_format_.ColorSpace()) << ",";
 		filter << "fps=" << output_format_.FrameRate().Numerator() << "/" << output_format_.FrameRate().Denominator() << ",";
 	}
 	filter << "format=" << static_cast<int>(output_pixel_format_);
@@ -1,26 +1,51 @@
 #pragma once
 #include "VideoFilterBase.h"
 #include "../Core/VideoFormat.h"
-
+#include "../Core/Player.h"
+#include <deque>
 
 namespace TVPlayR {
-	namespace Core {
-		class Player;
-	}
 	namespace FFmpeg {
 
 class Decoder;
+class SwScale;
 
+/// <summary>
+/// Converts decoded frames to player's format. Frames already matching it (size, frame rate, field order) don't go through the filter graph:
+/// they are passed as they are if the pixel format matches too, or converted by swscale if it's the only difference.
+/// </summary>
 class PlayerScaler final :	public VideoFilterBase
 {
 public:
 	PlayerScaler(const Core::Player& player);
+	~PlayerScaler();
 	const Core::VideoFormat& Format() const { return output_format_; }
 	bool Push(std::shared_ptr<AVFrame> frame, AVRational input_frame_rate, AVRational input_time_base);
+	std::shared_ptr<AVFrame> Pull() override;
+	AVRational OutputTimeBase() const override;
+	void Flush() override;
+	void Reset() override;
+	bool IsInitialized() const override;
+	// true if frames bypass the filter graph
+	bool IsNative() const { return mode_ == ScalerMode::native; }
 private:
+	enum class ScalerMode {
+		undetermined,
+		native,
+		filter
+	};
 	const Core::VideoFormat output_format_;
 	const AVPixelFormat output_pixel_format_;
+	const Core::PlayerScalingSettings scaling_settings_;
+	ScalerMode mode_ = ScalerMode::undetermined;
+	AVRational input_time_base_ = av_make_q(1, 1);
+	std::deque<std::shared_ptr<AVFrame>> native_frames_;
+	std::shared_ptr<AVFrame> last_native_frame_; // frames of the same properties are native without building the filter string again
+	Common::Rational<int> native_frame_rate_;
+	std::unique_ptr<SwScale> converter_;
 	std::string GetFilterString(std::shared_ptr<AVFrame>& frame, Common::Rational<int> input_frame_rate);
+	bool IsNativeFrame(std::shared_ptr<AVFrame>& frame, Common::Rational<int> input_frame_rate);
+	void PushNative(const std::shared_ptr<AVFrame>& frame);
 };
 
 }}
\ No newline at end of file
@@ -0,0 +1,418 @@
+#include "../pch.h"
+#include "ReadAheadIO.h"
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+#define READ_AHEAD_BLOCK_SIZE (1024 * 1024)
+#define READ_AHEAD_AVIO_BUFFER_SIZE (64 * 1024)
+
+static std::wstring Utf8ToWide(const std::string& s)
+{
+	int length = MultiByteToWideChar(CP_UTF8, 0, s.c_str(), -1, NULL, 0);
+	if (length <= 0)
+		return std::wstring();
+	std::wstring result(length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, s.c_str(), -1, &result[0], length);
+	result.resize(length - 1);
+	return result;
+}
+
+static bool IsOnLocalFixedDrive(const std::wstring& file_name)
+{
+	wchar_t full_path[MAX_PATH];
+	DWORD length = GetFullPathNameW(file_name.c_str(), MAX_PATH, full_path, NULL);
+	if (length < 3 || length >= MAX_PATH || full_path[1] != L':')
+		return false; // UNC paths and names too long to check
+	wchar_t root[] = { full_path[0], L':', L'\\', L'\0' };
+	return GetDriveTypeW(root) == DRIVE_FIXED;
+}
+
+// in-page error of a mapped file (I/O error, file truncated) is an exception, not an error code of the read
+static bool CopyMapped(uint8_t* destination, const uint8_t* source, size_t size)
+{
+	__try
+	{
+		std::memcpy(destination, source, size);
+		return true;
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+}
+
+struct ReadAheadIO::implementation : Common::DebugTarget
+{
+	struct Block
+	{
+		std::unique_ptr<uint8_t[]> Data;
+		std::int64_t Offset = 0LL;
+		size_t Size = 0;
+	};
+
+	const HANDLE file_;
+	std::int64_t file_size_; // checked again at the end of the file, used only by the demuxer thread
+	const size_t window_size_;
+	std::atomic<IoAccessHint> access_hint_;
+	std::atomic_int64_t wait_time_ = 0LL;
+	std::atomic_int64_t bytes_read_ = 0LL;
+	std::int64_t position_ = 0LL; // of the demuxer, used only by its thread
+	AVIOContext* io_context_ = nullptr;
+
+	// memory mapped file
+	HANDLE mapping_ = NULL;
+	const uint8_t* view_ = nullptr;
+	std::int64_t prefetched_until_ = 0LL;
+
+	// file read by the read-ahead thread, blocks_ is a ring of blocks_count_ blocks read, starting with first_block_
+	std::vector<Block> blocks_;
+	size_t first_block_ = 0;
+	size_t blocks_count_ = 0;
+	size_t read_in_block_ = 0;
+	std::int64_t next_read_offset_ = 0LL;
+	std::uint64_t generation_ = 0ULL; // changed by seeking, blocks being read at that time are discarded
+	bool reader_eof_ = false;
+	bool reader_error_ = false;
+	bool is_running_ = true;
+	std::mutex mutex_;
+	std::condition_variable reader_cv_;
+	std::condition_variable data_cv_;
+	std::thread reader_thread_;
+
+	implementation(const std::string& file_name, HANDLE file, std::int64_t file_size, const ReadAheadSettings& settings, bool map)
+		: Common::DebugTarget(Common::DebugSeverity::info, "ReadAheadIO " + file_name)
+		, file_(file)
+		, file_size_(file_size)
+		, window_size_(FFMAX(settings.WindowSize, static_cast<size_t>(2 * READ_AHEAD_BLOCK_SIZE)))
+		, access_hint_(settings.AccessHint)
+	{
+		if (map)
+			Map();
+		uint8_t* buffer = static_cast<uint8_t*>(av_malloc(READ_AHEAD_AVIO_BUFFER_SIZE));
+		if (buffer)
+			io_context_ = avio_alloc_context(buffer, READ_AHEAD_AVIO_BUFFER_SIZE, 0, this, &implementation::ReadCallback, nullptr, &implementation::SeekCallback);
+		if (!io_context_)
+		{
+			av_free(buffer);
+			Close();
+			THROW_EXCEPTION("ReadAheadIO: unable to create I/O context for " + file_name);
+		}
+		if (view_)
+		{
+			DebugPrintLine(Common::DebugSeverity::info, "File mapped");
+			return;
+		}
+		StartReader();
+	}
+
+	void Map()
+	{
+		if (file_size_ <= 0)
+			return;
+		mapping_ = CreateFileMappingW(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping_)
+			view_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+		if (!view_ && mapping_)
+		{
+			CloseHandle(mapping_);
+			mapping_ = NULL;
+		}
+	}
+
+	void Unmap()
+	{
+		if (view_)
+			UnmapViewOfFile(view_);
+		if (mapping_)
+			CloseHandle(mapping_);
+		view_ = nullptr;
+		mapping_ = NULL;
+	}
+
+	// block buffers are allocated by the reader thread when first used, so random access allocates only one
+	void StartReader()
+	{
+		blocks_.resize(window_size_ / READ_AHEAD_BLOCK_SIZE);
+		next_read_offset_ = position_;
+		reader_thread_ = std::thread(&implementation::ReaderThread, this);
+		DebugPrintLine(Common::DebugSeverity::info, "Reading ahead up to " + std::to_string(blocks_.size()) + " blocks");
+	}
+
+	~implementation()
+	{
+		if (reader_thread_.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				is_running_ = false;
+			}
+			reader_cv_.notify_one();
+			reader_thread_.join();
+		}
+		av_freep(&io_context_->buffer);
+		avio_context_free(&io_context_);
+		Close();
+	}
+
+	void Close()
+	{
+		Unmap();
+		CloseHandle(file_);
+	}
+
+	// returns true if the file grew since its size was read, the view of a mapped file is mapped again
+	bool UpdateFileSize()
+	{
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart <= file_size_)
+			return false;
+		DebugPrintLine(Common::DebugSeverity::debug, "File grew to " + std::to_string(file_size.QuadPart) + " bytes");
+		file_size_ = file_size.QuadPart;
+		if (!view_)
+			return true;
+		Unmap();
+		Map();
+		prefetched_until_ = position_;
+		if (!view_)
+		{
+			DebugPrintLine(Common::DebugSeverity::warning, "File not mapped again, reading it");
+			StartReader();
+		}
+		return true;
+	}
+
+	static int ReadCallback(void* opaque, uint8_t* buf, int buf_size)
+	{
+		return static_cast<implementation*>(opaque)->Read(buf, buf_size);
+	}
+
+	static std::int64_t SeekCallback(void* opaque, std::int64_t offset, int whence)
+	{
+		return static_cast<implementation*>(opaque)->Seek(offset, whence);
+	}
+
+	int Read(uint8_t* buf, int buf_size)
+	{
+		if (view_ && position_ >= file_size_ && !UpdateFileSize())
+			return AVERROR_EOF;
+		return view_ ? ReadMapped(buf, buf_size) : ReadBuffered(buf, buf_size);
+	}
+
+	int ReadMapped(uint8_t* buf, int buf_size)
+	{
+		const size_t size = static_cast<size_t>(FFMIN(static_cast<std::int64_t>(buf_size), file_size_ - position_));
+		if (access_hint_ == IoAccessHint::sequential && prefetched_until_ - position_ < static_cast<std::int64_t>(window_size_ / 2))
+			Prefetch();
+		// page faults of the copy are the actual reads
+		auto start = std::chrono::steady_clock::now();
+		bool copied = CopyMapped(buf, view_ + position_, size);
+		wait_time_ += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		if (!copied)
+		{
+			DebugPrintLine(Common::DebugSeverity::error, "Read error at " + std::to_string(position_));
+			return AVERROR(EIO);
+		}
+		position_ += size;
+		bytes_read_ += size;
+		return static_cast<int>(size);
+	}
+
+	void Prefetch()
+	{
+		std::int64_t begin = FFMAX(position_, prefetched_until_);
+		std::int64_t end = FFMIN(position_ + static_cast<std::int64_t>(window_size_), file_size_);
+		if (end <= begin)
+			return;
+		WIN32_MEMORY_RANGE_ENTRY range{ const_cast<uint8_t*>(view_ + begin), static_cast<SIZE_T>(end - begin) };
+		if (!PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0))
+			DebugPrintLine(Common::DebugSeverity::debug, "Prefetch failed");
+		prefetched_until_ = end;
+	}
+
+	int ReadBuffered(uint8_t* buf, int buf_size)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!blocks_count_ && reader_eof_ && UpdateFileSize())
+		{
+			reader_eof_ = false;
+			reader_cv_.notify_one();
+		}
+		if (!blocks_count_ && !reader_eof_ && !reader_error_)
+		{
+			auto start = std::chrono::steady_clock::now();
+			data_cv_.wait(lock, [&] { return blocks_count_ || reader_eof_ || reader_error_; });
+			wait_time_ += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+		if (!blocks_count_)
+			return reader_error_ ? AVERROR(EIO) : AVERROR_EOF;
+		size_t copied = 0;
+		while (copied < static_cast<size_t>(buf_size) && blocks_count_)
+		{
+			const Block& block = blocks_[first_block_];
+			size_t size = FFMIN(block.Size - read_in_block_, static_cast<size_t>(buf_size) - copied);
+			std::memcpy(buf + copied, block.Data.get() + read_in_block_, size);
+			copied += size;
+			read_in_block_ += size;
+			if (read_in_block_ == block.Size)
+				ReleaseFirstBlock();
+		}
+		position_ += copied;
+		bytes_read_ += copied;
+		return static_cast<int>(copied);
+	}
+
+	// called with mutex_ locked
+	void ReleaseFirstBlock()
+	{
+		first_block_ = (first_block_ + 1) % blocks_.size();
+		blocks_count_--;
+		read_in_block_ = 0;
+		reader_cv_.notify_one();
+	}
+
+	std::int64_t Seek(std::int64_t offset, int whence)
+	{
+		std::int64_t target;
+		switch (whence & ~AVSEEK_FORCE)
+		{
+		case AVSEEK_SIZE:
+			UpdateFileSize();
+			return file_size_;
+		case SEEK_SET:
+			target = offset;
+			break;
+		case SEEK_CUR:
+			target = position_ + offset;
+			break;
+		case SEEK_END:
+			target = file_size_ + offset;
+			break;
+		default:
+			return AVERROR(EINVAL);
+		}
+		if (target < 0)
+			return AVERROR(EINVAL);
+		position_ = target;
+		if (view_)
+		{
+			prefetched_until_ = target;
+			return target;
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (blocks_count_ && target >= blocks_[first_block_].Offset && target < next_read_offset_)
+		{
+			// short seeks (e.g. skipping over a packet) are served from blocks already read
+			while (target >= blocks_[first_block_].Offset + static_cast<std::int64_t>(blocks_[first_block_].Size))
+				ReleaseFirstBlock();
+			read_in_block_ = static_cast<size_t>(target - blocks_[first_block_].Offset);
+			return target;
+		}
+		generation_++;
+		first_block_ = 0;
+		blocks_count_ = 0;
+		read_in_block_ = 0;
+		next_read_offset_ = target;
+		reader_eof_ = false;
+		reader_error_ = false;
+		reader_cv_.notify_one();
+		return target;
+	}
+
+	// called with mutex_ locked
+	size_t BlocksAhead() const
+	{
+		return access_hint_ == IoAccessHint::sequential ? blocks_.size() : 1;
+	}
+
+	void ReaderThread()
+	{
+#ifdef DEBUG
+		Common::SetThreadName(::GetCurrentThreadId(), "ReadAheadIO");
+#endif
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (true)
+		{
+			reader_cv_.wait(lock, [&] { return !is_running_ || (!reader_eof_ && !reader_error_ && blocks_count_ < BlocksAhead()); });
+			if (!is_running_)
+				return;
+			// an empty ring starts again from its first block, so reading one block at a time uses only that one
+			if (!blocks_count_)
+				first_block_ = 0;
+			const size_t slot = (first_block_ + blocks_count_) % blocks_.size();
+			const std::int64_t offset = next_read_offset_;
+			const std::uint64_t generation = generation_;
+			lock.unlock();
+			// the slot is not visible to the demuxer until the block is counted
+			if (!blocks_[slot].Data)
+				blocks_[slot].Data = std::make_unique<uint8_t[]>(READ_AHEAD_BLOCK_SIZE);
+			OVERLAPPED overlapped{};
+			overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFLL);
+			overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+			DWORD read = 0;
+			BOOL success = ReadFile(file_, blocks_[slot].Data.get(), READ_AHEAD_BLOCK_SIZE, &read, &overlapped);
+			DWORD error = success ? ERROR_SUCCESS : GetLastError();
+			lock.lock();
+			if (generation != generation_)
+				continue;
+			if (!success && error != ERROR_HANDLE_EOF)
+			{
+				reader_error_ = true;
+				DebugPrintLine(Common::DebugSeverity::error, "Read error " + std::to_string(error) + " at " + std::to_string(offset));
+			}
+			else if (read == 0)
+				reader_eof_ = true;
+			else
+			{
+				blocks_[slot].Offset = offset;
+				blocks_[slot].Size = read;
+				blocks_count_++;
+				next_read_offset_ += read;
+			}
+			data_cv_.notify_one();
+		}
+	}
+};
+
+std::unique_ptr<ReadAheadIO> ReadAheadIO::Create(const std::string& file_name, const ReadAheadSettings& settings)
+{
+	if (file_name.find("://") != std::string::npos)
+		return nullptr;
+	std::wstring wide_file_name = Utf8ToWide(file_name);
+	HANDLE file = CreateFileW(wide_file_name.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		CloseHandle(file);
+		return nullptr;
+	}
+	bool map = settings.AllowMemoryMapping && IsOnLocalFixedDrive(wide_file_name);
+	return std::unique_ptr<ReadAheadIO>(new ReadAheadIO(std::make_unique<implementation>(file_name, file, file_size.QuadPart, settings, map)));
+}
+
+ReadAheadIO::ReadAheadIO(std::unique_ptr<implementation> impl)
+	: impl_(std::move(impl))
+{ }
+
+ReadAheadIO::~ReadAheadIO() { }
+
+AVIOContext* ReadAheadIO::GetContext() const { return impl_->io_context_; }
+
+void ReadAheadIO::SetAccessHint(IoAccessHint hint)
+{
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex_);
+		impl_->access_hint_ = hint;
+	}
+	impl_->reader_cv_.notify_one();
+}
+
+std::int64_t ReadAheadIO::GetWaitTime() const { return impl_->wait_time_; }
+
+std::int64_t ReadAheadIO::GetBytesRead() const { return impl_->bytes_read_; }
+
+bool ReadAheadIO::IsMemoryMapped() const { return !!impl_->view_; }
+
+}}
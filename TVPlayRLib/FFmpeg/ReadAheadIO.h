@@ -0,0 +1,43 @@
+#pragma once
+
+namespace TVPlayR {
+	namespace FFmpeg {
+
+enum class IoAccessHint
+{
+	sequential, // playback, the whole window is read ahead
+	random // seeking and short reads (thumbnails, probing), a single block is read ahead
+};
+
+struct ReadAheadSettings
+{
+	size_t WindowSize = 32 * 1024 * 1024; // bytes read ahead of the demuxer
+	bool AllowMemoryMapping = false; // files on local fixed drives are mapped instead of read by the read-ahead thread
+	IoAccessHint AccessHint = IoAccessHint::sequential;
+};
+
+/// <summary>
+/// Custom I/O for the demuxer, reading local and network files ahead of it.
+/// Files are read in blocks by a separate thread, or, if allowed, files on local fixed drives are memory mapped
+/// and the window ahead is prefetched by the system. I/O errors of mapped files are returned as AVERROR(EIO).
+/// Files growing while they are played (being recorded) are read further when the demuxer reaches their end.
+/// Time the demuxer waited for data is recorded to tell disk stalls from decoding ones.
+/// </summary>
+class ReadAheadIO final : Common::NonCopyable
+{
+public:
+	// returns nullptr if the file can't be read this way (e.g. it's an URL), so the default protocol should be used
+	static std::unique_ptr<ReadAheadIO> Create(const std::string& file_name, const ReadAheadSettings& settings);
+	~ReadAheadIO();
+	AVIOContext* GetContext() const;
+	void SetAccessHint(IoAccessHint hint);
+	std::int64_t GetWaitTime() const; // microseconds
+	std::int64_t GetBytesRead() const;
+	bool IsMemoryMapped() const;
+private:
+	struct implementation;
+	std::unique_ptr<implementation> impl_;
+	ReadAheadIO(std::unique_ptr<implementation> impl);
+};
+
+}}
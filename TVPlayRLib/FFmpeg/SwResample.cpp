@@ -25,15 +25,33 @@ namespace TVPlayR {
 
 		std::shared_ptr<AVFrame> SwResample::Resample(const std::shared_ptr<AVFrame> frame)
 		{
-			std::shared_ptr<AVFrame> resampled = AllocFrame();
-			resampled->nb_samples = swr_get_out_samples(swr_.get(), frame->nb_samples);
-			resampled->format = dest_sample_format_;
-			resampled->sample_rate = dest_sample_rate_;
-			resampled->ch_layout = dest_channel_layout_;
+			const int samples = swr_get_out_samples(swr_.get(), frame->nb_samples);
+			THROW_ON_FFMPEG_ERROR(samples);
+			if (samples == 0)
+			{
+				// all the input is buffered in the resampler until the next frame
+				THROW_ON_FFMPEG_ERROR(swr_convert(swr_.get(), NULL, 0, const_cast<const uint8_t**>(frame->extended_data), frame->nb_samples));
+				return nullptr;
+			}
+			// swr_convert_frame() uses nb_samples of the preallocated frame as its capacity and updates it with the number of samples converted
+			std::shared_ptr<AVFrame> resampled = AllocPooledAudioFrame(samples, dest_channel_layout_, dest_sample_format_, dest_sample_rate_);
 			THROW_ON_FFMPEG_ERROR(swr_convert_frame(swr_.get(), resampled.get(), frame.get()));
 			resampled->pts = frame->pts;
 			return resampled;
 		}
 
+		std::shared_ptr<AVFrame> SwResample::Flush()
+		{
+			int samples = swr_get_out_samples(swr_.get(), 0);
+			if (samples <= 0)
+				return nullptr;
+			std::shared_ptr<AVFrame> resampled = AllocPooledAudioFrame(samples, dest_channel_layout_, dest_sample_format_, dest_sample_rate_);
+			THROW_ON_FFMPEG_ERROR(swr_convert_frame(swr_.get(), resampled.get(), NULL));
+			if (resampled->nb_samples <= 0)
+				return nullptr;
+			resampled->pts = AV_NOPTS_VALUE;
+			return resampled;
+		}
+
 	}
 }
\ No newline at end of file
@@ -6,7 +6,10 @@ namespace TVPlayR {
 		{
 		public:
 			SwResample(int src_channel_count, int src_sample_rate, AVSampleFormat src_sample_format, int dest_channel_count , int dest_sample_rate, AVSampleFormat dest_sample_format);
+			// returns nullptr when the resampler only buffers the frame (too few samples for an output sample)
 			std::shared_ptr<AVFrame> Resample(const std::shared_ptr<AVFrame> frame);
+			// returns samples delayed by the resampler, nullptr if there are none, the frame has no pts
+			std::shared_ptr<AVFrame> Flush();
 			int OutputSampleRate() const { return dest_sample_rate_; }
 			AVChannelLayout OutputChannelLayout() const { return dest_channel_layout_; }
 		private:
@@ -1,35 +1,119 @@
 #include "../pch.h"
 #include "SwScale.h"
 #include "FFmpegUtils.h"
+#include "PixelConversion.h"
+#include "../Core/Player.h"
 
 namespace TVPlayR {
 	namespace FFmpeg {
 
-		SwScale::SwScale(int src_width, int src_height, AVPixelFormat src_pixel_format, int dest_width, int dest_height, AVPixelFormat dest_pixel_format)
+		int SwsFlags(Core::ScalerAlgorithm algorithm)
+		{
+			switch (algorithm)
+			{
+			case Core::ScalerAlgorithm::fast_bilinear:
+				return SWS_FAST_BILINEAR;
+			case Core::ScalerAlgorithm::bilinear:
+				return SWS_BILINEAR;
+			case Core::ScalerAlgorithm::bicubic:
+				return SWS_BICUBIC;
+			case Core::ScalerAlgorithm::lanczos:
+				return SWS_LANCZOS;
+			case Core::ScalerAlgorithm::spline:
+				return SWS_SPLINE;
+			default:
+				THROW_EXCEPTION("Invalid scaler algorithm")
+			}
+		}
+
+		const char* SwsFlagsName(Core::ScalerAlgorithm algorithm)
+		{
+			switch (algorithm)
+			{
+			case Core::ScalerAlgorithm::fast_bilinear:
+				return "fast_bilinear";
+			case Core::ScalerAlgorithm::bilinear:
+				return "bilinear";
+			case Core::ScalerAlgorithm::bicubic:
+				return "bicubic";
+			case Core::ScalerAlgorithm::lanczos:
+				return "lanczos";
+			case Core::ScalerAlgorithm::spline:
+				return "spline";
+			default:
+				THROW_EXCEPTION("Invalid scaler algorithm")
+			}
+		}
+
+		static SwsContext* CreateSwsContext(int src_width, int src_height, AVPixelFormat src_pixel_format, int dest_width, int dest_height, AVPixelFormat dest_pixel_format, int thread_count, int flags)
+		{
+			SwsContext* sws = sws_alloc_context();
+			if (!sws)
+				THROW_EXCEPTION("SwScale: context not allocated");
+			// the threads are used only by sws_scale_frame()
+			if (av_opt_set_int(sws, "srcw", src_width, 0) < 0 ||
+				av_opt_set_int(sws, "srch", src_height, 0) < 0 ||
+				av_opt_set_int(sws, "src_format", src_pixel_format, 0) < 0 ||
+				av_opt_set_int(sws, "dstw", dest_width, 0) < 0 ||
+				av_opt_set_int(sws, "dsth", dest_height, 0) < 0 ||
+				av_opt_set_int(sws, "dst_format", dest_pixel_format, 0) < 0 ||
+				av_opt_set_int(sws, "sws_flags", flags, 0) < 0 ||
+				av_opt_set_int(sws, "threads", thread_count, 0) < 0 ||
+				sws_init_context(sws, nullptr, nullptr) < 0)
+			{
+				sws_freeContext(sws);
+				THROW_EXCEPTION("SwScale: context not initialized");
+			}
+			return sws;
+		}
+
+		SwScale::SwScale(int src_width, int src_height, AVPixelFormat src_pixel_format, int dest_width, int dest_height, AVPixelFormat dest_pixel_format, int thread_count, int flags)
 			: src_width_(src_width)
 			, src_height_(src_height)
 			, src_pixel_format_(src_pixel_format)
 			, dest_width_(dest_width)
 			, dest_height_(dest_height)
 			, dest_pixel_format_(dest_pixel_format)
-			, sws_(sws_getContext(src_width, src_height, src_pixel_format, dest_width, dest_height, dest_pixel_format, 0, nullptr, nullptr, nullptr), 
+			, conversion_(src_width == dest_width && src_height == dest_height ? GetPixelConversion(src_pixel_format, dest_pixel_format, src_width) : nullptr)
+			, sws_(conversion_ ? nullptr : CreateSwsContext(src_width, src_height, src_pixel_format, dest_width, dest_height, dest_pixel_format, thread_count, flags),
 				[](SwsContext* ctx) { sws_freeContext(ctx); })
 		{ }
 
 		std::shared_ptr<AVFrame> SwScale::Scale(const std::shared_ptr<AVFrame>& in_frame)
 		{
-			std::shared_ptr<AVFrame> out_frame = AllocFrame();
-			out_frame->width = dest_width_;
-			out_frame->height = dest_height_;
-			out_frame->format = dest_pixel_format_;
+			std::shared_ptr<AVFrame> out_frame = AllocPooledVideoFrame(dest_width_, dest_height_, dest_pixel_format_);
+			Scale(in_frame, out_frame);
 			out_frame->pts = in_frame->pts;
 			out_frame->interlaced_frame = in_frame->interlaced_frame;
 			out_frame->top_field_first = in_frame->top_field_first;
 			out_frame->sample_aspect_ratio = in_frame->sample_aspect_ratio;
-			THROW_ON_FFMPEG_ERROR(av_frame_get_buffer(out_frame.get(), 0));
-			if (sws_scale(sws_.get(), in_frame->data, in_frame->linesize, 0, in_frame->height, out_frame->data, out_frame->linesize) != dest_height_)
-				THROW_EXCEPTION("SwScale: scale failed");
 			return out_frame;
 		}
 
+		void SwScale::Scale(const std::shared_ptr<AVFrame>& in_frame, const std::shared_ptr<AVFrame>& out_frame)
+		{
+			assert(out_frame->width == dest_width_ && out_frame->height == dest_height_ && out_frame->format == dest_pixel_format_);
+			if (conversion_)
+			{
+				conversion_(in_frame.get(), out_frame.get());
+				return;
+			}
+			SetColorspaceDetails(in_frame.get());
+			// slice threaded, if the context has more than one thread
+			if (sws_scale_frame(sws_.get(), out_frame.get(), in_frame.get()) < 0)
+				THROW_EXCEPTION("SwScale: scale failed");
+		}
+
+		// the same matrix and range the scale filter takes from the frame, the context defaults to BT.601 limited range otherwise
+		void SwScale::SetColorspaceDetails(const AVFrame* frame)
+		{
+			if (frame->colorspace == colorspace_ && frame->color_range == color_range_)
+				return;
+			// unspecified or RGB colorspace gives the default coefficients
+			const int* coefficients = sws_getCoefficients(frame->colorspace);
+			THROW_ON_FFMPEG_ERROR(sws_setColorspaceDetails(sws_.get(), coefficients, frame->color_range == AVCOL_RANGE_JPEG, coefficients, 0, 0, 1 << 16, 1 << 16));
+			colorspace_ = frame->colorspace;
+			color_range_ = frame->color_range;
+		}
+
 }}
\ No newline at end of file
@@ -1,12 +1,23 @@
 #pragma once
 
 namespace TVPlayR {
+	namespace Core {
+		enum class ScalerAlgorithm;
+	}
 	namespace FFmpeg {
+		// SWS_* flag of the algorithm
+		int SwsFlags(Core::ScalerAlgorithm algorithm);
+		// name of the algorithm, as swscale's "flags" option takes it
+		const char* SwsFlagsName(Core::ScalerAlgorithm algorithm);
+
 		class SwScale : Common::NonCopyable
 		{
 		public:
-			SwScale(int src_width, int src_height, AVPixelFormat src_pixel_format, int dest_width, int dest_height, AVPixelFormat dest_pixel_format);
+			// thread_count - slice threads, 0 - as many as cores
+			SwScale(int src_width, int src_height, AVPixelFormat src_pixel_format, int dest_width, int dest_height, AVPixelFormat dest_pixel_format, int thread_count = 1, int flags = SWS_BICUBIC);
 			std::shared_ptr<AVFrame> Scale(const std::shared_ptr<AVFrame>& in_frame);
+			// scales into existing frame of destination size and format
+			void Scale(const std::shared_ptr<AVFrame>& in_frame, const std::shared_ptr<AVFrame>& out_frame);
 			inline const AVPixelFormat GetSrcPixelFormat() const { return src_pixel_format_; }
 			inline const int GetSrcWidth() const { return src_width_; }
 			inline const int GetSrcHeight() const { return src_height_; }
@@ -20,6 +31,12 @@ namespace TVPlayR {
 			const AVPixelFormat dest_pixel_format_;
 			const int dest_width_;
 			const int dest_height_;
+			// used instead of the swscale context if there is a kernel for the conversion
+			void(*conversion_)(const AVFrame* source, AVFrame* destination);
 			std::unique_ptr<SwsContext, std::function<void(SwsContext*)>> sws_;
+			// matrix and range of the frames the context is set for
+			AVColorSpace colorspace_ = AVCOL_SPC_UNSPECIFIED;
+			AVColorRange color_range_ = AVCOL_RANGE_UNSPECIFIED;
+			void SetColorspaceDetails(const AVFrame* frame);
 		};
 }}
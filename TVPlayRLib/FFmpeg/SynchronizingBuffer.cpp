@@ -5,12 +5,15 @@
 #include "../Core/Player.h"
 #include "../Core/VideoFormat.h"
 #include "FFmpegUtils.h"
+#include "FFmpegInput.h"
 
 
 namespace TVPlayR {
 	namespace FFmpeg {
 
-	SynchronizingBuffer::SynchronizingBuffer(const Core::Player * player, bool is_playing, std::int64_t capacity, std::int64_t initial_sync, std::int64_t start_timecode, std::int64_t media_duration, FieldOrder field_order)
+#define BUFFER_OVERFLOW_FACTOR 2 // oldest frames and samples are dropped when the buffer holds that many times its capacity
+
+	SynchronizingBuffer::SynchronizingBuffer(const Core::Player * player, bool is_playing, const Core::PlayerBufferSettings& settings, std::int64_t initial_sync, std::int64_t start_timecode, std::int64_t media_duration, FieldOrder field_order)
 		: Common::DebugTarget(Common::DebugSeverity::error, "SynchronizingBuffer " + player->Name())
 		, video_format_(player->Format().type())
 		, video_frame_rate_(player->Format().FrameRate().av())
@@ -20,12 +23,14 @@ namespace TVPlayR {
 		, have_video_(true)
 		, have_audio_(player->AudioChannelsCount() > 0)
 		, is_playing_(is_playing)
-		, video_queue_size_(av_rescale(capacity, video_frame_rate_.num, video_frame_rate_.den * AV_TIME_BASE))
+		, video_queue_size_(FFMAX(av_rescale(settings.Duration, video_frame_rate_.num, video_frame_rate_.den * AV_TIME_BASE), 1LL))
 		, sync_(initial_sync)
 		, is_flushed_(false)
 		, audio_sample_format_(player->AudioSampleFormat())
-		, audio_fifo_size_(static_cast<int>(av_rescale(capacity, sample_rate_, AV_TIME_BASE)))
-		, capacity_(capacity)
+		, audio_fifo_size_(static_cast<int>(av_rescale(settings.Duration, sample_rate_, AV_TIME_BASE)))
+		, capacity_(settings.Duration)
+		, max_bytes_(settings.MaxBytes)
+		, low_watermark_percent_(FFMAX(FFMIN(settings.LowWatermarkPercent, 100), 1))
 		, start_timecode_(start_timecode)
 		, media_duration_(media_duration)
 		, pause_buffer_(field_order, is_playing)
@@ -38,24 +43,42 @@ namespace TVPlayR {
 		DebugPrintLine(Common::DebugSeverity::info, "Finalized");
 	}
 	
-	void SynchronizingBuffer::PushAudio(const std::shared_ptr<AVFrame>& frame) 
+	void SynchronizingBuffer::PushAudio(const std::shared_ptr<AVFrame>& pushed_frame) 
 	{
-		if (!(frame && have_audio_))
+		if (!(pushed_frame && have_audio_))
 			return;
+		std::shared_ptr<AVFrame> frame = pushed_frame;
+		if (skip_audio_until_ != AV_NOPTS_VALUE)
+		{
+			int samples_to_skip = static_cast<int>(av_rescale(skip_audio_until_ - PtsToTime(frame->pts, audio_time_base_), sample_rate_, AV_TIME_BASE));
+			if (samples_to_skip >= frame->nb_samples)
+				return;
+			if (samples_to_skip > 0)
+				frame = CopyAudioSamples(frame, samples_to_skip, frame->nb_samples - samples_to_skip, audio_time_base_);
+			skip_audio_until_ = AV_NOPTS_VALUE;
+		}
 		assert(!is_flushed_);
-		DebugPrintLine(Common::DebugSeverity::trace, "Push audio " + std::to_string(static_cast<float>(PtsToTime(frame->pts, audio_time_base_)) / AV_TIME_BASE));
-		Sweep();
+		DebugPrintLineLazy(Common::DebugSeverity::trace, "Push audio " + std::to_string(static_cast<float>(PtsToTime(frame->pts, audio_time_base_)) / AV_TIME_BASE));
 		if (!fifo_)
 		{
-			fifo_ = std::make_unique<AudioFifo>(audio_sample_format_, audio_channel_count_, sample_rate_, audio_time_base_, PtsToTime(frame->pts, audio_time_base_), capacity_ * 4);
+			fifo_ = std::make_unique<AudioFifo>(audio_sample_format_, audio_channel_count_, sample_rate_, audio_time_base_, PtsToTime(frame->pts, audio_time_base_), capacity_ * BUFFER_OVERFLOW_FACTOR);
 			DebugPrintLine(Common::DebugSeverity::info, "New fifo created");
 		}
 		if (!fifo_->TryPush(frame))
 		{
-			fifo_->Reset(PtsToTime(frame->pts, audio_time_base_));
-			DebugPrintLine(Common::DebugSeverity::warning, "Audio fifo overflow. Flushing.");
-			fifo_->TryPush(frame);
+			// keep the newest samples, fifo stays continuous
+			int samples_to_drop = FFMIN(frame->nb_samples, fifo_->SamplesCount());
+			fifo_->DiscardSamples(samples_to_drop);
+			dropped_audio_samples_ += samples_to_drop;
+			DebugPrintLine(Common::DebugSeverity::warning, "Audio fifo overflow. Oldest samples dropped.");
+			DebugRecord(Common::DebugSeverity::warning, "audio fifo overflow", frame->pts, samples_to_drop);
+			if (!fifo_->TryPush(frame))
+			{
+				fifo_->Reset(PtsToTime(frame->pts, audio_time_base_));
+				fifo_->TryPush(frame);
+			}
 		}
+		UpdateIsFull();
 	}
 
 	void SynchronizingBuffer::PushVideo(const std::shared_ptr<AVFrame>& frame, const AVRational& time_base) 
@@ -63,15 +86,20 @@ namespace TVPlayR {
 		if (!(frame && have_video_))
 			return;
 		input_video_time_base_ = time_base;
-		DebugPrintLine(Common::DebugSeverity::trace, "Push video " + std::to_string(static_cast<float>(PtsToTime(frame->pts, input_video_time_base_)) / AV_TIME_BASE));
+		DebugPrintLineLazy(Common::DebugSeverity::trace, "Push video " + std::to_string(static_cast<float>(PtsToTime(frame->pts, input_video_time_base_)) / AV_TIME_BASE));
 		assert(!is_flushed_);
-		Sweep();
-		if (video_queue_.size() > video_frame_rate_.num * 10 / video_frame_rate_.den) // approx. 10 seconds
+		const size_t frame_bytes = FrameBytes(frame.get());
+		while (!video_queue_.empty() && 
+			(video_queue_.size() >= video_queue_size_ * BUFFER_OVERFLOW_FACTOR || (max_bytes_ && BytesCount() + frame_bytes > max_bytes_ * BUFFER_OVERFLOW_FACTOR)))
 		{
-			video_queue_.clear();
-			DebugPrintLine(Common::DebugSeverity::warning, "Video queue overflow. Flushing.");
+			DebugRecord(Common::DebugSeverity::warning, "video queue overflow", video_queue_.front()->pts, video_queue_.size());
+			DebugPrintLine(Common::DebugSeverity::warning, "Video queue overflow. Oldest frame dropped.");
+			PopVideo();
+			dropped_video_frames_++;
 		}
 		video_queue_.push_back(frame);
+		video_bytes_ += frame_bytes;
+		UpdateIsFull();
 	}
 	
 	Core::AVSync SynchronizingBuffer::PullSync(int audio_samples_count)
@@ -88,38 +116,111 @@ namespace TVPlayR {
 		if ((is_playing_ || !pause_buffer_.GetFrame()) && !video_queue_.empty())
 			pause_buffer_.SetFrame(video_queue_.front());
 		if (is_playing_ && !video_queue_.empty())
-			video_queue_.pop_front();
+			PopVideo();
+		UpdateIsFull();
 #ifdef DEBUG
 		if (audio && audio->pts != AV_NOPTS_VALUE && !pause_buffer_.IsEmpty() && pause_buffer_.GetFrame()->pts != AV_NOPTS_VALUE)
-			DebugPrintLine(Common::DebugSeverity::trace, "Output video " + std::to_string(static_cast<float>(PtsToTime(pause_buffer_.Pts(), input_video_time_base_))/AV_TIME_BASE) + ", audio: " + std::to_string(static_cast<float>(PtsToTime(audio->pts, audio_time_base_))/AV_TIME_BASE) + ", delta:" + std::to_string((PtsToTime(pause_buffer_.Pts(), input_video_time_base_) - PtsToTime(audio->pts, audio_time_base_)) / 1000) + " ms");
+			DebugPrintLineLazy(Common::DebugSeverity::trace, "Output video " + std::to_string(static_cast<float>(PtsToTime(pause_buffer_.Pts(), input_video_time_base_))/AV_TIME_BASE) + ", audio: " + std::to_string(static_cast<float>(PtsToTime(audio->pts, audio_time_base_))/AV_TIME_BASE) + ", delta:" + std::to_string((PtsToTime(pause_buffer_.Pts(), input_video_time_base_) - PtsToTime(audio->pts, audio_time_base_)) / 1000) + " ms");
 #endif // DEBUG
 		std::int64_t time = PtsToTime(pause_buffer_.Pts(), input_video_time_base_);
 		return Core::AVSync(audio, pause_buffer_.GetFrame(), Core::FrameTimeInfo{ time + start_timecode_, time, media_duration_ == AV_NOPTS_VALUE ? AV_NOPTS_VALUE : media_duration_ - time});
 	}
 	
+	std::shared_ptr<AVFrame> SynchronizingBuffer::PullTailAudio(int max_samples_count)
+	{
+		if (!fifo_)
+			return nullptr;
+		int samples_count = FFMIN(fifo_->SamplesCount(), max_samples_count);
+		if (samples_count <= 0)
+			return nullptr;
+		return fifo_->Pull(samples_count);
+	}
+
 	bool SynchronizingBuffer::IsFull() const 
 	{ 
-		if (is_flushed_)
-			return true;
-		return video_queue_.size() >= video_queue_size_
-			&& (!fifo_ || fifo_->SamplesCount() > audio_fifo_size_);
-		/*std::int64_t min_video = video_queue_.empty() ? AV_NOPTS_VALUE : PtsToTime(video_queue_.front()->pts, video_time_base_);
-		std::int64_t max_video = video_queue_.empty() ? AV_NOPTS_VALUE : PtsToTime(video_queue_.back()->pts, video_time_base_);
-		std::int64_t min_audio = fifo_ ? fifo_->TimeMin() : AV_NOPTS_VALUE;
-		std::int64_t max_audio = fifo_ ? fifo_->TimeMax() : AV_NOPTS_VALUE;
-		return max_video - min_video >= capacity_ &&
-					(!fifo_ || max_audio - min_audio >= capacity_);*/
+		return is_flushed_ || is_full_;
+	}
+
+	bool SynchronizingBuffer::IsVideoFull() const
+	{
+		return is_flushed_ || is_video_full_;
+	}
+
+	bool SynchronizingBuffer::IsAudioFull() const
+	{
+		return is_flushed_ || is_audio_full_;
+	}
+
+	bool SynchronizingBuffer::IsVideoAboveWatermark(int percent) const
+	{
+		return video_queue_.size() * 100 >= video_queue_size_ * percent
+			|| (max_bytes_ && BytesCount() * 100 >= max_bytes_ * percent);
+	}
+
+	bool SynchronizingBuffer::IsAudioAboveWatermark(int percent) const
+	{
+		return fifo_ && (static_cast<std::int64_t>(fifo_->SamplesCount()) * 100 >= static_cast<std::int64_t>(audio_fifo_size_) * percent
+			|| (max_bytes_ && BytesCount() * 100 >= max_bytes_ * percent));
+	}
+
+	// not enough samples for the next frame, the buffer is not ready until it gets more
+	bool SynchronizingBuffer::IsAudioStarved() const
+	{
+		return fifo_ && fifo_->SamplesCount() <= av_rescale(sample_rate_, input_video_time_base_.num, input_video_time_base_.den);
+	}
+
+	// the producer stops at the high watermark (full capacity) and resumes when the buffer falls below the low one
+	// a stream the buffer can't play without is never full, even if the other stream took all the bytes
+	void SynchronizingBuffer::UpdateIsFull()
+	{
+		is_video_full_ = !video_queue_.empty() && IsVideoAboveWatermark(is_video_full_ ? low_watermark_percent_ : 100);
+		is_audio_full_ = !IsAudioStarved() && IsAudioAboveWatermark(is_audio_full_ ? low_watermark_percent_ : 100);
+		is_full_ = is_video_full_ && (!fifo_ || is_audio_full_);
+	}
+
+	void SynchronizingBuffer::PopVideo()
+	{
+		video_bytes_ -= FrameBytes(video_queue_.front().get());
+		video_queue_.pop_front();
+	}
+
+	size_t SynchronizingBuffer::BytesCount() const
+	{
+		size_t audio_samples = (fifo_ ? fifo_->SamplesCount() : 0) + (fifo_loop_ ? fifo_loop_->SamplesCount() : 0);
+		return video_bytes_ + audio_samples * audio_channel_count_ * av_get_bytes_per_sample(audio_sample_format_);
+	}
+
+	FFmpegInputBufferStatistics SynchronizingBuffer::GetStatistics() const
+	{
+		return FFmpegInputBufferStatistics
+		{
+			video_queue_.size(),
+			av_rescale(video_queue_.size(), video_frame_rate_.den * AV_TIME_BASE, video_frame_rate_.num),
+			fifo_ ? av_rescale(fifo_->SamplesCount(), AV_TIME_BASE, sample_rate_) : 0LL,
+			BytesCount(),
+			is_full_,
+			dropped_video_frames_,
+			dropped_audio_samples_
+		};
 	}
 	bool SynchronizingBuffer::IsReady() const 
 	{ 
 		if (is_flushed_)
 			return true;
 		if (is_playing_)
-			return !video_queue_.empty() && (!fifo_ || fifo_->SamplesCount() > av_rescale(sample_rate_, input_video_time_base_.num, input_video_time_base_.den));
+			return !video_queue_.empty() && !IsAudioStarved();
 		else
 			return !pause_buffer_.IsEmpty() || !video_queue_.empty();
 	}
 	
+	bool SynchronizingBuffer::IsPrimed(size_t video_frames_count) const
+	{
+		if (is_flushed_ || IsFull())
+			return true;
+		return video_queue_.size() >= video_frames_count
+			&& (!fifo_ || fifo_->SamplesCount() >= av_rescale(video_frames_count * sample_rate_, video_frame_rate_.den, video_frame_rate_.num));
+	}
+	
 	void SynchronizingBuffer::SetIsPlaying(bool is_playing) 
 	{
 		is_playing_ = is_playing;
@@ -132,9 +233,12 @@ namespace TVPlayR {
 		if (fifo_)
 			fifo_->Reset(time);
 		video_queue_.clear();
+		video_bytes_ = 0;
 		pause_buffer_.Clear();
 		is_flushed_ = false;
-		DebugPrintLine(Common::DebugSeverity::info, "Seek: " + std::to_string(time / 1000));
+		skip_audio_until_ = AV_NOPTS_VALUE;
+		UpdateIsFull();
+		DebugPrintLineLazy(Common::DebugSeverity::info, "Seek: " + std::to_string(time / 1000));
 	}
 
 	void SynchronizingBuffer::Loop()
@@ -142,24 +246,32 @@ namespace TVPlayR {
 		if (!fifo_)
 			return;
 		int samples_over = static_cast<int>(fifo_->SamplesCount() - (video_queue_.size() * sample_rate_ * video_frame_rate_.den / video_frame_rate_.num));
-		DebugPrintLine(Common::DebugSeverity::info, "Loop, samples over=" + std::to_string(samples_over));
+		DebugPrintLineLazy(Common::DebugSeverity::info, "Loop, samples over=" + std::to_string(samples_over));
 		if (samples_over > 0)
 			fifo_->DiscardSamples(samples_over);
 		if (samples_over < 0)
 			fifo_->TryPush(FFmpeg::CreateSilentAudioFrame(-samples_over, audio_channel_count_, audio_sample_format_));
 		fifo_loop_ = std::move(fifo_);
 		fifo_.reset();
+		skip_audio_until_ = AV_NOPTS_VALUE;
+		UpdateIsFull();
+	}
+
+	void SynchronizingBuffer::SkipAudioUntil(std::int64_t time)
+	{
+		skip_audio_until_ = time;
 	}
 	
 	void SynchronizingBuffer::SetSynchro(std::int64_t time) 
 	{ 
 		sync_ = time;
-		DebugPrintLine(Common::DebugSeverity::info, "Sync set to: " + std::to_string(time / 1000));
+		DebugPrintLineLazy(Common::DebugSeverity::info, "Sync set to: " + std::to_string(time / 1000));
 	}
 	
 	bool SynchronizingBuffer::IsFlushed() const { return is_flushed_; }
 	
-	bool SynchronizingBuffer::IsEof() { return is_flushed_ && video_queue_.empty() && (!fifo_ || fifo_->SamplesCount() == 0); }
+	// once the last video frame was played, audio left is only useful to splice it with the next input
+	bool SynchronizingBuffer::IsEof() { return is_flushed_ && video_queue_.empty() && (!fifo_ || fifo_->SamplesCount() == 0 || !pause_buffer_.IsEmpty()); }
 	
 	void SynchronizingBuffer::Flush()
 	{
@@ -168,18 +280,4 @@ namespace TVPlayR {
 	}
 	
 	const Core::VideoFormatType SynchronizingBuffer::VideoFormat() const { return video_format_; }
-
-	void SynchronizingBuffer::Sweep()
-	{
-		return;
-		/*std::int64_t min_video = video_queue_.empty() ? AV_NOPTS_VALUE : PtsToTime(video_queue_.front()->pts, input_video_time_base_);
-		std::int64_t max_video = video_queue_.empty() ? AV_NOPTS_VALUE : PtsToTime(video_queue_.back()->pts, input_video_time_base_);
-		std::int64_t min_audio = fifo_ ? fifo_->TimeMin() : AV_NOPTS_VALUE;
-		std::int64_t max_audio = fifo_ ? fifo_->TimeMax() : AV_NOPTS_VALUE;
-		if (min_audio == AV_NOPTS_VALUE)
-			while (video_queue_.size() > av_rescale(2 * capacity_, video_frame_rate_.num, video_frame_rate_.den * AV_TIME_BASE))
-				video_queue_.pop_front();
-		if (fifo_ && min_video == AV_NOPTS_VALUE && (max_audio - min_audio) > 2 * capacity_)
-			fifo_->DiscardSamples(static_cast<int>(av_rescale(max_audio - min_audio - 2 * capacity_, sample_rate_, AV_TIME_BASE)));*/
-	}
 }}
\ No newline at end of file
@@ -6,29 +6,40 @@ namespace TVPlayR {
 	{
 		class Player;
 		struct AVSync;
+		struct PlayerBufferSettings;
 		enum class VideoFormatType;
 	}
 	namespace FFmpeg {
 		class AudioFifo;
+		struct FFmpegInputBufferStatistics;
 
 class SynchronizingBuffer final : Common::NonCopyable, Common::DebugTarget
 {
 public:
-	SynchronizingBuffer(const Core::Player * player, bool is_playing, std::int64_t duration, std::int64_t initial_sync, std::int64_t start_timecode, std::int64_t media_duration, FieldOrder field_order);
+	SynchronizingBuffer(const Core::Player * player, bool is_playing, const Core::PlayerBufferSettings& settings, std::int64_t initial_sync, std::int64_t start_timecode, std::int64_t media_duration, FieldOrder field_order);
 	virtual ~SynchronizingBuffer();
 	void PushAudio(const std::shared_ptr<AVFrame>& frame);
 	void PushVideo(const std::shared_ptr<AVFrame>& frame, const AVRational& time_base);
 	Core::AVSync PullSync(int audio_samples_count);
+	// audio left in the buffer after its last video frame was played
+	std::shared_ptr<AVFrame> PullTailAudio(int max_samples_count);
 	bool IsFull() const;
+	// each stage stops at its own stream, so a stream missing in the buffer is fed even if the other one fills it
+	bool IsVideoFull() const;
+	bool IsAudioFull() const;
 	bool IsReady() const;
+	bool IsPrimed(size_t video_frames_count) const;
 	void SetIsPlaying(bool is_playing);
 	void Seek(std::int64_t time);
 	void Loop();
+	// audio pushed later is cut to start at time, where the audio already in the buffer ends (splice of a loop head with the file read again)
+	void SkipAudioUntil(std::int64_t time);
 	void SetSynchro(std::int64_t time);
 	bool IsFlushed() const;
 	bool IsEof();
 	void Flush();
 	const Core::VideoFormatType VideoFormat() const;
+	FFmpegInputBufferStatistics GetStatistics() const;
 private:
 	const int sample_rate_;
 	const int audio_channel_count_;
@@ -43,6 +54,15 @@ private:
 	const size_t video_queue_size_;
 	const int audio_fifo_size_;
 	const std::int64_t capacity_;
+	const size_t max_bytes_;
+	const int low_watermark_percent_;
+	bool is_full_ = false;
+	bool is_video_full_ = false;
+	bool is_audio_full_ = false;
+	size_t video_bytes_ = 0;
+	std::int64_t dropped_video_frames_ = 0LL;
+	std::int64_t dropped_audio_samples_ = 0LL;
+	std::int64_t skip_audio_until_ = AV_NOPTS_VALUE;
 	const std::int64_t start_timecode_;
 	const std::int64_t media_duration_;
 	std::deque<std::shared_ptr<AVFrame>> video_queue_;
@@ -51,7 +71,12 @@ private:
 	PauseBuffer pause_buffer_;
 	const Core::VideoFormatType video_format_;
 	const AVSampleFormat audio_sample_format_;
-	void Sweep();
+	bool IsVideoAboveWatermark(int percent) const;
+	bool IsAudioAboveWatermark(int percent) const;
+	bool IsAudioStarved() const;
+	void UpdateIsFull();
+	void PopVideo();
+	size_t BytesCount() const;
 };
 
 }}
\ No newline at end of file
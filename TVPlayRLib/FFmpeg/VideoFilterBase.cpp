@@ -1,12 +1,15 @@
 #include "../pch.h"
 #include "FFmpegUtils.h"
 #include "VideoFilterBase.h"
+#include "FilterGraphCache.h"
 
 namespace TVPlayR {
 	namespace FFmpeg {
 
-bool VideoFilterBase::Push(std::shared_ptr<AVFrame> frame) 
-{ 
+static FilterGraphCache graph_cache;
+
+void VideoFilterBase::CreateFilterIfInputChanged(const AVFrame* frame)
+{
 	if (frame->width != input_width_ ||
 		frame->height != input_height_ ||
 		frame->format != input_pixel_format_ ||
@@ -14,9 +17,23 @@ bool VideoFilterBase::Push(std::shared_ptr<AVFrame> frame)
 		frame->sample_aspect_ratio.den != input_sar_.den
 		)
 		CreateFilter(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format), frame->sample_aspect_ratio);
+}
+
+bool VideoFilterBase::Push(std::shared_ptr<AVFrame> frame) 
+{ 
+	CreateFilterIfInputChanged(frame.get());
 	return av_buffersrc_write_frame(source_ctx_, frame.get()) >= 0;
 }
 
+bool VideoFilterBase::Push(const std::shared_ptr<AVFrame>& frame, std::int64_t pts)
+{
+	CreateFilterIfInputChanged(frame.get());
+	auto stamped = CloneFrame(frame);
+	stamped->pts = pts;
+	// the buffer source takes over the reference, so the frame is referenced once, like in av_buffersrc_write_frame()
+	return av_buffersrc_add_frame(source_ctx_, stamped.get()) >= 0;
+}
+
 VideoFilterBase::VideoFilterBase(AVPixelFormat output_pix_fmt)
 	: Common::DebugTarget(Common::DebugSeverity::info, "VideoFilterBase")
 	, output_pix_fmt_(output_pix_fmt)
@@ -42,7 +59,7 @@ std::shared_ptr<AVFrame> VideoFilterBase::Pull() {
 		//if (frame->best_effort_timestamp == AV_NOPTS_VALUE)
 		//	frame->best_effort_timestamp = frame->pts;
 		//frame->pts = av_rescale_q(frame->best_effort_timestamp, input_time_base_, av_buffersink_get_time_base(sink_ctx_));
-		DebugPrintLine(Common::DebugSeverity::trace, "Pulled from VideoFilterBase: " + std::to_string(PtsToTime(frame->pts, av_buffersink_get_time_base(sink_ctx_)) / 1000) + "\n");
+		DebugPrintLineLazy(Common::DebugSeverity::trace, "Pulled from VideoFilterBase: " + std::to_string(PtsToTime(frame->pts, av_buffersink_get_time_base(sink_ctx_)) / 1000) + "\n");
 		return frame;
 	}
 	return nullptr;
@@ -91,7 +108,7 @@ void VideoFilterBase::Flush() {
 
 void VideoFilterBase::SetFilter(const std::string& filter_str, const AVRational input_time_base)
 {
-	Reset();
+	VideoFilterBase::Reset();
 	input_time_base_ = input_time_base;
 	filter_ = filter_str;
 	input_width_ = 0;
@@ -100,51 +117,33 @@ void VideoFilterBase::SetFilter(const std::string& filter_str, const AVRational
 	input_sar_ = av_make_q(1, 1);
 }
 
+void VideoFilterBase::SetGraphOptions(int thread_count, const std::string& sws_flags)
+{
+	thread_count_ = thread_count;
+	sws_flags_ = sws_flags;
+}
+
 void VideoFilterBase::CreateFilter(int input_width, int input_height, AVPixelFormat input_pixel_format, const AVRational input_sar) 
 {
-	graph_ = std::unique_ptr<AVFilterGraph, void(*)(AVFilterGraph*)>(avfilter_graph_alloc(), [](AVFilterGraph* graph) { avfilter_graph_free(&graph); });
-	AVFilterInOut* inputs = avfilter_inout_alloc();
-	AVFilterInOut* outputs = avfilter_inout_alloc();
-	try
-	{
-		const AVFilter* buffersrc = avfilter_get_by_name("buffer");
-		const AVFilter* buffersink = avfilter_get_by_name("buffersink");
-		char args[512];
-		snprintf(args, sizeof(args),
-			"video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
-			input_width, input_height, input_pixel_format,
-			input_time_base_.num, input_time_base_.den,
-			input_sar.num, input_sar.den);
-		THROW_ON_FFMPEG_ERROR(avfilter_graph_create_filter(&source_ctx_, buffersrc, "vin", args, NULL, graph_.get()));
-		enum AVPixelFormat pix_fmts[] = { output_pix_fmt_, AV_PIX_FMT_NONE };
-		THROW_ON_FFMPEG_ERROR(avfilter_graph_create_filter(&sink_ctx_, buffersink, "vout", NULL, NULL, graph_.get()));
-		THROW_ON_FFMPEG_ERROR(av_opt_set_int_list(sink_ctx_, "pix_fmts", pix_fmts, AV_PIX_FMT_NONE, AV_OPT_SEARCH_CHILDREN));
-
-		outputs->name = av_strdup("in");
-		outputs->filter_ctx = source_ctx_;
-		outputs->pad_idx = 0;
-		outputs->next = NULL;
-
-		inputs->name = av_strdup("out");
-		inputs->filter_ctx = sink_ctx_;
-		inputs->pad_idx = 0;
-		inputs->next = NULL;
-		THROW_ON_FFMPEG_ERROR(avfilter_graph_parse(graph_.get(), filter_.c_str(), inputs, outputs, NULL));
-		THROW_ON_FFMPEG_ERROR(avfilter_graph_config(graph_.get(), NULL));
-		input_width_ = input_width;
-		input_height_ = input_height;
-		input_pixel_format_ = static_cast<AVPixelFormat>(input_pixel_format);
-		input_sar_ = input_sar;
-		DebugPrintLine(Common::DebugSeverity::debug, args);
-		if (DebugSeverity() == Common::DebugSeverity::trace)
-			DumpFilter(filter_, graph_.get());
-	}
-	catch (const std::exception& e)
-	{
-		avfilter_inout_free(&inputs);
-		avfilter_inout_free(&outputs);
-		throw e;
-	}
+	auto start = std::chrono::steady_clock::now();
+	auto graph = graph_cache.Get(FilterGraphKey{ filter_, input_width, input_height, input_pixel_format, input_time_base_, input_sar, output_pix_fmt_, thread_count_, sws_flags_ });
+	graph_ = std::move(graph->Graph);
+	source_ctx_ = graph->Source;
+	sink_ctx_ = graph->Sink;
+	is_eof_ = false;
+	is_flushed_ = false;
+	input_width_ = input_width;
+	input_height_ = input_height;
+	input_pixel_format_ = input_pixel_format;
+	input_sar_ = input_sar;
+	DebugPrintLine(Common::DebugSeverity::debug, "Filter for " + std::to_string(input_width) + "x" + std::to_string(input_height) + " ready in " + std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()) + " us");
+	if (DebugSeverity() == Common::DebugSeverity::trace)
+		DumpFilter(filter_, graph_.get());
+}
+
+FilterGraphCacheStatistics VideoFilterBase::GetGraphCacheStatistics()
+{
+	return graph_cache.GetStatistics();
 }
 
 
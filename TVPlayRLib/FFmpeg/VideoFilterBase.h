@@ -8,6 +8,7 @@ namespace TVPlayR {
 	}
 
 	namespace FFmpeg {
+		struct FilterGraphCacheStatistics;
 
 class VideoFilterBase :	public FilterBase, protected Common::DebugTarget
 {
@@ -21,13 +22,21 @@ public:
 	virtual AVRational OutputTimeBase() const override;
 	AVRational OutputFrameRate() const;
 	virtual void Flush() override;
-	void Reset();
-	bool IsInitialized() const;
+	virtual void Reset();
+	virtual bool IsInitialized() const;
+	// configured graphs are shared by all the video filters, time spent building them is reported here
+	static FilterGraphCacheStatistics GetGraphCacheStatistics();
 protected:
 	bool Push(std::shared_ptr<AVFrame> frame);
+	// pushes the frame with the pts replaced, without modifying the (possibly shared) frame
+	bool Push(const std::shared_ptr<AVFrame>& frame, std::int64_t pts);
 	void SetFilter(const std::string& filter_str, const AVRational input_time_base );
+	// applies to graphs created later, thread_count 0 - as many as cores, sws_flags empty - swscale's default algorithm
+	void SetGraphOptions(int thread_count, const std::string& sws_flags);
 private:
 	std::string filter_;
+	int thread_count_ = 0;
+	std::string sws_flags_;
 	AVFilterContext* source_ctx_ = NULL;
 	AVFilterContext* sink_ctx_ = NULL;
 	const AVPixelFormat output_pix_fmt_;
@@ -37,6 +46,7 @@ private:
 	AVRational input_time_base_ = av_make_q(1, 1);
 	AVRational input_sar_ = av_make_q(1, 1);
 	void CreateFilter(int input_width, int input_height, AVPixelFormat input_pixel_format, const AVRational input_sar);
+	void CreateFilterIfInputChanged(const AVFrame* frame);
 };
 	
 }}
\ No newline at end of file
@@ -23,7 +23,7 @@ namespace TVPlayR {
 			int audio_channels_count_ = 2;
 			int audio_sample_rate_ = 48000;
 			std::unique_ptr<FFmpeg::SwScale> frame_converter_;
-			Common::BlockingCollection<Core::AVSync> buffer_;
+			Common::SpscRing<Core::AVSync> buffer_;
 			std::int64_t audio_samples_requested_ = 0LL;
 			std::int64_t video_frames_requested_ = 0LL;
 			Common::Executor executor_;
@@ -123,7 +123,7 @@ namespace TVPlayR {
 					else
 						std::this_thread::sleep_for(20ms);
 					RequestNextFrame();
-					executor_.begin_invoke([this] { Tick(); }); // next frame
+					executor_.post([this] { Tick(); }); // next frame
 				}
 			}
 
@@ -26,7 +26,7 @@ namespace TVPlayR {
 			{
 				if (!video)
 					return;
-				executor_.begin_invoke([this, video]
+				executor_.post([this, video]
 				{
 					if (!frame_played_callback_)
 						return;
@@ -31,6 +31,8 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <new>
 
 extern "C"
 {
@@ -59,7 +61,11 @@ extern "C"
 #include "Common/NonCopyable.h"
 #include "Common/Semaphore.h"
 #include "Common/BlockingCollection.h"
+#include "Common/SpscRing.h"
+#include "Common/Task.h"
+#include "Common/MpscQueue.h"
 #include "Common/Executor.h"
+#include "Common/WorkerPool.h"
 #include "Common/Rational.h"
 #include "Common/Debug.h"
 